@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 using the ARMv8 Crypto Extensions, on CPUs that implement them
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <u-boot/sha1.h>
+#include <asm/armv8/cpu.h>
+
+void sha1_armv8_ce_blocks(uint32_t state[5], const uint8_t *src,
+			  uint32_t blocks);
+
+int sha1_armv8_ce_process(unsigned long state[5], const unsigned char *data,
+			  unsigned int blocks)
+{
+	uint32_t st[5];
+	int i;
+
+	if (!((read_id_aa64isar0() >> ID_AA64ISAR0_SHA1_SHIFT) &
+	      ID_AA64ISAR0_FIELD_MASK))
+		return -ENOSYS;
+
+	/* The context keeps the state in longs */
+	for (i = 0; i < 5; i++)
+		st[i] = state[i];
+	sha1_armv8_ce_blocks(st, data, blocks);
+	for (i = 0; i < 5; i++)
+		state[i] = st[i];
+
+	return 0;
+}
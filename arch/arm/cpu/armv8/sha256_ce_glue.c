@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-256 using the ARMv8 Crypto Extensions, on CPUs that implement them
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <u-boot/sha256.h>
+#include <asm/armv8/cpu.h>
+
+void sha256_armv8_ce_blocks(uint32_t state[8], const uint8_t *src,
+			    uint32_t blocks);
+
+int sha256_armv8_ce_process(uint32_t state[8], const uint8_t *data,
+			    uint32_t blocks)
+{
+	if (!((read_id_aa64isar0() >> ID_AA64ISAR0_SHA2_SHIFT) &
+	      ID_AA64ISAR0_FIELD_MASK))
+		return -ENOSYS;
+
+	sha256_armv8_ce_blocks(state, data, blocks);
+
+	return 0;
+}
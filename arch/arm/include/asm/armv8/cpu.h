@@ -9,6 +9,11 @@
 #define MIDR_PARTNUM_SHIFT	0x4
 #define MIDR_PARTNUM_MASK	(0xFFF << 0x4)
 
+/* Instruction set attribute fields, 0 if the instructions are absent */
+#define ID_AA64ISAR0_SHA1_SHIFT	8
+#define ID_AA64ISAR0_SHA2_SHIFT	12
+#define ID_AA64ISAR0_FIELD_MASK	0xf
+
 static inline unsigned int read_midr(void)
 {
 	unsigned long val;
@@ -18,6 +23,15 @@ static inline unsigned int read_midr(void)
 	return val;
 }
 
+static inline unsigned long read_id_aa64isar0(void)
+{
+	unsigned long val;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (val));
+
+	return val;
+}
+
 #define is_cortex_a35() (((read_midr() & MIDR_PARTNUM_MASK) >> \
 			 MIDR_PARTNUM_SHIFT) == MIDR_PARTNUM_CORTEX_A35)
 #define is_cortex_a53() (((read_midr() & MIDR_PARTNUM_MASK) >> \
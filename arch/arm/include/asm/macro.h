@@ -77,6 +77,19 @@ lr	.req	x30
 	b.eq	\el1_label
 .endm
 
+/*
+ * Read SCTLR of the current exception level. Local labels 0 to 3 are used.
+ */
+.macro	read_sctlr, xreg
+	switch_el \xreg, 3f, 2f, 1f
+3:	mrs	\xreg, sctlr_el3
+	b	0f
+2:	mrs	\xreg, sctlr_el2
+	b	0f
+1:	mrs	\xreg, sctlr_el1
+0:
+.endm
+
 /*
  * Branch if current processor is a Cortex-A57 core.
  */
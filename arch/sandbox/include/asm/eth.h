@@ -80,6 +80,8 @@ typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
  * recv_packets - number of packets returned
  * tx_handler - function to generate responses to sent packets
  * priv - a pointer to some structure a test may want to keep track of
+ * rx_split - payload slots set up by the network stack, if any
+ * rx_split_used - number of payload slots filled so far
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
@@ -90,6 +92,8 @@ struct eth_sandbox_priv {
 	int recv_packets;
 	sandbox_eth_tx_hand_f *tx_handler;
 	void *priv;
+	struct eth_rx_split rx_split;
+	int rx_split_used;
 };
 
 /*
@@ -17,11 +17,14 @@ static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
+	       "evictions: %u\n"
 	       "entries: %u\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max cache entries: %u\n"
+	       "sets: %u of %u entries\n",
+	       stats.hits, stats.misses, stats.evictions, stats.entries,
+	       stats.max_blocks_per_entry, stats.max_entries,
+	       stats.sets, stats.ways);
 	return 0;
 }
 
@@ -99,3 +99,19 @@ U_BOOT_CMD(
 	"fstype <interface> <dev>:<part> <varname>\n"
 	"- set environment variable to filesystem type\n"
 );
+
+static int do_umount(cmd_tbl_t *cmdtp, int flag, int argc,
+		     char * const argv[])
+{
+	fs_unmount();
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	umount, 1, 1, do_umount,
+	"unmount the filesystem kept mounted by filesystem commands",
+	"\n"
+	"    - Drop the filesystem kept mounted since the last filesystem\n"
+	"      command, so that the next one probes the partition again."
+);
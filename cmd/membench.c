@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Measure the throughput of memcpy(), memmove() and memset()
+ *
+ * Each function is run repeatedly for a fixed time and compared with plain
+ * C loops equivalent to the generic versions in lib/string.c, which is what
+ * a board gets without an architecture specific implementation.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <mapmem.h>
+#include <linux/sizes.h>
+
+/* Time to spend on each measurement, in ms */
+#define MEMBENCH_MS	500
+
+/* Generic versions, as in lib/string.c */
+static noinline void *ref_memcpy(void *dest, const void *src, size_t count)
+{
+	unsigned long *dl = (unsigned long *)dest, *sl = (unsigned long *)src;
+	char *d8, *s8;
+
+	if ((((ulong)dest | (ulong)src) & (sizeof(*dl) - 1)) == 0) {
+		while (count >= sizeof(*dl)) {
+			*dl++ = *sl++;
+			count -= sizeof(*dl);
+		}
+	}
+	d8 = (char *)dl;
+	s8 = (char *)sl;
+	while (count--)
+		*d8++ = *s8++;
+
+	return dest;
+}
+
+static noinline void *ref_memmove(void *dest, const void *src, size_t count)
+{
+	char *tmp, *s;
+
+	if (dest <= src)
+		return ref_memcpy(dest, src, count);
+	tmp = (char *)dest + count;
+	s = (char *)src + count;
+	while (count--)
+		*--tmp = *--s;
+
+	return dest;
+}
+
+static noinline void *ref_memset(void *s, int c, size_t count)
+{
+	unsigned long *sl = (unsigned long *)s;
+	unsigned long cl = 0;
+	char *s8;
+	int i;
+
+	if (((ulong)s & (sizeof(*sl) - 1)) == 0) {
+		for (i = 0; i < sizeof(*sl); i++) {
+			cl <<= 8;
+			cl |= c & 0xff;
+		}
+		while (count >= sizeof(*sl)) {
+			*sl++ = cl;
+			count -= sizeof(*sl);
+		}
+	}
+	s8 = (char *)sl;
+	while (count--)
+		*s8++ = c;
+
+	return s;
+}
+
+enum membench_op {
+	MEMBENCH_COPY,
+	MEMBENCH_MOVE,
+	MEMBENCH_SET,
+};
+
+struct membench_test {
+	const char *name;
+	enum membench_op op;
+	int dst_off;	/* offsets from the start of each buffer */
+	int src_off;
+	int val;	/* fill value for memset */
+};
+
+static const struct membench_test membench_tests[] = {
+	{ "memcpy aligned", MEMBENCH_COPY, 0, 0 },
+	{ "memcpy unaligned", MEMBENCH_COPY, 1, 3 },
+	{ "memmove overlap", MEMBENCH_MOVE, 8, 0 },
+	{ "memset", MEMBENCH_SET, 0, 0, 0x55 },
+	{ "memset zero", MEMBENCH_SET, 0, 0, 0 },
+};
+
+/* Run one test for MEMBENCH_MS and return the throughput in KiB/s */
+static ulong membench_run(const struct membench_test *test, bool ref,
+			  char *dst, char *src, ulong size)
+{
+	ulong start, ms, loops = 0;
+
+	dst += test->dst_off;
+	src += test->src_off;
+	size -= 8;
+	start = get_timer(0);
+	do {
+		switch (test->op) {
+		case MEMBENCH_COPY:
+			if (ref)
+				ref_memcpy(dst, src, size);
+			else
+				memcpy(dst, src, size);
+			break;
+		case MEMBENCH_MOVE:
+			if (ref)
+				ref_memmove(dst, src, size);
+			else
+				memmove(dst, src, size);
+			break;
+		case MEMBENCH_SET:
+			if (ref)
+				ref_memset(dst, test->val, size);
+			else
+				memset(dst, test->val, size);
+			break;
+		}
+		loops++;
+		ms = get_timer(start);
+	} while (ms < MEMBENCH_MS);
+
+	return lldiv((u64)loops * size * 1000 / SZ_1K, ms);
+}
+
+static int do_membench(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	const struct membench_test *test;
+	ulong addr, size, cur, ref;
+	char *buf;
+
+	if (argc != 3)
+		return CMD_RET_USAGE;
+	addr = simple_strtoul(argv[1], NULL, 16);
+	size = simple_strtoul(argv[2], NULL, 16);
+	if (size < SZ_1K) {
+		printf("Size must be at least 0x%x\n", SZ_1K);
+		return CMD_RET_FAILURE;
+	}
+
+	/* Destination first, then the source; memmove overlaps the two */
+	buf = map_sysmem(addr, 2 * size);
+	memset(buf, 0xa5, 2 * size);
+	printf("%-20s %12s %12s\n", "", "KiB/s", "generic");
+	for (test = membench_tests; test < membench_tests +
+	     ARRAY_SIZE(membench_tests); test++) {
+		char *dst = buf, *src = buf + size;
+
+		if (test->op == MEMBENCH_MOVE)
+			src = buf;
+		cur = membench_run(test, false, dst, src, size);
+		ref = membench_run(test, true, dst, src, size);
+		printf("%-20s %12lu %12lu\n", test->name, cur, ref);
+	}
+	unmap_sysmem(buf);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(membench, 3, 0, do_membench,
+	"measure the speed of memcpy, memmove and memset",
+	"addr size\n"
+	"    - run the tests on 2 * size bytes of memory at addr, and\n"
+	"      compare with the generic C implementations"
+);
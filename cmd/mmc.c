@@ -94,6 +94,7 @@ static void print_mmcinfo(struct mmc *mmc)
 }
 static struct mmc *init_mmc_device(int dev, bool force_init)
 {
+	struct blk_desc *bd;
 	struct mmc *mmc;
 	mmc = find_mmc_device(dev);
 	if (!mmc) {
@@ -109,10 +110,9 @@ static struct mmc *init_mmc_device(int dev, bool force_init)
 	if (mmc_init(mmc))
 		return NULL;
 
-#ifdef CONFIG_BLOCK_CACHE
-	struct blk_desc *bd = mmc_get_blk_desc(mmc);
-	blkcache_invalidate(bd->if_type, bd->devnum);
-#endif
+	bd = mmc_get_blk_desc(mmc);
+	if (bd)
+		blk_invalidate(bd);
 
 	return mmc;
 }
@@ -372,6 +372,7 @@ static int do_mmc_sparse_write(cmd_tbl_t *cmdtp, int flag,
 	sparse.size = dev_desc->lba - blk;
 	sparse.write = mmc_sparse_write;
 	sparse.reserve = mmc_sparse_reserve;
+	sparse.erase = NULL;
 	sparse.mssg = NULL;
 	sprintf(dest, "0x" LBAF, sparse.start * sparse.blksz);
 
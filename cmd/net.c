@@ -114,6 +114,19 @@ U_BOOT_CMD(
 );
 #endif
 
+#if defined(CONFIG_CMD_WGET)
+static int do_wget(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	return netboot_common(WGET, cmdtp, argc, argv);
+}
+
+U_BOOT_CMD(
+	wget,	3,	1,	do_wget,
+	"download file via network using HTTP protocol",
+	"[loadAddress] [[hostIPaddr:]path]"
+);
+#endif
+
 static void netboot_update_env(void)
 {
 	char tmp[22];
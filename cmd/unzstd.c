@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Zstandard uncompress command
+ */
+
+#include <common.h>
+#include <command.h>
+#include <env.h>
+#include <mapmem.h>
+
+static int do_unzstd(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	unsigned long src, dst, src_len;
+	size_t dst_len = ~0UL;
+	void *src_buf, *dst_buf;
+	int ret;
+
+	switch (argc) {
+	case 5:
+		dst_len = simple_strtoul(argv[4], NULL, 16);
+		/* fall through */
+	case 4:
+		src = simple_strtoul(argv[1], NULL, 16);
+		src_len = simple_strtoul(argv[2], NULL, 16);
+		dst = simple_strtoul(argv[3], NULL, 16);
+		break;
+	default:
+		return CMD_RET_USAGE;
+	}
+
+	src_buf = map_sysmem(src, src_len);
+	dst_buf = map_sysmem(dst, dst_len);
+	ret = zstd_decompress_buf(src_buf, src_len, dst_buf, &dst_len);
+	unmap_sysmem(dst_buf);
+	unmap_sysmem(src_buf);
+	if (ret) {
+		printf("Uncompressing error %d\n", ret);
+		return CMD_RET_FAILURE;
+	}
+	printf("Uncompressed size: %lu = %#lX\n", (ulong)dst_len,
+	       (ulong)dst_len);
+	env_set_hex("filesize", dst_len);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	unzstd,    5,    1,    do_unzstd,
+	"zstd uncompress a memory region",
+	"srcaddr srcsize dstaddr [dstsize]"
+);
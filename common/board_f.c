@@ -23,6 +23,7 @@
 #include <lcd.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <of_live.h>
 #include <os.h>
 #include <post.h>
 #include <relocate.h>
@@ -553,6 +554,26 @@ static int reserve_fdt(void)
 	return 0;
 }
 
+static int reserve_of_live(void)
+{
+#ifdef CONFIG_OF_LIVE_PRE_RELOC
+	ulong size;
+
+	if (!gd->fdt_blob || of_live_size(gd->fdt_blob, &size))
+		return 0;
+
+	/* Allow for fix_fdt() adding to the tree */
+	gd->of_live_size = ALIGN(size + 0x1000, 32);
+	gd->start_addr_sp = ALIGN_DOWN(gd->start_addr_sp - gd->of_live_size,
+				       16);
+	gd->new_of_live = map_sysmem(gd->start_addr_sp, gd->of_live_size);
+	debug("Reserving %lu Bytes for live tree at: %08lx\n",
+	      gd->of_live_size, gd->start_addr_sp);
+#endif
+
+	return 0;
+}
+
 static int reserve_bootstage(void)
 {
 #ifdef CONFIG_BOOTSTAGE
@@ -683,6 +704,25 @@ static int reloc_fdt(void)
 	return 0;
 }
 
+static int setup_of_live(void)
+{
+#ifdef CONFIG_OF_LIVE_PRE_RELOC
+	int ret;
+
+	/* This uses the tree at its final address, unless it is embedded */
+	if (gd->new_of_live) {
+		ret = of_live_build_image(gd->fdt_blob, gd->new_of_live,
+					  gd->of_live_size);
+		if (ret) {
+			debug("Cannot build live tree: err=%d\n", ret);
+			gd->new_of_live = NULL;
+		}
+	}
+#endif
+
+	return 0;
+}
+
 static int reloc_bootstage(void)
 {
 #ifdef CONFIG_BOOTSTAGE
@@ -966,6 +1006,7 @@ static const init_fnc_t init_sequence_f[] = {
 	setup_machine,
 	reserve_global_data,
 	reserve_fdt,
+	reserve_of_live,
 	reserve_bootstage,
 	reserve_bloblist,
 	reserve_arch,
@@ -986,6 +1027,7 @@ static const init_fnc_t init_sequence_f[] = {
 #endif
 	INIT_FUNC_WATCHDOG_RESET
 	reloc_fdt,
+	setup_of_live,
 	reloc_bootstage,
 	reloc_bloblist,
 	setup_reloc,
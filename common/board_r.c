@@ -45,6 +45,7 @@
 #include <asm/mmu.h>
 #endif
 #include <asm/sections.h>
+#include <dm/of_access.h>
 #include <dm/root.h>
 #include <linux/compiler.h>
 #include <linux/err.h>
@@ -280,7 +281,14 @@ static int initr_of_live(void)
 	int ret;
 
 	bootstage_start(BOOTSTAGE_ID_ACCUM_OF_LIVE, "of_live");
-	ret = of_live_build(gd->fdt_blob, (struct device_node **)&gd->of_root);
+	if (IS_ENABLED(CONFIG_OF_LIVE_PRE_RELOC) && gd->new_of_live) {
+		/* Built by board_f, perhaps with the tree at another address */
+		gd->of_root = of_live_relocate(gd->new_of_live, gd->fdt_blob);
+		ret = of_alias_scan();
+	} else {
+		ret = of_live_build(gd->fdt_blob,
+				    (struct device_node **)&gd->of_root);
+	}
 	bootstage_accum(BOOTSTAGE_ID_ACCUM_OF_LIVE);
 	if (ret)
 		return ret;
@@ -297,6 +305,8 @@ static int initr_dm(void)
 	/* Save the pre-reloc driver model and start a new one */
 	gd->dm_root_f = gd->dm_root;
 	gd->dm_root = NULL;
+	/* The driver index was built in the pre-relocation heap */
+	gd->dm_index = NULL;
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
 #endif
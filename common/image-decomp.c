@@ -0,0 +1,293 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Streaming decompression of images
+ *
+ * The compressed data is handed over in pieces of any size, as it is read
+ * from the boot device, and is decompressed straight to its final location.
+ * The output is a single contiguous buffer, so zstd finds its history there.
+ * inflate() is not called with Z_FINISH, since more input may follow, so
+ * zlib allocates its own 32KiB window as well.
+ */
+
+#include <common.h>
+#include <image.h>
+#include <malloc.h>
+#include <u-boot/zlib.h>
+#include <linux/zstd.h>
+
+#if CONFIG_IS_ENABLED(GZIP)
+static int decomp_gzip_start(struct image_decomp_stream *ds)
+{
+	z_stream *s;
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return -ENOMEM;
+	s->zalloc = gzalloc;
+	s->zfree = gzfree;
+	s->next_out = ds->dst;
+	s->avail_out = ds->dst_len;
+
+	/* Let zlib check the gzip header and the CRC of the output */
+	if (inflateInit2(s, 16 + MAX_WBITS) != Z_OK) {
+		free(s);
+		return -ENOMEM;
+	}
+	ds->priv = s;
+
+	return 0;
+}
+
+static int decomp_gzip_feed(struct image_decomp_stream *ds, const void *src,
+			    size_t len)
+{
+	z_stream *s = ds->priv;
+	int r;
+
+	s->next_in = (void *)src;
+	s->avail_in = len;
+	r = inflate(s, Z_NO_FLUSH);
+	ds->out = s->total_out;
+	switch (r) {
+	case Z_STREAM_END:
+		ds->done = true;
+		return 0;
+	case Z_OK:
+	case Z_BUF_ERROR:
+		/* Input left over means that the output is full */
+		if (!s->avail_out && s->avail_in)
+			return -ENOSPC;
+		return 0;
+	case Z_MEM_ERROR:
+		return -ENOMEM;
+	default:
+		debug("%s: inflate() returned %d\n", __func__, r);
+		return -EINVAL;
+	}
+}
+
+static void decomp_gzip_end(struct image_decomp_stream *ds)
+{
+	z_stream *s = ds->priv;
+
+	inflateEnd(s);
+	free(s);
+}
+#endif /* GZIP */
+
+#if CONFIG_IS_ENABLED(ZSTD)
+/* Largest piece ZSTD_decompressContinue() asks for, bar skippable frames */
+#define ZSTD_STAGE_SIZE		(ZSTD_BLOCKSIZE_ABSOLUTEMAX + \
+				 ZSTD_FRAMEHEADERSIZE_MAX)
+
+struct decomp_zstd {
+	ZSTD_DCtx *dctx;
+	size_t staged;		/* bytes collected in @stage */
+	size_t skip;		/* bytes of skippable frame left to drop */
+	u8 *stage;		/* piece of input split across two feeds */
+	u8 workspace[];
+};
+
+static int decomp_zstd_error(size_t ret)
+{
+	debug("%s: error %d\n", __func__, ZSTD_getErrorCode(ret));
+	switch (ZSTD_getErrorCode(ret)) {
+	case ZSTD_error_dstSize_tooSmall:
+		return -ENOSPC;
+	case ZSTD_error_memory_allocation:
+		return -ENOMEM;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int decomp_zstd_start(struct image_decomp_stream *ds)
+{
+	size_t wsize = ZSTD_DCtxWorkspaceBound();
+	struct decomp_zstd *z;
+
+	z = malloc(sizeof(*z) + wsize);
+	if (!z)
+		return -ENOMEM;
+	z->stage = malloc(ZSTD_STAGE_SIZE);
+	if (!z->stage) {
+		free(z);
+		return -ENOMEM;
+	}
+	z->staged = 0;
+	z->skip = 0;
+	z->dctx = ZSTD_initDCtx(z->workspace, wsize);
+	if (!z->dctx || ZSTD_isError(ZSTD_decompressBegin(z->dctx))) {
+		free(z->stage);
+		free(z);
+		return -EINVAL;
+	}
+	ds->priv = z;
+
+	return 0;
+}
+
+static int decomp_zstd_feed(struct image_decomp_stream *ds, const void *src,
+			    size_t len)
+{
+	struct decomp_zstd *z = ds->priv;
+	const u8 *in = src;
+	const void *piece;
+	size_t need, n, ret;
+
+	while (len) {
+		need = ZSTD_nextSrcSizeToDecompress(z->dctx);
+		if (!need) {
+			/* Another frame follows the one just finished */
+			ret = ZSTD_decompressBegin(z->dctx);
+			if (ZSTD_isError(ret))
+				return decomp_zstd_error(ret);
+			ds->done = false;
+			continue;
+		}
+
+		if (z->skip || (need > ZSTD_STAGE_SIZE &&
+				ZSTD_nextInputType(z->dctx) ==
+				ZSTDnit_skippableFrame)) {
+			/* Too big to stage, but the contents are not used */
+			if (!z->skip)
+				z->skip = need;
+			n = min(z->skip, len);
+			z->skip -= n;
+			in += n;
+			len -= n;
+			if (z->skip)
+				break;
+			piece = in;
+		} else if (!z->staged && len >= need) {
+			piece = in;
+			in += need;
+			len -= need;
+		} else {
+			if (need > ZSTD_STAGE_SIZE)
+				return -EINVAL;
+			n = min(need - z->staged, len);
+			memcpy(z->stage + z->staged, in, n);
+			z->staged += n;
+			in += n;
+			len -= n;
+			if (z->staged < need)
+				break;
+			piece = z->stage;
+			z->staged = 0;
+		}
+
+		ret = ZSTD_decompressContinue(z->dctx, ds->dst + ds->out,
+					      ds->dst_len - ds->out, piece,
+					      need);
+		if (ZSTD_isError(ret))
+			return decomp_zstd_error(ret);
+		ds->out += ret;
+		if (!ZSTD_nextSrcSizeToDecompress(z->dctx))
+			ds->done = true;
+	}
+
+	return 0;
+}
+
+static void decomp_zstd_end(struct image_decomp_stream *ds)
+{
+	struct decomp_zstd *z = ds->priv;
+
+	free(z->stage);
+	free(z);
+}
+#endif /* ZSTD */
+
+bool image_decomp_can_stream(int comp)
+{
+	switch (comp) {
+	case IH_COMP_NONE:
+		return true;
+	case IH_COMP_GZIP:
+		return CONFIG_IS_ENABLED(GZIP);
+	case IH_COMP_ZSTD:
+		return CONFIG_IS_ENABLED(ZSTD);
+	default:
+		return false;
+	}
+}
+
+int image_decomp_start(struct image_decomp_stream *ds, int comp, void *dst,
+		       size_t dst_len)
+{
+	memset(ds, '\0', sizeof(*ds));
+	ds->comp = comp;
+	ds->dst = dst;
+	ds->dst_len = dst_len;
+
+	switch (comp) {
+	case IH_COMP_NONE:
+		return 0;
+#if CONFIG_IS_ENABLED(GZIP)
+	case IH_COMP_GZIP:
+		return decomp_gzip_start(ds);
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD:
+		return decomp_zstd_start(ds);
+#endif
+	default:
+		return -ENOSYS;
+	}
+}
+
+int image_decomp_feed(struct image_decomp_stream *ds, const void *src,
+		      size_t len)
+{
+	switch (ds->comp) {
+	case IH_COMP_NONE:
+		if (len > ds->dst_len - ds->out)
+			return -ENOSPC;
+		memcpy(ds->dst + ds->out, src, len);
+		ds->out += len;
+		return 0;
+#if CONFIG_IS_ENABLED(GZIP)
+	case IH_COMP_GZIP:
+		/* Like gunzip(), ignore anything after the end */
+		if (ds->done)
+			return 0;
+		return decomp_gzip_feed(ds, src, len);
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD:
+		return decomp_zstd_feed(ds, src, len);
+#endif
+	default:
+		return -ENOSYS;
+	}
+}
+
+int image_decomp_end(struct image_decomp_stream *ds, size_t *lenp)
+{
+	bool done = ds->done;
+
+	switch (ds->comp) {
+	case IH_COMP_NONE:
+		done = true;
+		break;
+#if CONFIG_IS_ENABLED(GZIP)
+	case IH_COMP_GZIP:
+		decomp_gzip_end(ds);
+		break;
+#endif
+#if CONFIG_IS_ENABLED(ZSTD)
+	case IH_COMP_ZSTD:
+		decomp_zstd_end(ds);
+		break;
+#endif
+	default:
+		return -ENOSYS;
+	}
+	ds->priv = NULL;
+
+	if (lenp)
+		*lenp = ds->out;
+
+	return done ? 0 : -EINVAL;
+}
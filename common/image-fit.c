@@ -1271,6 +1271,154 @@ error:
 	return 0;
 }
 
+void fit_image_hash_abort(struct fit_image_hash_stream *hs)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	struct fit_hash_ctx *h;
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		h = &hs->hash[i];
+		if (h->ctx)
+			h->algo->hash_finish(h->algo, h->ctx, value,
+					     sizeof(value));
+		h->ctx = NULL;
+	}
+}
+
+int fit_image_hash_start(struct fit_image_hash_stream *hs, const void *fit,
+			 int image_noffset)
+{
+	struct fit_hash_ctx *h;
+	int noffset;
+	int ignore;
+	char *algo;
+
+	memset(hs, '\0', sizeof(*hs));
+	hs->fit = fit;
+	hs->image_noffset = image_noffset;
+	if (!IMAGE_ENABLE_HASH_STREAM)
+		return -ENOSYS;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		/* Signatures are checked over the data as a whole */
+		if (IMAGE_ENABLE_VERIFY &&
+		    !strncmp(name, FIT_SIG_NODENAME,
+			     strlen(FIT_SIG_NODENAME)))
+			goto unsupported;
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+
+		if (hs->count == FIT_HASH_STREAM_MAX ||
+		    fit_image_hash_get_algo(fit, noffset, &algo))
+			goto unsupported;
+		h = &hs->hash[hs->count++];
+		h->noffset = noffset;
+		h->name = algo;
+
+		if (IMAGE_ENABLE_IGNORE) {
+			fit_image_hash_get_ignore(fit, noffset, &ignore);
+			if (ignore)
+				continue;
+		}
+		if (hash_progressive_lookup_algo(algo, &h->algo) ||
+		    h->algo->hash_init(h->algo, &h->ctx))
+			goto unsupported;
+	}
+	if (noffset == -FDT_ERR_TRUNCATED || noffset == -FDT_ERR_BADSTRUCTURE)
+		goto unsupported;
+
+	return 0;
+
+unsupported:
+	fit_image_hash_abort(hs);
+	return -ENOSYS;
+}
+
+void fit_image_hash_update(struct fit_image_hash_stream *hs, const void *data,
+			   size_t size)
+{
+	struct fit_hash_ctx *h;
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		h = &hs->hash[i];
+		/* The context is freed if there is an error */
+		if (h->ctx &&
+		    h->algo->hash_update(h->algo, h->ctx, data, size, 0))
+			h->ctx = NULL;
+	}
+}
+
+int fit_image_hash_finish(struct fit_image_hash_stream *hs)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	struct fit_hash_ctx *h;
+	char *err_msg = "";
+	uint8_t *fit_value;
+	int fit_value_len;
+	int verify_all = 1;
+	int noffset = 0;
+	void *ctx;
+	int i;
+
+	/* There are no signatures, so this only fails if some are needed */
+	if (IMAGE_ENABLE_VERIFY &&
+	    fit_image_verify_required_sigs(hs->fit, hs->image_noffset, NULL,
+					   0, gd_fdt_blob(), &verify_all)) {
+		err_msg = "Unable to verify required signature";
+		goto error;
+	}
+
+	for (i = 0; i < hs->count; i++) {
+		h = &hs->hash[i];
+		noffset = h->noffset;
+		printf("%s", h->name);
+		if (!h->algo) {
+			printf("-skipped ");
+			continue;
+		}
+
+		ctx = h->ctx;
+		h->ctx = NULL;
+		if (!ctx || h->algo->hash_finish(h->algo, ctx, value,
+						 sizeof(value))) {
+			err_msg = "Can't calculate hash";
+			goto error;
+		}
+		/* Like crc32_wd_buf(), FIT stores it big-endian */
+		if (!strcmp(h->name, "crc32"))
+			*((uint32_t *)value) =
+				cpu_to_uimage(*((uint32_t *)value));
+
+		if (fit_image_hash_get_value(hs->fit, noffset, &fit_value,
+					     &fit_value_len)) {
+			err_msg = "Can't get hash value property";
+			goto error;
+		}
+		if (h->algo->digest_size != fit_value_len) {
+			err_msg = "Bad hash value len";
+			goto error;
+		} else if (memcmp(value, fit_value, fit_value_len) != 0) {
+			err_msg = "Bad hash value";
+			goto error;
+		}
+		puts("+ ");
+	}
+
+	return 1;
+
+error:
+	fit_image_hash_abort(hs);
+	printf(" error!\n%s for '%s' hash node in '%s' image node\n",
+	       err_msg, fit_get_name(hs->fit, noffset, NULL),
+	       fit_get_name(hs->fit, hs->image_noffset, NULL));
+	return 0;
+}
+
 /**
  * fit_image_verify - verify data integrity
  * @fit: pointer to the FIT format image header
@@ -9,7 +9,10 @@
 #include <fpga.h>
 #include <gzip.h>
 #include <image.h>
+#include <malloc.h>
+#include <memalign.h>
 #include <linux/libfdt.h>
+#include <linux/sizes.h>
 #include <spl.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -18,6 +21,9 @@ DECLARE_GLOBAL_DATA_PTR;
 #define CONFIG_SYS_BOOTM_LEN	(64 << 20)
 #endif
 
+/* Compressed data is read in pieces of this size while decompressing */
+#define SPL_FIT_STREAM_CHUNK	SZ_64K
+
 __weak void board_spl_fit_post_load(ulong load_addr, size_t length)
 {
 }
@@ -153,6 +159,114 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+/*
+ * External data is decompressed, and its hashes checked, while it is read.
+ * That is not possible if all of it is needed in memory to post-process
+ * it. Uncompressed data is only read that way to check its hashes.
+ */
+static bool spl_fit_can_stream(int comp)
+{
+	if (IS_ENABLED(CONFIG_SPL_FIT_IMAGE_POST_PROCESS) ||
+	    !image_decomp_can_stream(comp))
+		return false;
+	if (IS_ENABLED(CONFIG_SPL_FIT_SIGNATURE))
+		return IMAGE_ENABLE_HASH_STREAM;
+
+	return comp != IH_COMP_NONE;
+}
+
+/**
+ * spl_fit_stream_image(): read external data and decompress it on the fly
+ * @info:	points to information about the device to load data from
+ * @sector:	the start sector of the FIT image on the device
+ * @fit:	points to the flattened device tree blob describing the FIT
+ *		image
+ * @node:	offset of the DT node describing the image to load
+ * @offset:	position of the data relative to @sector, in bytes
+ * @length:	size of the compressed data
+ * @comp:	compression of the data (IH_COMP_...)
+ * @load_addr:	where to decompress to
+ * @unc_len:	returns the size of the uncompressed data
+ *
+ * The data is read in pieces of SPL_FIT_STREAM_CHUNK bytes, each of which
+ * is hashed and decompressed before the next one is read. The compressed
+ * image is therefore never held in memory as a whole, nor read again to
+ * check its hashes.
+ *
+ * Return:	0 on success, -ENOSYS if the image must be verified as a
+ *		whole, or another negative error number.
+ */
+static int spl_fit_stream_image(struct spl_load_info *info, ulong sector,
+				void *fit, int node, int offset, size_t length,
+				int comp, ulong load_addr, size_t *unc_len)
+{
+	struct fit_image_hash_stream hs;
+	bool verify = IS_ENABLED(CONFIG_SPL_FIT_SIGNATURE);
+	struct image_decomp_stream ds;
+	ulong unit = info->filename ? 1 : info->bl_len;
+	ulong chunk = max(SPL_FIT_STREAM_CHUNK / unit, 1UL);
+	ulong left, count, skip, n;
+	void *buf;
+	int ret;
+
+	if (verify) {
+		if (fit_image_hash_start(&hs, fit, node))
+			return -ENOSYS;
+		printf("## Checking hash(es) for Image %s ... ",
+		       fit_get_name(fit, node, NULL));
+	}
+
+	buf = malloc_cache_aligned(chunk * unit);
+	ret = buf ? image_decomp_start(&ds, comp, (void *)load_addr,
+				       CONFIG_SYS_BOOTM_LEN) : -ENOMEM;
+	if (ret)
+		goto out;
+
+	sector += get_aligned_image_offset(info, offset);
+	skip = get_aligned_image_overhead(info, offset);
+	left = get_aligned_image_size(info, length, offset);
+	while (left) {
+		count = min(left, chunk);
+		if (info->read(info, sector, count, buf) != count) {
+			ret = -EIO;
+			break;
+		}
+		n = min(count * unit - skip, (ulong)length);
+		if (verify)
+			fit_image_hash_update(&hs, buf + skip, n);
+		ret = image_decomp_feed(&ds, buf + skip, n);
+		if (ret)
+			break;
+		sector += count;
+		left -= count;
+		length -= n;
+		skip = 0;
+	}
+
+	if (!ret)
+		ret = image_decomp_end(&ds, unc_len);
+	else
+		image_decomp_end(&ds, NULL);
+	if (ret == -EINVAL || ret == -ENOSPC) {
+		puts("Uncompressing error\n");
+		ret = -EIO;
+	}
+
+out:
+	free(buf);
+	if (verify) {
+		if (ret) {
+			fit_image_hash_abort(&hs);
+		} else {
+			if (!fit_image_hash_finish(&hs))
+				return -EPERM;
+			puts("OK\n");
+		}
+	}
+
+	return ret;
+}
+
 /**
  * spl_load_fit_image(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -183,9 +297,11 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	ulong overhead;
 	int nr_sectors;
 	int align_len = ARCH_DMA_MINALIGN - 1;
-	uint8_t image_comp = -1, type = -1;
+	uint8_t image_comp = IH_COMP_NONE, type = -1;
 	const void *data;
 	bool external_data = false;
+	void *comp_buf = NULL;
+	int ret;
 
 	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) ||
 	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP))) {
@@ -195,7 +311,8 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 			debug("%s ", genimg_get_type_name(type));
 	}
 
-	if (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP)) {
+	if ((IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP)) ||
+	    IS_ENABLED(CONFIG_SPL_ZSTD)) {
 		if (fit_image_get_comp(fit, node, &image_comp))
 			puts("Cannot get image compression format.\n");
 		else
@@ -220,13 +337,43 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		load_ptr = (load_addr + align_len) & ~align_len;
 		length = len;
 
+		if (spl_fit_can_stream(image_comp)) {
+			debug("External data: dst=%lx, offset=%x, size=%lx\n",
+			      load_addr, offset, (unsigned long)length);
+			ret = spl_fit_stream_image(info, sector, fit, node,
+						   offset, length, image_comp,
+						   load_addr, &length);
+			if (!ret)
+				goto done;
+			if (ret != -ENOSYS)
+				return ret;
+		}
+
 		overhead = get_aligned_image_overhead(info, offset);
 		nr_sectors = get_aligned_image_size(info, length, offset);
 
+		/*
+		 * The output would overwrite the input still to be read, so
+		 * compressed data goes to a separate buffer
+		 */
+		if ((IS_ENABLED(CONFIG_SPL_GZIP) &&
+		     image_comp == IH_COMP_GZIP) ||
+		    (IS_ENABLED(CONFIG_SPL_ZSTD) &&
+		     image_comp == IH_COMP_ZSTD)) {
+			size = info->filename ? nr_sectors :
+				nr_sectors * info->bl_len;
+			comp_buf = malloc_cache_aligned(size);
+			if (!comp_buf)
+				return -ENOMEM;
+			load_ptr = (ulong)comp_buf;
+		}
+
 		if (info->read(info,
 			       sector + get_aligned_image_offset(info, offset),
-			       nr_sectors, (void *)load_ptr) != nr_sectors)
+			       nr_sectors, (void *)load_ptr) != nr_sectors) {
+			free(comp_buf);
 			return -EIO;
+		}
 
 		debug("External data: dst=%lx, offset=%x, size=%lx\n",
 		      load_ptr, offset, (unsigned long)length);
@@ -246,8 +393,10 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	printf("## Checking hash(es) for Image %s ... ",
 	       fit_get_name(fit, node, NULL));
 	if (!fit_image_verify_with_data(fit, node,
-					 src, length))
+					 src, length)) {
+		free(comp_buf);
 		return -EPERM;
+	}
 	puts("OK\n");
 #endif
 
@@ -257,16 +406,30 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 
 	if (IS_ENABLED(CONFIG_SPL_GZIP) && image_comp == IH_COMP_GZIP) {
 		size = length;
-		if (gunzip((void *)load_addr, CONFIG_SYS_BOOTM_LEN,
-			   src, &size)) {
+		ret = gunzip((void *)load_addr, CONFIG_SYS_BOOTM_LEN, src,
+			     &size);
+		free(comp_buf);
+		if (ret) {
 			puts("Uncompressing error\n");
 			return -EIO;
 		}
 		length = size;
+	} else if (IS_ENABLED(CONFIG_SPL_ZSTD) && image_comp == IH_COMP_ZSTD) {
+		size_t unc_len = CONFIG_SYS_BOOTM_LEN;
+
+		ret = zstd_decompress_buf(src, length, (void *)load_addr,
+					  &unc_len);
+		free(comp_buf);
+		if (ret) {
+			puts("Uncompressing error\n");
+			return -EIO;
+		}
+		length = unc_len;
 	} else {
 		memcpy((void *)load_addr, src, length);
 	}
 
+done:
 	if (image_info) {
 		image_info->load_addr = load_addr;
 		image_info->size = length;
@@ -26,6 +26,9 @@ static const char *if_typename_str[IF_TYPE_COUNT] = {
 	[IF_TYPE_VIRTIO]	= "virtio",
 };
 
+/* Last generation number given to a block device, see blk_invalidate() */
+static unsigned int blk_gen;
+
 static enum uclass_id if_type_uclass_id[IF_TYPE_COUNT] = {
 	[IF_TYPE_IDE]		= UCLASS_IDE,
 	[IF_TYPE_SCSI]		= UCLASS_SCSI,
@@ -334,6 +337,104 @@ ulong blk_write_devnum(enum if_type if_type, int devnum, lbaint_t start,
 	return blk_dwrite(desc, start, blkcnt, buffer);
 }
 
+/* Complete the request at the head of the queue */
+static void blk_req_done(struct blk_desc *desc, int ret)
+{
+	struct blk_req *req = desc->reqs;
+
+	desc->reqs = req->next;
+	desc->req_started = false;
+	if (!ret && req->blks != req->blkcnt)
+		ret = -EIO;
+	req->ret = ret;
+	if (!ret)
+		blkcache_fill(desc->if_type, desc->devnum, req->start,
+			      req->blkcnt, desc->blksz, req->buffer);
+}
+
+int blk_dpoll(struct blk_desc *desc)
+{
+	struct udevice *dev = desc->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+	int ret;
+
+	while (desc->reqs) {
+		if (!desc->req_started) {
+			ret = ops->read_start(dev, desc->reqs);
+			if (ret == -EBUSY)
+				return ret;
+			if (ret) {
+				blk_req_done(desc, ret);
+				continue;
+			}
+			desc->req_started = true;
+		}
+		ret = ops->read_poll(dev, desc->reqs);
+		if (ret == -EBUSY)
+			return ret;
+		blk_req_done(desc, ret);
+	}
+
+	return 0;
+}
+
+/* Wait for all the queued reads, before using the device otherwise */
+static void blk_drain(struct blk_desc *desc)
+{
+	while (blk_dpoll(desc) == -EBUSY)
+		;
+}
+
+int blk_dread_submit(struct blk_desc *desc, struct blk_req *req)
+{
+	struct udevice *dev = desc->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_req **tail;
+	ulong blks;
+
+	if (!ops->read)
+		return -ENOSYS;
+
+	req->blks = 0;
+	req->ret = -EINPROGRESS;
+	req->next = NULL;
+
+	if (!ops->read_start) {
+		blks = blk_dread(desc, req->start, req->blkcnt, req->buffer);
+		if (IS_ERR_VALUE(blks)) {
+			req->ret = blks;
+		} else {
+			req->blks = blks;
+			req->ret = blks == req->blkcnt ? 0 : -EIO;
+		}
+		return 0;
+	}
+
+	/* Later requests must not complete ahead of this one */
+	if (!desc->reqs && blkcache_read(desc->if_type, desc->devnum,
+					 req->start, req->blkcnt, desc->blksz,
+					 req->buffer)) {
+		req->blks = req->blkcnt;
+		req->ret = 0;
+		return 0;
+	}
+
+	for (tail = &desc->reqs; *tail; tail = &(*tail)->next)
+		;
+	*tail = req;
+	blk_dpoll(desc);
+
+	return 0;
+}
+
+int blk_req_wait(struct blk_desc *desc, struct blk_req *req)
+{
+	while (req->ret == -EINPROGRESS)
+		blk_dpoll(desc);
+
+	return req->ret;
+}
+
 int blk_select_hwpart(struct udevice *dev, int hwpart)
 {
 	const struct blk_ops *ops = blk_get_ops(dev);
@@ -343,6 +444,8 @@ int blk_select_hwpart(struct udevice *dev, int hwpart)
 	if (!ops->select_hwpart)
 		return 0;
 
+	blk_drain(dev_get_uclass_platdata(dev));
+
 	return ops->select_hwpart(dev, hwpart);
 }
 
@@ -432,13 +535,29 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
 	ulong blks_read;
+	lbaint_t ra;
+	void *rabuf;
 
 	if (!ops->read)
 		return -ENOSYS;
 
+	blk_drain(block_dev);
+
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
+
+	/* Read ahead into the cache if this continues the previous miss */
+	ra = blkcache_readahead(block_dev->if_type, block_dev->devnum,
+				start, blkcnt, block_dev->blksz, &rabuf);
+	if (ra && start + ra <= block_dev->lba &&
+	    ops->read(dev, start, ra, rabuf) == ra) {
+		memcpy(buffer, rabuf, blkcnt * block_dev->blksz);
+		blkcache_fill(block_dev->if_type, block_dev->devnum,
+			      start, ra, block_dev->blksz, rabuf);
+		return blkcnt;
+	}
+
 	blks_read = ops->read(dev, start, blkcnt, buffer);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
@@ -447,6 +566,12 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	return blks_read;
 }
 
+void blk_invalidate(struct blk_desc *desc)
+{
+	blkcache_invalidate(desc->if_type, desc->devnum);
+	desc->gen = ++blk_gen;
+}
+
 unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt, const void *buffer)
 {
@@ -456,7 +581,8 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->write)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_drain(block_dev);
+	blk_invalidate(block_dev);
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -469,7 +595,8 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->erase)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_drain(block_dev);
+	blk_invalidate(block_dev);
 	return ops->erase(dev, start, blkcnt);
 }
 
@@ -584,6 +711,7 @@ int blk_create_device(struct udevice *parent, const char *drv_name,
 	desc->part_type = PART_TYPE_UNKNOWN;
 	desc->bdev = dev;
 	desc->devnum = devnum;
+	desc->gen = ++blk_gen;
 	*devp = dev;
 
 	return 0;
@@ -7,136 +7,327 @@
 #include <config.h>
 #include <common.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <linux/ctype.h>
-#include <linux/list.h>
+#include <linux/log2.h>
 
-struct block_cache_node {
-	struct list_head lh;
+/*
+ * The cache is made of lines of max_blocks_per_entry blocks, aligned to that
+ * size on the device. Lines are grouped in sets of BLKCACHE_WAYS; a line can
+ * only be stored in the set selected by hashing its device and position, so
+ * a lookup only has to look at the lines of one set. Within a set the least
+ * recently used line is replaced.
+ */
+#define BLKCACHE_WAYS		4
+/* Largest line: the blocks of a line are tracked in a u32 bitmap */
+#define BLKCACHE_MAX_LINE	32
+/* Lines read ahead when a miss follows the previous one */
+#define BLKCACHE_READAHEAD	4
+
+#ifndef CONFIG_BLOCK_CACHE_SIZE
+#define CONFIG_BLOCK_CACHE_SIZE	128
+#endif
+
+struct block_cache_line {
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
+	lbaint_t start;		/* first block, aligned to the line */
 	unsigned long blksz;
+	u32 valid;		/* bitmap of the blocks held, 0 if unused */
+	unsigned int age;	/* value of cache_clock at last use */
+	unsigned long size;	/* size of the buffer at cache */
 	char *cache;
 };
 
-static LIST_HEAD(block_cache);
+static struct block_cache_line *block_cache;
+static unsigned int cache_sets;
+static unsigned int cache_clock;
+
+/* End of the last read that missed, to detect sequential reads */
+static int last_iftype = -1;
+static int last_devnum;
+static lbaint_t last_end;
+static char *readahead_buf;
+static unsigned long readahead_size;
 
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_entries = CONFIG_BLOCK_CACHE_SIZE * 1024 / (8 * 512),
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
+static void cache_geometry(void)
+{
+	if (!_stats.max_entries) {
+		_stats.ways = 0;
+		cache_sets = 0;
+	} else {
+		_stats.ways = min_t(unsigned int, BLKCACHE_WAYS,
+				    _stats.max_entries);
+		cache_sets = rounddown_pow_of_two(_stats.max_entries /
+						  _stats.ways);
+	}
+	_stats.sets = cache_sets;
+}
+
+/* Allocate the lines on first use */
+static int cache_init(void)
+{
+	if (block_cache)
+		return 0;
+	if (!_stats.max_entries)
+		return -ENOSPC;
+
+	cache_geometry();
+	block_cache = calloc(cache_sets * _stats.ways, sizeof(*block_cache));
+	if (!block_cache)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void cache_free(void)
+{
+	unsigned int i;
+
+	if (block_cache) {
+		for (i = 0; i < cache_sets * _stats.ways; i++)
+			free(block_cache[i].cache);
+		free(block_cache);
+		block_cache = NULL;
+	}
+	free(readahead_buf);
+	readahead_buf = NULL;
+	readahead_size = 0;
+	_stats.entries = 0;
+}
+
+static struct block_cache_line *cache_set(int iftype, int devnum,
+					  lbaint_t line)
+{
+	u32 hash = (u32)line ^ (u32)((u64)line >> 32);
+
+	hash ^= ((iftype << 8) ^ devnum) * 0x9e3779b9;
+
+	return block_cache + (hash & (cache_sets - 1)) * _stats.ways;
+}
+
+static struct block_cache_line *cache_find(int iftype, int devnum,
+					   lbaint_t start,
 					   unsigned long blksz)
 {
-	struct block_cache_node *node;
+	lbaint_t line = start / _stats.max_blocks_per_entry;
+	struct block_cache_line *node = cache_set(iftype, devnum, line);
+	struct block_cache_line *end = node + _stats.ways;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
+	start = line * _stats.max_blocks_per_entry;
+	for (; node < end; node++)
+		if (node->valid &&
+		    (node->iftype == iftype) &&
 		    (node->devnum == devnum) &&
 		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
+		    (node->start == start))
 			return node;
+
+	return NULL;
+}
+
+/* Get the line for @start, replacing the least recently used one */
+static struct block_cache_line *cache_alloc(int iftype, int devnum,
+					    lbaint_t start,
+					    unsigned long blksz)
+{
+	lbaint_t line = start / _stats.max_blocks_per_entry;
+	struct block_cache_line *node = cache_set(iftype, devnum, line);
+	struct block_cache_line *end = node + _stats.ways;
+	struct block_cache_line *lru = node;
+	unsigned long bytes = blksz * _stats.max_blocks_per_entry;
+
+	for (; node < end; node++) {
+		if (!node->valid) {
+			lru = node;
+			break;
 		}
-	return 0;
+		if (cache_clock - node->age > cache_clock - lru->age)
+			lru = node;
+	}
+
+	if (lru->valid) {
+		debug("drop: start " LBAF "\n", lru->start);
+		_stats.evictions++;
+	} else {
+		_stats.entries++;
+	}
+
+	if (lru->size < bytes) {
+		free(lru->cache);
+		lru->cache = malloc(bytes);
+		if (!lru->cache) {
+			lru->size = 0;
+			lru->valid = 0;
+			_stats.entries--;
+			return NULL;
+		}
+		lru->size = bytes;
+	}
+
+	lru->iftype = iftype;
+	lru->devnum = devnum;
+	lru->start = line * _stats.max_blocks_per_entry;
+	lru->blksz = blksz;
+	lru->valid = 0;
+
+	return lru;
+}
+
+/* Mask of @blkcnt blocks from block @first within a line */
+static u32 cache_mask(lbaint_t first, lbaint_t blkcnt)
+{
+	u32 mask = blkcnt >= 32 ? ~0U : (1U << blkcnt) - 1;
+
+	return mask << first;
 }
 
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	unsigned int line_blocks = _stats.max_blocks_per_entry;
+	struct block_cache_line *node;
+	char *dst = buffer;
+	lbaint_t blk, first, cnt;
+
+	if (!block_cache || blkcnt > line_blocks)
+		goto miss;
+
+	/* Check that every line involved holds the blocks we need */
+	for (blk = start; blk < start + blkcnt; blk += cnt) {
+		first = blk % line_blocks;
+		cnt = min_t(lbaint_t, line_blocks - first,
+			    start + blkcnt - blk);
+		node = cache_find(iftype, devnum, blk, blksz);
+		if (!node)
+			goto miss;
+		if ((node->valid & cache_mask(first, cnt)) !=
+		    cache_mask(first, cnt))
+			goto miss;
 	}
 
+	cache_clock++;
+	for (blk = start; blk < start + blkcnt; blk += cnt) {
+		first = blk % line_blocks;
+		cnt = min_t(lbaint_t, line_blocks - first,
+			    start + blkcnt - blk);
+		node = cache_find(iftype, devnum, blk, blksz);
+		memcpy(dst, node->cache + first * blksz, cnt * blksz);
+		dst += cnt * blksz;
+		node->age = cache_clock;
+	}
+	debug("hit: start " LBAF ", count " LBAFU "\n",
+	      start, blkcnt);
+	++_stats.hits;
+	return 1;
+
+miss:
 	debug("miss: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 	++_stats.misses;
 	return 0;
 }
 
+lbaint_t blkcache_readahead(int iftype, int devnum,
+			    lbaint_t start, lbaint_t blkcnt,
+			    unsigned long blksz, void **bufp)
+{
+	lbaint_t count = BLKCACHE_READAHEAD * _stats.max_blocks_per_entry;
+	bool sequential;
+
+	sequential = (iftype == last_iftype) && (devnum == last_devnum) &&
+		     (start == last_end);
+	last_iftype = iftype;
+	last_devnum = devnum;
+	last_end = start + blkcnt;
+
+	if (!sequential || blkcnt > _stats.max_blocks_per_entry ||
+	    cache_init())
+		return 0;
+
+	/* Stop at the end of a line so that the next miss is aligned */
+	count -= (start + count) % _stats.max_blocks_per_entry;
+	if (count <= blkcnt)
+		return 0;
+
+	if (readahead_size < count * blksz) {
+		free(readahead_buf);
+		/* The block driver reads into this, perhaps by DMA */
+		readahead_buf = malloc_cache_aligned(count * blksz);
+		if (!readahead_buf) {
+			readahead_size = 0;
+			return 0;
+		}
+		readahead_size = count * blksz;
+	}
+
+	debug("readahead: start " LBAF ", count " LBAFU "\n", start, count);
+	last_end = start + count;
+	*bufp = readahead_buf;
+
+	return count;
+}
+
 void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	unsigned int line_blocks = _stats.max_blocks_per_entry;
+	struct block_cache_line *node;
+	const char *src = buffer;
+	lbaint_t blk, first, cnt;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
+	/* don't cache big stuff, unless we read it ahead on purpose */
+	if (blkcnt > line_blocks && buffer != readahead_buf)
 		return;
 
-	if (_stats.max_entries == 0)
+	if (cache_init())
 		return;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
-	}
-
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
-		}
-	}
-
 	debug("fill: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	cache_clock++;
+	for (blk = start; blk < start + blkcnt; blk += cnt) {
+		first = blk % line_blocks;
+		cnt = min_t(lbaint_t, line_blocks - first,
+			    start + blkcnt - blk);
+		node = cache_find(iftype, devnum, blk, blksz);
+		if (!node)
+			node = cache_alloc(iftype, devnum, blk, blksz);
+		if (!node)
+			return;
+		memcpy(node->cache + first * blksz, src, cnt * blksz);
+		src += cnt * blksz;
+		node->valid |= cache_mask(first, cnt);
+		node->age = cache_clock;
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	unsigned int i;
+	struct block_cache_line *node;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
+	if (iftype == last_iftype && devnum == last_devnum)
+		last_iftype = -1;
+
+	if (!block_cache)
+		return;
+
+	for (i = 0; i < cache_sets * _stats.ways; i++) {
+		node = &block_cache[i];
+		if (node->valid &&
+		    (node->iftype == iftype) &&
 		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
+			node->valid = 0;
 			--_stats.entries;
 		}
 	}
@@ -144,17 +335,13 @@ void blkcache_invalidate(int iftype, int devnum)
 
 void blkcache_configure(unsigned blocks, unsigned entries)
 {
-	struct block_cache_node *node;
+	blocks = clamp(blocks, 1U, (unsigned)BLKCACHE_MAX_LINE);
+
 	if ((blocks != _stats.max_blocks_per_entry) ||
 	    (entries != _stats.max_entries)) {
 		/* invalidate cache */
-		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
-		}
-		_stats.entries = 0;
+		cache_free();
+		last_iftype = -1;
 	}
 
 	_stats.max_blocks_per_entry = blocks;
@@ -162,11 +349,14 @@ void blkcache_configure(unsigned blocks, unsigned entries)
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
 {
+	cache_geometry();
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
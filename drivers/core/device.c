@@ -375,7 +375,7 @@ int device_probe(struct udevice *dev)
 		ret = seq;
 		goto fail;
 	}
-	dev->seq = seq;
+	uclass_set_seq(dev, seq);
 
 	dev->flags |= DM_FLAG_ACTIVATED;
 
@@ -445,7 +445,7 @@ fail_uclass:
 fail:
 	dev->flags &= ~DM_FLAG_ACTIVATED;
 
-	dev->seq = -1;
+	uclass_set_seq(dev, -1);
 	device_free(dev);
 
 	return ret;
@@ -819,6 +819,13 @@ int device_set_name(struct udevice *dev, const char *name)
 	return 0;
 }
 
+void dev_set_ofnode(struct udevice *dev, ofnode node)
+{
+	uclass_index_remove_device(dev);
+	dev->node = node;
+	uclass_index_add_device(dev);
+}
+
 #if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
 bool device_is_compatible(struct udevice *dev, const char *compat)
 {
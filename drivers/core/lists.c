@@ -15,7 +15,171 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <linux/compiler.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+/*
+ * Index of the driver linker lists
+ *
+ * Driver names and compatible strings are hashed into open-addressed
+ * tables, kept at most half full (three-quarters before relocation, where
+ * malloc() space is short), and uclass drivers are looked up by ID.
+ * Each slot holds the position of the driver in its linker list plus one,
+ * or 0 if empty. Where several drivers share a name or a compatible string
+ * the first one in the linker list is indexed, as a linear search would
+ * find it.
+ */
+struct lists_index {
+	uint name_size;
+	uint compat_size;
+	u16 *name;			/* driver name -> driver */
+	u16 *compat;			/* compatible string -> driver */
+	u16 uclass[UCLASS_COUNT];	/* uclass ID -> uclass driver */
+};
+
+/* FNV-1a */
+static uint lists_hash(const char *str)
+{
+	uint hash = 2166136261U;
+
+	while (*str)
+		hash = (hash ^ (u8)*str++) * 16777619U;
+
+	return hash;
+}
+
+static bool lists_match_name(struct driver *drv, const char *name)
+{
+	return !strcmp(drv->name, name);
+}
+
+static bool lists_match_compat(struct driver *drv, const char *compat)
+{
+	const struct udevice_id *of_id;
+
+	for (of_id = drv->of_match; of_id && of_id->compatible; of_id++) {
+		if (!strcmp(of_id->compatible, compat))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Find the slot holding the driver for @key in @table, or the empty slot
+ * where it would go
+ */
+static u16 *lists_index_slot(u16 *table, uint size, const char *key,
+			     bool (*match)(struct driver *drv, const char *key))
+{
+	struct driver *drv = ll_entry_start(struct driver, driver);
+	uint mask = size - 1;
+	uint i;
+
+	for (i = lists_hash(key) & mask; table[i]; i = (i + 1) & mask) {
+		if (match(&drv[table[i] - 1], key))
+			break;
+	}
+
+	return &table[i];
+}
+
+static struct driver *lists_index_lookup(u16 *table, uint size,
+					 const char *key,
+					 bool (*match)(struct driver *drv,
+						       const char *key))
+{
+	struct driver *drv = ll_entry_start(struct driver, driver);
+	u16 *slot;
+
+	if (!size)
+		return NULL;
+	slot = lists_index_slot(table, size, key, match);
+
+	return *slot ? &drv[*slot - 1] : NULL;
+}
+
+/* Number of slots for a table of @n keys, always leaving one empty */
+static uint lists_index_size(uint n)
+{
+	if (!n)
+		return 0;
+	if (!(gd->flags & GD_FLG_RELOC))
+		return roundup_pow_of_two(n + n / 3 + 1);
+
+	return roundup_pow_of_two(2 * n);
+}
+
+int lists_index_init(void)
+{
+	struct driver *drv = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct uclass_driver *uclass =
+		ll_entry_start(struct uclass_driver, uclass);
+	const int n_uclass = ll_entry_count(struct uclass_driver, uclass);
+	const struct udevice_id *of_id;
+	struct lists_index *idx;
+	uint n_compat = 0;
+	u16 *slot;
+	int i;
+
+	if (gd->dm_index)
+		return 0;
+	if (n_ents >= U16_MAX || n_uclass >= U16_MAX)
+		return -E2BIG;
+
+	if (CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)) {
+		for (i = 0; i < n_ents; i++) {
+			of_id = drv[i].of_match;
+			for (; of_id && of_id->compatible; of_id++)
+				n_compat++;
+		}
+	}
+
+	idx = calloc(1, sizeof(*idx));
+	if (!idx)
+		return -ENOMEM;
+	idx->name_size = lists_index_size(n_ents);
+	idx->compat_size = lists_index_size(n_compat);
+	idx->name = calloc(idx->name_size + idx->compat_size, sizeof(u16));
+	if (!idx->name) {
+		free(idx);
+		return -ENOMEM;
+	}
+	idx->compat = idx->name + idx->name_size;
+
+	for (i = 0; i < n_ents; i++) {
+		slot = lists_index_slot(idx->name, idx->name_size, drv[i].name,
+					lists_match_name);
+		if (!*slot)
+			*slot = i + 1;
+		if (!n_compat)
+			continue;
+		for (of_id = drv[i].of_match; of_id && of_id->compatible;
+		     of_id++) {
+			slot = lists_index_slot(idx->compat, idx->compat_size,
+						of_id->compatible,
+						lists_match_compat);
+			if (!*slot)
+				*slot = i + 1;
+		}
+	}
+
+	for (i = 0; i < n_uclass; i++) {
+		if (uclass[i].id >= 0 && uclass[i].id < UCLASS_COUNT &&
+		    !idx->uclass[uclass[i].id])
+			idx->uclass[uclass[i].id] = i + 1;
+	}
+	gd->dm_index = idx;
+
+	return 0;
+}
+#endif /* DM_DRIVER_INDEX */
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -24,6 +188,13 @@ struct driver *lists_driver_lookup_name(const char *name)
 	const int n_ents = ll_entry_count(struct driver, driver);
 	struct driver *entry;
 
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+	if (gd->dm_index)
+		return lists_index_lookup(gd->dm_index->name,
+					  gd->dm_index->name_size, name,
+					  lists_match_name);
+#endif
+
 	for (entry = drv; entry != drv + n_ents; entry++) {
 		if (!strcmp(name, entry->name))
 			return entry;
@@ -40,6 +211,14 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id)
 	const int n_ents = ll_entry_count(struct uclass_driver, uclass);
 	struct uclass_driver *entry;
 
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+	if (gd->dm_index) {
+		if (id < 0 || id >= UCLASS_COUNT || !gd->dm_index->uclass[id])
+			return NULL;
+		return &uclass[gd->dm_index->uclass[id] - 1];
+	}
+#endif
+
 	for (entry = uclass; entry != uclass + n_ents; entry++) {
 		if (entry->id == id)
 			return entry;
@@ -122,11 +301,37 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   bool pre_reloc_only)
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **of_idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+#if CONFIG_IS_ENABLED(DM_DRIVER_INDEX)
+	if (gd->dm_index) {
+		entry = lists_index_lookup(gd->dm_index->compat,
+					   gd->dm_index->compat_size, compat,
+					   lists_match_compat);
+		if (entry &&
+		    !driver_check_compatible(entry->of_match, of_idp, compat))
+			return entry;
+
+		return NULL;
+	}
+#endif
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, of_idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -163,13 +368,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		pr_debug("   - attempt to match compatible string '%s'\n",
 			 compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		entry = lists_driver_lookup_compat(compat, &id);
+		if (!entry)
 			continue;
 
 		if (pre_reloc_only) {
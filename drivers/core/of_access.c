@@ -119,19 +119,35 @@ int of_simple_size_cells(const struct device_node *np)
 	return 2;
 }
 
+u32 of_prop_hash(const char *name)
+{
+	u32 hash = 2166136261U;
+
+	/* FNV-1a */
+	while (*name)
+		hash = (hash ^ (u8)*name++) * 16777619;
+
+	return hash;
+}
+
 struct property *of_find_property(const struct device_node *np,
 				  const char *name, int *lenp)
 {
-	struct property *pp;
+	struct property *pp = NULL;
+	u32 hash, bits;
 
 	if (!np)
 		return NULL;
 
-	for (pp = np->properties; pp; pp = pp->next) {
-		if (strcmp(pp->name, name) == 0) {
-			if (lenp)
-				*lenp = pp->length;
-			break;
+	hash = of_prop_hash(name);
+	bits = of_prop_filter(hash);
+	if ((np->prop_filter & bits) == bits) {
+		for (pp = np->properties; pp; pp = pp->next) {
+			if (pp->hash == hash && strcmp(pp->name, name) == 0) {
+				if (lenp)
+					*lenp = pp->length;
+				break;
+			}
 		}
 	}
 	if (!pp && lenp)
@@ -825,7 +825,7 @@ ofnode ofnode_by_prop_value(ofnode from, const char *propname,
 int ofnode_write_prop(ofnode node, const char *propname, int len,
 		      const void *value)
 {
-	const struct device_node *np = ofnode_to_np(node);
+	struct device_node *np = (struct device_node *)ofnode_to_np(node);
 	struct property *pp;
 	struct property *pp_last = NULL;
 	struct property *new;
@@ -863,6 +863,7 @@ int ofnode_write_prop(ofnode node, const char *propname, int len,
 	new->value = (void *)value;
 	new->length = len;
 	new->next = NULL;
+	of_prop_add_hash(np, new);
 
 	pp_last->next = new;
 
@@ -144,6 +144,16 @@ int dm_init(bool of_live)
 	fix_uclass();
 	fix_devices();
 #endif
+	/*
+	 * Without the index, lookups fall back to searching the lists. Before
+	 * relocation it is only built if the board asks for it.
+	 */
+	if (CONFIG_IS_ENABLED(DM_DRIVER_INDEX) &&
+	    (IS_ENABLED(CONFIG_SPL_BUILD) ||
+	     IS_ENABLED(CONFIG_DM_DRIVER_INDEX_PRE_RELOC) ||
+	     (gd->flags & GD_FLG_RELOC)) &&
+	    lists_index_init())
+		debug("Cannot index drivers\n");
 
 	ret = device_bind_by_name(NULL, false, &root_info, &DM_ROOT_NON_CONST);
 	if (ret)
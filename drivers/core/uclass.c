@@ -101,6 +101,382 @@ fail_mem:
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/* Marks a hash table slot whose device has been removed from the index */
+#define UCLASS_INDEX_DELETED	((struct udevice *)-1L)
+
+/* Size of the smallest hash table, as log2 of the number of slots */
+#define UCLASS_INDEX_MIN_BITS	4
+
+/**
+ * struct uclass_hash_entry - A slot in a uclass index hash table
+ *
+ * @key: ofnode (as its of_offset member) or phandle of the device
+ * @dev: Device, NULL if the slot is free, or UCLASS_INDEX_DELETED
+ */
+struct uclass_hash_entry {
+	ulong key;
+	struct udevice *dev;
+};
+
+/**
+ * struct uclass_hash - Hash table of the devices in a uclass
+ *
+ * This uses open addressing with linear probing and entries are never
+ * moved, so the first match for a key is the device that was added first.
+ * Devices are added in the order they are bound, which is the order of the
+ * uclass's device list, so this finds the same device as searching the
+ * list. Devices that are removed leave a deleted marker behind until the
+ * table is rebuilt.
+ *
+ * @entry: Slots in the table
+ * @used: Number of slots which are not free, including deleted ones
+ */
+struct uclass_hash {
+	struct uclass_hash_entry *entry;
+	uint used;
+};
+
+/**
+ * struct uclass_index - Lookup tables for the devices in a uclass
+ *
+ * @seq: Device for each sequence number, NULL if none
+ * @seq_count: Number of entries in @seq
+ * @node: Devices by device tree node
+ * @phandle: Devices by phandle
+ * @hash_bits: Size of each hash table, as log2 of the number of slots
+ * @stale: true if the tables must be rebuilt from the device list before
+ *	they are used
+ */
+struct uclass_index {
+	struct udevice **seq;
+	int seq_count;
+	struct uclass_hash node;
+	struct uclass_hash phandle;
+	uint hash_bits;
+	bool stale;
+};
+
+static uint uclass_hash_slot(struct uclass_index *idx, ulong key)
+{
+	/* Multiplicative hashing, taking the top bits of the product */
+	return (u32)(key * 0x9e3779b9) >> (32 - idx->hash_bits);
+}
+
+static void uclass_hash_add(struct uclass_index *idx, struct uclass_hash *hash,
+			    ulong key, struct udevice *dev)
+{
+	uint mask = (1 << idx->hash_bits) - 1;
+	uint i;
+
+	/* Keep at least half of the slots free so that searches stay short */
+	if ((hash->used + 1) * 2 > mask + 1) {
+		idx->stale = true;
+		return;
+	}
+	for (i = uclass_hash_slot(idx, key); hash->entry[i].dev;
+	     i = (i + 1) & mask)
+		;
+	hash->entry[i].key = key;
+	hash->entry[i].dev = dev;
+	hash->used++;
+}
+
+/**
+ * uclass_hash_find() - Find an entry in a uclass index hash table
+ *
+ * @idx: Index containing the table
+ * @hash: Table to search
+ * @key: Key to look for
+ * @dev: Device to look for, or NULL to find the first device with @key
+ * @return entry found, or NULL if none
+ */
+static struct uclass_hash_entry *uclass_hash_find(struct uclass_index *idx,
+						  struct uclass_hash *hash,
+						  ulong key,
+						  struct udevice *dev)
+{
+	uint mask = (1 << idx->hash_bits) - 1;
+	uint i;
+
+	for (i = uclass_hash_slot(idx, key); hash->entry[i].dev;
+	     i = (i + 1) & mask) {
+		struct uclass_hash_entry *entry = &hash->entry[i];
+
+		if (entry->key == key && entry->dev != UCLASS_INDEX_DELETED &&
+		    (!dev || entry->dev == dev))
+			return entry;
+	}
+
+	return NULL;
+}
+
+static bool uclass_node_key(struct udevice *dev, ulong *keyp)
+{
+	if (!dev_has_of_node(dev))
+		return false;
+	*keyp = dev_ofnode(dev).of_offset;
+
+	return true;
+}
+
+static bool uclass_phandle_key(struct udevice *dev, ulong *keyp)
+{
+	if (!CONFIG_IS_ENABLED(OF_CONTROL) || !dev_has_of_node(dev))
+		return false;
+	*keyp = dev_read_phandle(dev);
+
+	return *keyp != 0;
+}
+
+static void uclass_hash_del(struct uclass_index *idx, struct uclass_hash *hash,
+			    ulong key, struct udevice *dev)
+{
+	struct uclass_hash_entry *entry;
+
+	entry = uclass_hash_find(idx, hash, key, dev);
+	if (entry)
+		entry->dev = UCLASS_INDEX_DELETED;
+	else
+		idx->stale = true;
+}
+
+static int uclass_index_set_seq(struct uclass_index *idx, struct udevice *dev,
+				int seq)
+{
+	if (seq >= idx->seq_count) {
+		int count = max(seq + 1, idx->seq_count * 2);
+		struct udevice **tab;
+
+		tab = calloc(count, sizeof(*tab));
+		if (!tab)
+			return -ENOMEM;
+		if (idx->seq)
+			memcpy(tab, idx->seq, idx->seq_count * sizeof(*tab));
+		free(idx->seq);
+		idx->seq = tab;
+		idx->seq_count = count;
+	}
+
+	/* Sequence numbers are unique, but leave it to the list if not */
+	if (idx->seq[seq] && idx->seq[seq] != dev)
+		idx->stale = true;
+	else
+		idx->seq[seq] = dev;
+
+	return 0;
+}
+
+static void uclass_free_index(struct uclass *uc)
+{
+	struct uclass_index *idx = uc->index;
+
+	if (idx) {
+		free(idx->seq);
+		free(idx->node.entry);
+		free(idx);
+		uc->index = NULL;
+	}
+}
+
+static int uclass_build_index(struct uclass *uc, struct uclass_index *idx)
+{
+	struct uclass_hash_entry *entry;
+	struct udevice *dev;
+	uint count = 0;
+	uint bits;
+
+	uclass_foreach_dev(dev, uc)
+		count++;
+	/* Leave room for as many devices again to be bound */
+	for (bits = UCLASS_INDEX_MIN_BITS; (1U << bits) < count * 4; bits++)
+		;
+	/* Both tables share one allocation */
+	entry = calloc(2 << bits, sizeof(*entry));
+	if (!entry)
+		return -ENOMEM;
+	free(idx->node.entry);
+	idx->node.entry = entry;
+	idx->node.used = 0;
+	idx->phandle.entry = entry + (1 << bits);
+	idx->phandle.used = 0;
+	idx->hash_bits = bits;
+	if (idx->seq)
+		memset(idx->seq, '\0', idx->seq_count * sizeof(*idx->seq));
+
+	uclass_foreach_dev(dev, uc) {
+		ulong key;
+
+		if (uclass_node_key(dev, &key))
+			uclass_hash_add(idx, &idx->node, key, dev);
+		if (uclass_phandle_key(dev, &key))
+			uclass_hash_add(idx, &idx->phandle, key, dev);
+		if (dev->seq >= 0 && uclass_index_set_seq(idx, dev, dev->seq))
+			return -ENOMEM;
+	}
+	idx->stale = false;
+
+	return 0;
+}
+
+/**
+ * uclass_get_index() - Get the lookup tables for a uclass
+ *
+ * This creates the tables on first use and rebuilds them if they are stale.
+ *
+ * @uc: uclass to check
+ * @return index, or NULL if out of memory, in which case the caller should
+ * search the device list
+ */
+static struct uclass_index *uclass_get_index(struct uclass *uc)
+{
+	struct uclass_index *idx = uc->index;
+
+	if (!idx) {
+		idx = calloc(1, sizeof(*idx));
+		if (!idx)
+			return NULL;
+		idx->stale = true;
+		uc->index = idx;
+	}
+	if (idx->stale && uclass_build_index(uc, idx)) {
+		uclass_free_index(uc);
+		return NULL;
+	}
+
+	return idx;
+}
+
+static void uclass_hash_add_device(struct uclass_index *idx,
+				   struct uclass_hash *hash, ulong key,
+				   struct udevice *dev)
+{
+	/*
+	 * A device which is not the last in the list must come before any
+	 * other device with the same key, so the table must be rebuilt
+	 */
+	if (!list_is_last(&dev->uclass_node, &dev->uclass->dev_head) &&
+	    uclass_hash_find(idx, hash, key, NULL))
+		idx->stale = true;
+	else
+		uclass_hash_add(idx, hash, key, dev);
+}
+
+void uclass_index_add_device(struct udevice *dev)
+{
+	struct uclass_index *idx = dev->uclass->index;
+	ulong key;
+
+	if (!idx || idx->stale)
+		return;
+	if (uclass_node_key(dev, &key))
+		uclass_hash_add_device(idx, &idx->node, key, dev);
+	if (uclass_phandle_key(dev, &key))
+		uclass_hash_add_device(idx, &idx->phandle, key, dev);
+}
+
+void uclass_index_remove_device(struct udevice *dev)
+{
+	struct uclass_index *idx = dev->uclass->index;
+	ulong key;
+
+	if (!idx || idx->stale)
+		return;
+	if (uclass_node_key(dev, &key))
+		uclass_hash_del(idx, &idx->node, key, dev);
+	if (uclass_phandle_key(dev, &key))
+		uclass_hash_del(idx, &idx->phandle, key, dev);
+}
+
+/*
+ * The uclass_index_find_...() functions return 0 if the device was found,
+ * -ENODEV if there is no such device and -ENOSYS if the device list must be
+ * searched instead
+ */
+static int uclass_index_find_seq(struct uclass *uc, int seq,
+				 struct udevice **devp)
+{
+	struct uclass_index *idx = uclass_get_index(uc);
+
+	if (!idx)
+		return -ENOSYS;
+	if (seq < 0 || seq >= idx->seq_count || !idx->seq[seq])
+		return -ENODEV;
+	*devp = idx->seq[seq];
+
+	return 0;
+}
+
+static int uclass_index_find_node(struct uclass *uc, ofnode node,
+				  struct udevice **devp)
+{
+	struct uclass_index *idx = uclass_get_index(uc);
+	struct uclass_hash_entry *entry;
+
+	if (!idx)
+		return -ENOSYS;
+	entry = uclass_hash_find(idx, &idx->node, node.of_offset, NULL);
+	if (!entry)
+		return -ENODEV;
+	*devp = entry->dev;
+
+	return 0;
+}
+
+static int uclass_index_find_phandle(struct uclass *uc, uint phandle,
+				     struct udevice **devp)
+{
+	struct uclass_index *idx = uclass_get_index(uc);
+	struct uclass_hash_entry *entry;
+
+	if (!idx)
+		return -ENOSYS;
+	entry = uclass_hash_find(idx, &idx->phandle, phandle, NULL);
+	if (!entry)
+		return -ENODEV;
+	*devp = entry->dev;
+
+	return 0;
+}
+#else
+static inline void uclass_free_index(struct uclass *uc) {}
+
+static inline int uclass_index_find_seq(struct uclass *uc, int seq,
+					struct udevice **devp)
+{
+	return -ENOSYS;
+}
+
+static inline int uclass_index_find_node(struct uclass *uc, ofnode node,
+					 struct udevice **devp)
+{
+	return -ENOSYS;
+}
+
+static inline int uclass_index_find_phandle(struct uclass *uc, uint phandle,
+					    struct udevice **devp)
+{
+	return -ENOSYS;
+}
+#endif
+
+void uclass_set_seq(struct udevice *dev, int seq)
+{
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct uclass *uc = dev->uclass;
+	struct uclass_index *idx = uc->index;
+
+	if (idx) {
+		if (dev->seq >= 0 && dev->seq < idx->seq_count &&
+		    idx->seq[dev->seq] == dev)
+			idx->seq[dev->seq] = NULL;
+		if (seq >= 0 && uclass_index_set_seq(idx, dev, seq))
+			uclass_free_index(uc);
+	}
+#endif
+	dev->seq = seq;
+}
+
 int uclass_destroy(struct uclass *uc)
 {
 	struct uclass_driver *uc_drv;
@@ -130,6 +506,7 @@ int uclass_destroy(struct uclass *uc)
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto_alloc_size)
 		free(uc->priv);
+	uclass_free_index(uc);
 	free(uc);
 
 	return 0;
@@ -308,6 +685,13 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 	if (ret)
 		return ret;
 
+	/* Drivers may change req_seq after binding, so that is not indexed */
+	if (!find_req_seq) {
+		ret = uclass_index_find_seq(uc, seq_or_req_seq, devp);
+		if (ret != -ENOSYS)
+			return ret;
+	}
+
 	uclass_foreach_dev(dev, uc) {
 		debug("   - %d %d '%s'\n", dev->req_seq, dev->seq, dev->name);
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
@@ -361,6 +745,10 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+	ret = uclass_index_find_node(uc, node, devp);
+	if (ret != -ENOSYS)
+		goto done;
+
 	uclass_foreach_dev(dev, uc) {
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
@@ -378,28 +766,27 @@ done:
 }
 
 #if CONFIG_IS_ENABLED(OF_CONTROL)
-int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
-				  const char *name, struct udevice **devp)
+int uclass_find_device_by_phandle_id(enum uclass_id id, uint phandle_id,
+				     struct udevice **devp)
 {
 	struct udevice *dev;
 	struct uclass *uc;
-	int find_phandle;
 	int ret;
 
 	*devp = NULL;
-	find_phandle = dev_read_u32_default(parent, name, -1);
-	if (find_phandle <= 0)
-		return -ENOENT;
 	ret = uclass_get(id, &uc);
 	if (ret)
 		return ret;
+	ret = uclass_index_find_phandle(uc, phandle_id, devp);
+	if (ret != -ENOSYS)
+		return ret;
 
 	uclass_foreach_dev(dev, uc) {
 		uint phandle;
 
 		phandle = dev_read_phandle(dev);
 
-		if (phandle == find_phandle) {
+		if (phandle == phandle_id) {
 			*devp = dev;
 			return 0;
 		}
@@ -407,6 +794,19 @@ int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 
 	return -ENODEV;
 }
+
+int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
+				  const char *name, struct udevice **devp)
+{
+	int find_phandle;
+
+	*devp = NULL;
+	find_phandle = dev_read_u32_default(parent, name, -1);
+	if (find_phandle <= 0)
+		return -ENOENT;
+
+	return uclass_find_device_by_phandle_id(id, find_phandle, devp);
+}
 #endif
 
 int uclass_get_device_by_driver(enum uclass_id id,
@@ -513,26 +913,11 @@ int uclass_get_device_by_phandle_id(enum uclass_id id, uint phandle_id,
 				    struct udevice **devp)
 {
 	struct udevice *dev;
-	struct uclass *uc;
 	int ret;
 
 	*devp = NULL;
-	ret = uclass_get(id, &uc);
-	if (ret)
-		return ret;
-
-	uclass_foreach_dev(dev, uc) {
-		uint phandle;
-
-		phandle = dev_read_phandle(dev);
-
-		if (phandle == phandle_id) {
-			*devp = dev;
-			return uclass_get_device_tail(dev, ret, devp);
-		}
-	}
-
-	return -ENODEV;
+	ret = uclass_find_device_by_phandle_id(id, phandle_id, &dev);
+	return uclass_get_device_tail(dev, ret, devp);
 }
 
 int uclass_get_device_by_phandle(enum uclass_id id, struct udevice *parent,
@@ -631,6 +1016,7 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	uclass_index_add_device(dev);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -645,6 +1031,7 @@ int uclass_bind_device(struct udevice *dev)
 	return 0;
 err:
 	/* There is no need to undo the parent's post_bind call */
+	uclass_index_remove_device(dev);
 	list_del(&dev->uclass_node);
 
 	return ret;
@@ -663,6 +1050,7 @@ int uclass_unbind_device(struct udevice *dev)
 			return ret;
 	}
 
+	uclass_index_remove_device(dev);
 	list_del(&dev->uclass_node);
 	return 0;
 }
@@ -9,6 +9,7 @@
 #include <fastboot-internal.h>
 #include <fb_mmc.h>
 #include <fb_nand.h>
+#include <image-sparse.h>
 #include <part.h>
 #include <stdlib.h>
 
@@ -27,6 +28,48 @@ static u32 fastboot_bytes_received;
  */
 static u32 fastboot_bytes_expected;
 
+#if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_STREAM)
+/**
+ * fastboot_stream_part - partition the next download is written to, if any
+ */
+static char fastboot_stream_part[PART_NAME_LEN];
+
+/**
+ * fastboot_stream - sparse image being written as it is downloaded
+ */
+static struct sparse_stream fastboot_stream;
+
+/**
+ * fastboot_stream_response - why the stream failed, reported at completion
+ */
+static char fastboot_stream_response[FASTBOOT_RESPONSE_LEN];
+
+static bool fastboot_streaming(void)
+{
+	return fastboot_stream_part[0];
+}
+
+static void fastboot_stream_write(const void *data, unsigned int len)
+{
+	/*
+	 * The client is still sending, so a failure is only noted here. The
+	 * stream refuses any more data and sparse_stream_finish() reports it
+	 * when the download completes.
+	 */
+	if (sparse_stream_write(&fastboot_stream, data, len))
+		debug("%s: sparse image write failed\n", __func__);
+}
+#else
+static bool fastboot_streaming(void)
+{
+	return false;
+}
+
+static void fastboot_stream_write(const void *data, unsigned int len)
+{
+}
+#endif
+
 static void okay(char *, char *);
 static void getvar(char *, char *);
 static void download(char *, char *);
@@ -38,6 +81,9 @@ static void reboot_bootloader(char *, char *);
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_FORMAT)
 static void oem_format(char *, char *);
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_STREAM)
+static void oem_stream(char *, char *);
+#endif
 
 static const struct {
 	const char *command;
@@ -87,6 +133,12 @@ static const struct {
 		.dispatch = oem_format,
 	},
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_STREAM)
+	[FASTBOOT_COMMAND_OEM_STREAM] = {
+		.command = "oem stream",
+		.dispatch = oem_stream,
+	},
+#endif
 };
 
 /**
@@ -172,9 +224,11 @@ static void download(char *cmd_parameter, char *response)
 	 * Nothing to download yet. Response is of the form:
 	 * [DATA|FAIL]$cmd_parameter
 	 *
-	 * where cmd_parameter is an 8 digit hexadecimal number
+	 * where cmd_parameter is an 8 digit hexadecimal number. A streamed
+	 * image does not have to fit in the buffer.
 	 */
-	if (fastboot_bytes_expected > fastboot_buf_size) {
+	if (fastboot_bytes_expected > fastboot_buf_size &&
+	    !fastboot_streaming()) {
 		fastboot_fail(cmd_parameter, response);
 	} else {
 		printf("Starting download of %d bytes\n",
@@ -204,6 +258,10 @@ u32 fastboot_data_remaining(void)
  * response. fastboot_bytes_received is updated to indicate the number
  * of bytes that have been transferred.
  *
+ * After "oem stream" the data goes to the sparse image writer instead. A
+ * failure there is only reported once the download completes, as the
+ * client is still sending.
+ *
  * On completion sets image_size and ${filesize} to the total size of the
  * downloaded image.
  */
@@ -221,9 +279,12 @@ void fastboot_data_download(const void *fastboot_data,
 			      response);
 		return;
 	}
-	/* Download data to fastboot_buf_addr */
-	memcpy(fastboot_buf_addr + fastboot_bytes_received,
-	       fastboot_data, fastboot_data_len);
+	/* Download data to fastboot_buf_addr, or straight to the partition */
+	if (fastboot_streaming())
+		fastboot_stream_write(fastboot_data, fastboot_data_len);
+	else
+		memcpy(fastboot_buf_addr + fastboot_bytes_received,
+		       fastboot_data, fastboot_data_len);
 
 	pre_dot_num = fastboot_bytes_received / BYTES_PER_DOT;
 	fastboot_bytes_received += fastboot_data_len;
@@ -250,6 +311,16 @@ void fastboot_data_complete(char *response)
 	fastboot_okay(NULL, response);
 	printf("\ndownloading of %d bytes finished\n", fastboot_bytes_received);
 	image_size = fastboot_bytes_received;
+#if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_STREAM)
+	if (fastboot_streaming()) {
+		if (sparse_stream_finish(&fastboot_stream))
+			strlcpy(response, fastboot_stream_response,
+				FASTBOOT_RESPONSE_LEN);
+		/* The image is on the partition, not in the buffer */
+		image_size = 0;
+		fastboot_stream_part[0] = '\0';
+	}
+#endif
 	env_set_hex("filesize", image_size);
 	fastboot_bytes_expected = 0;
 	fastboot_bytes_received = 0;
@@ -334,3 +405,34 @@ static void oem_format(char *cmd_parameter, char *response)
 	}
 }
 #endif
+
+#if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_STREAM)
+/**
+ * oem_stream() - Write the next download to a partition as it arrives
+ *
+ * @cmd_parameter: Pointer to partition name
+ * @response: Pointer to fastboot response buffer
+ *
+ * The next download must be a sparse image. It is written to the partition
+ * while it is received, so it may be larger than the download buffer.
+ */
+static void oem_stream(char *cmd_parameter, char *response)
+{
+	fastboot_stream_part[0] = '\0';
+	if (!cmd_parameter) {
+		fastboot_fail("Expected command parameter", response);
+		return;
+	}
+	/* The command buffer is reused by the download */
+	strlcpy(fastboot_stream_part, cmd_parameter,
+		sizeof(fastboot_stream_part));
+	fastboot_stream_response[0] = '\0';
+	if (fastboot_mmc_stream_start(fastboot_stream_part, &fastboot_stream,
+				      fastboot_buf_addr, fastboot_buf_size,
+				      fastboot_stream_response, response)) {
+		fastboot_stream_part[0] = '\0';
+		return;
+	}
+	fastboot_okay(NULL, response);
+}
+#endif
@@ -97,6 +97,62 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+
+	if (fastboot_progress_callback)
+		fastboot_progress_callback("erasing");
+
+	/* Whole erase groups, so one call to keep them aligned */
+	return blk_derase(sparse->dev_desc, blk, blkcnt);
+}
+
+/**
+ * fb_mmc_erases_to_zero() - Check that erased blocks read back as zero
+ *
+ * @mmc: MMC device
+ * Return: true if the card erases to zero, false if not or if unknown
+ */
+static bool fb_mmc_erases_to_zero(struct mmc *mmc)
+{
+	if (IS_SD(mmc))
+		return !(mmc->scr[0] & SD_DATA_STAT_AFTER_ERASE);
+
+	return mmc->ext_csd && !mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT];
+}
+
+static void fb_mmc_sparse_init(struct sparse_storage *sparse,
+			       struct fb_mmc_sparse *sparse_priv,
+			       struct blk_desc *dev_desc,
+			       disk_partition_t *info)
+{
+	struct mmc *mmc;
+
+	sparse_priv->dev_desc = dev_desc;
+
+	sparse->blksz = info->blksz;
+	sparse->start = info->start;
+	sparse->size = info->size;
+	sparse->write = fb_mmc_sparse_write;
+	sparse->reserve = fb_mmc_sparse_reserve;
+	sparse->mssg = fastboot_fail;
+	sparse->priv = sparse_priv;
+
+	/* Zero FILL chunks are erased rather than written where possible */
+	mmc = find_mmc_device(dev_desc->devnum);
+	if (mmc && mmc->erase_grp_size && fb_mmc_erases_to_zero(mmc)) {
+		sparse->erase_grp = mmc->erase_grp_size;
+		sparse->erase = fb_mmc_sparse_erase;
+	} else {
+		sparse->erase_grp = 0;
+		sparse->erase = NULL;
+	}
+
+	printf("Flashing sparse image at offset " LBAFU "\n", sparse->start);
+}
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		u32 download_bytes, char *response)
@@ -407,19 +463,7 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		struct sparse_storage sparse;
 		int err;
 
-		sparse_priv.dev_desc = dev_desc;
-
-		sparse.blksz = info.blksz;
-		sparse.start = info.start;
-		sparse.size = info.size;
-		sparse.write = fb_mmc_sparse_write;
-		sparse.reserve = fb_mmc_sparse_reserve;
-		sparse.mssg = fastboot_fail;
-
-		printf("Flashing sparse image at offset " LBAFU "\n",
-		       sparse.start);
-
-		sparse.priv = &sparse_priv;
+		fb_mmc_sparse_init(&sparse, &sparse_priv, dev_desc, &info);
 		err = write_sparse_image(&sparse, cmd, download_buffer,
 					 response);
 		if (!err)
@@ -430,6 +474,44 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 	}
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_STREAM)
+/**
+ * fastboot_mmc_stream_start() - Get ready to write a sparse image as it comes
+ *
+ * @cmd: Named partition to write image to
+ * @ss: Stream to set up
+ * @buf: Buffer to gather image data in
+ * @buf_size: Size of buf
+ * @stream_response: Buffer for the response if the stream fails later on
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 on success, -ve if the partition cannot be written
+ */
+int fastboot_mmc_stream_start(const char *cmd, struct sparse_stream *ss,
+			      void *buf, u32 buf_size, char *stream_response,
+			      char *response)
+{
+	/* The stream outlives the command, so its storage must too */
+	static struct fb_mmc_sparse sparse_priv;
+	static struct sparse_storage sparse;
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+	int r;
+
+	r = fastboot_mmc_get_part_info(cmd, &dev_desc, &info, response);
+	if (r < 0)
+		return r;
+	if (buf_size < info.blksz) {
+		fastboot_fail("download buffer too small", response);
+		return -ENOSPC;
+	}
+
+	fb_mmc_sparse_init(&sparse, &sparse_priv, dev_desc, &info);
+
+	return sparse_stream_start(ss, &sparse, cmd, buf, buf_size,
+				   stream_response);
+}
+#endif
+
 /**
  * fastboot_mmc_flash_erase() - Erase eMMC for fastboot
  *
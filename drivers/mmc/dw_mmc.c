@@ -43,6 +43,30 @@ static void dwmci_set_idma_desc(struct dwmci_idmac *idmac,
 	desc->next_addr = (ulong)desc + sizeof(struct dwmci_idmac);
 }
 
+/*
+ * Get a descriptor chain for @blocks blocks. Each descriptor covers 8 blocks,
+ * so long transfers need more than we want to put on the stack; the chain
+ * is kept with the host and only grows.
+ */
+static struct dwmci_idmac *dwmci_get_idmac(struct dwmci_host *host,
+					   unsigned int blocks)
+{
+	unsigned int count = DIV_ROUND_UP(blocks, 8);
+
+	if (count > host->idmac_count) {
+		free(host->idmac);
+		host->idmac = malloc_cache_aligned(count *
+						   sizeof(struct dwmci_idmac));
+		if (!host->idmac) {
+			host->idmac_count = 0;
+			return NULL;
+		}
+		host->idmac_count = count;
+	}
+
+	return host->idmac;
+}
+
 static void dwmci_prepare_data(struct dwmci_host *host,
 			       struct mmc_data *data,
 			       struct dwmci_idmac *cur_idmac,
@@ -235,25 +259,46 @@ static int dwmci_set_transfer_mode(struct dwmci_host *host,
 	return mode;
 }
 
-#ifdef CONFIG_DM_MMC
-static int dwmci_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
-		   struct mmc_data *data)
+/* Wait for the IDMAC to finish and hand the data over */
+static int dwmci_dma_done(struct dwmci_host *host, struct mmc_data *data)
 {
-	struct mmc *mmc = mmc_get_mmc_dev(dev);
-#else
-static int dwmci_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
-		struct mmc_data *data)
+	u32 mask, ctrl;
+	int ret;
+
+	if (data->flags == MMC_DATA_READ)
+		mask = DWMCI_IDINTEN_RI;
+	else
+		mask = DWMCI_IDINTEN_TI;
+	ret = wait_for_bit_le32(host->ioaddr + DWMCI_IDSTS,
+				mask, true, 1000, false);
+	if (ret)
+		debug("%s: DWMCI_IDINTEN mask 0x%x timeout.\n",
+		      __func__, mask);
+	/* clear interrupts */
+	dwmci_writel(host, DWMCI_IDSTS, DWMCI_IDINTEN_MASK);
+
+	ctrl = dwmci_readl(host, DWMCI_CTRL);
+	ctrl &= ~(DWMCI_DMA_EN);
+	dwmci_writel(host, DWMCI_CTRL, ctrl);
+	bounce_buffer_stop(&host->bbstate);
+
+	return ret;
+}
+
+/*
+ * Send a command. With @async, a DMA transfer is left running once the
+ * response is in, for dwmci_send_cmd_poll() to pick up.
+ */
+static int dwmci_send_cmd_common(struct mmc *mmc, struct mmc_cmd *cmd,
+				 struct mmc_data *data, bool async)
 {
-#endif
 	struct dwmci_host *host = mmc->priv;
-	ALLOC_CACHE_ALIGN_BUFFER(struct dwmci_idmac, cur_idmac,
-				 data ? DIV_ROUND_UP(data->blocks, 8) : 0);
+	struct dwmci_idmac *cur_idmac;
 	int ret = 0, flags = 0, i;
 	unsigned int timeout = 500;
 	u32 retry = 100000;
-	u32 mask, ctrl;
+	u32 mask;
 	ulong start = get_timer(0);
-	struct bounce_buffer bbstate;
 
 	while (dwmci_readl(host, DWMCI_STATUS) & DWMCI_BUSY) {
 		if (get_timer(start) > timeout) {
@@ -271,13 +316,17 @@ static int dwmci_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 				     data->blocksize * data->blocks);
 			dwmci_wait_reset(host, DWMCI_CTRL_FIFO_RESET);
 		} else {
+			cur_idmac = dwmci_get_idmac(host, data->blocks);
+			if (!cur_idmac)
+				return -ENOMEM;
+
 			if (data->flags == MMC_DATA_READ) {
-				ret = bounce_buffer_start(&bbstate,
+				ret = bounce_buffer_start(&host->bbstate,
 						(void*)data->dest,
 						data->blocksize *
 						data->blocks, GEN_BB_WRITE);
 			} else {
-				ret = bounce_buffer_start(&bbstate,
+				ret = bounce_buffer_start(&host->bbstate,
 						(void*)data->src,
 						data->blocksize *
 						data->blocks, GEN_BB_READ);
@@ -287,7 +336,7 @@ static int dwmci_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 				return ret;
 
 			dwmci_prepare_data(host, data, cur_idmac,
-					   bbstate.bounce_buffer);
+					   host->bbstate.bounce_buffer);
 		}
 	}
 
@@ -371,27 +420,19 @@ static int dwmci_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
 	}
 
 	if (data) {
+		if (async && !host->fifo_mode) {
+			host->async_data = data;
+			host->async_start = get_timer(0);
+			host->async_timeout = dwmci_get_timeout(mmc,
+					data->blocksize * data->blocks);
+			return 0;
+		}
+
 		ret = dwmci_data_transfer(host, data);
 
 		/* only dma mode need it */
-		if (!host->fifo_mode) {
-			if (data->flags == MMC_DATA_READ)
-				mask = DWMCI_IDINTEN_RI;
-			else
-				mask = DWMCI_IDINTEN_TI;
-			ret = wait_for_bit_le32(host->ioaddr + DWMCI_IDSTS,
-						mask, true, 1000, false);
-			if (ret)
-				debug("%s: DWMCI_IDINTEN mask 0x%x timeout.\n",
-				      __func__, mask);
-			/* clear interrupts */
-			dwmci_writel(host, DWMCI_IDSTS, DWMCI_IDINTEN_MASK);
-
-			ctrl = dwmci_readl(host, DWMCI_CTRL);
-			ctrl &= ~(DWMCI_DMA_EN);
-			dwmci_writel(host, DWMCI_CTRL, ctrl);
-			bounce_buffer_stop(&bbstate);
-		}
+		if (!host->fifo_mode)
+			ret = dwmci_dma_done(host, data);
 	}
 
 delay_ret:
@@ -400,6 +441,59 @@ delay_ret:
 	return ret;
 }
 
+#ifdef CONFIG_DM_MMC
+static int dwmci_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
+		   struct mmc_data *data)
+{
+	return dwmci_send_cmd_common(mmc_get_mmc_dev(dev), cmd, data, false);
+}
+
+static int dwmci_send_cmd_start(struct udevice *dev, struct mmc_cmd *cmd,
+				struct mmc_data *data)
+{
+	return dwmci_send_cmd_common(mmc_get_mmc_dev(dev), cmd, data, true);
+}
+
+static int dwmci_send_cmd_poll(struct udevice *dev, struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct dwmci_host *host = mmc->priv;
+	u32 mask;
+	int ret;
+
+	/* FIFO mode transfers are done by dwmci_send_cmd_start() */
+	if (!host->async_data)
+		return 0;
+
+	mask = dwmci_readl(host, DWMCI_RINTSTS);
+	if (mask & (DWMCI_DATA_ERR | DWMCI_DATA_TOUT)) {
+		debug("%s: DATA ERROR!\n", __func__);
+		ret = -EINVAL;
+	} else if (mask & DWMCI_INTMSK_DTO) {
+		ret = 0;
+	} else if (get_timer(host->async_start) > host->async_timeout) {
+		debug("%s: Timeout waiting for data!\n", __func__);
+		ret = -ETIMEDOUT;
+	} else {
+		return -EBUSY;
+	}
+	dwmci_writel(host, DWMCI_RINTSTS, mask);
+	host->async_data = NULL;
+
+	if (dwmci_dma_done(host, data) && !ret)
+		ret = -ETIMEDOUT;
+	udelay(100);
+
+	return ret;
+}
+#else
+static int dwmci_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
+		struct mmc_data *data)
+{
+	return dwmci_send_cmd_common(mmc, cmd, data, false);
+}
+#endif
+
 static int dwmci_setup_bus(struct dwmci_host *host, u32 freq)
 {
 	u32 div, status;
@@ -573,6 +667,8 @@ int dwmci_probe(struct udevice *dev)
 
 const struct dm_mmc_ops dm_dwmci_ops = {
 	.send_cmd	= dwmci_send_cmd,
+	.send_cmd_start	= dwmci_send_cmd_start,
+	.send_cmd_poll	= dwmci_send_cmd_poll,
 	.set_ios	= dwmci_set_ios,
 };
 
@@ -606,6 +702,8 @@ void dwmci_setup_cfg(struct mmc_config *cfg, struct dwmci_host *host,
 		cfg->host_caps &= ~MMC_MODE_8BIT;
 	}
 	cfg->host_caps |= MMC_MODE_HS | MMC_MODE_HS_52MHz;
+	/* Nothing to do for CMD23: the controller never sends CMD12 itself */
+	cfg->host_caps |= MMC_CAP_CMD23;
 
 	cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
 }
@@ -33,6 +33,32 @@ int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 	return dm_mmc_send_cmd(mmc->dev, cmd, data);
 }
 
+int dm_mmc_send_cmd_start(struct udevice *dev, struct mmc_cmd *cmd,
+			  struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+	int ret;
+
+	if (!ops->send_cmd_start)
+		return dm_mmc_send_cmd(dev, cmd, data);
+
+	mmmc_trace_before_send(mmc, cmd);
+	ret = ops->send_cmd_start(dev, cmd, data);
+	mmmc_trace_after_send(mmc, cmd, ret);
+
+	return ret;
+}
+
+int dm_mmc_send_cmd_poll(struct udevice *dev, struct mmc_data *data)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+
+	if (!ops->send_cmd_poll)
+		return 0;
+	return ops->send_cmd_poll(dev, data);
+}
+
 int dm_mmc_set_ios(struct udevice *dev)
 {
 	struct dm_mmc_ops *ops = mmc_get_ops(dev);
@@ -370,7 +396,7 @@ static int mmc_select_hwpart(struct udevice *bdev, int hwpart)
 
 	ret = mmc_switch_part(mmc, hwpart);
 	if (!ret)
-		blkcache_invalidate(desc->if_type, desc->devnum);
+		blk_invalidate(desc);
 
 	return ret;
 }
@@ -411,6 +437,8 @@ static const struct blk_ops mmc_blk_ops = {
 	.erase	= mmc_berase,
 #endif
 	.select_hwpart	= mmc_select_hwpart,
+	.read_start	= mmc_bread_start,
+	.read_poll	= mmc_bread_poll,
 };
 
 U_BOOT_DRIVER(mmc_blk) = {
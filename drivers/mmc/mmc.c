@@ -374,43 +374,102 @@ int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error)
 }
 #endif
 
-static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
-			   lbaint_t blkcnt)
+bool mmc_can_set_block_count(struct mmc *mmc, lbaint_t blkcnt)
+{
+	if (blkcnt < 2 || blkcnt > 0xffff)
+		return false;
+	if (!(mmc->host_caps & MMC_CAP_CMD23) || mmc_host_is_spi(mmc))
+		return false;
+
+	if (IS_SD(mmc))
+		return mmc->scr[0] & SD_SCR_CMD23_SUPPORT;
+
+	return mmc->version >= MMC_VERSION_3;
+}
+
+int mmc_set_block_count(struct mmc *mmc, lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
-	struct mmc_data data;
+
+	cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	cmd.cmdarg = blkcnt;
+	cmd.resp_type = MMC_RSP_R1;
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
+/*
+ * Set up the command and data to read @blkcnt blocks. With the block count
+ * set up front the card stops by itself at the end of the transfer, which
+ * saves the CMD12 round trip; *@stopp tells whether it is still needed.
+ */
+static int mmc_read_blocks_prepare(struct mmc *mmc, struct mmc_cmd *cmd,
+				   struct mmc_data *data, void *dst,
+				   lbaint_t start, lbaint_t blkcnt, bool *stopp)
+{
+	int ret;
+
+	*stopp = blkcnt > 1;
+	if (mmc_can_set_block_count(mmc, blkcnt)) {
+		ret = mmc_set_block_count(mmc, blkcnt);
+		if (ret)
+			return ret;
+		*stopp = false;
+	}
 
 	if (blkcnt > 1)
-		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
+		cmd->cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
 	else
-		cmd.cmdidx = MMC_CMD_READ_SINGLE_BLOCK;
+		cmd->cmdidx = MMC_CMD_READ_SINGLE_BLOCK;
 
 	if (mmc->high_capacity)
-		cmd.cmdarg = start;
+		cmd->cmdarg = start;
 	else
-		cmd.cmdarg = start * mmc->read_bl_len;
+		cmd->cmdarg = start * mmc->read_bl_len;
 
-	cmd.resp_type = MMC_RSP_R1;
+	cmd->resp_type = MMC_RSP_R1;
 
-	data.dest = dst;
-	data.blocks = blkcnt;
-	data.blocksize = mmc->read_bl_len;
-	data.flags = MMC_DATA_READ;
+	data->dest = dst;
+	data->blocks = blkcnt;
+	data->blocksize = mmc->read_bl_len;
+	data->flags = MMC_DATA_READ;
 
-	if (mmc_send_cmd(mmc, &cmd, &data))
-		return 0;
+	return 0;
+}
 
-	if (blkcnt > 1) {
-		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
-		cmd.cmdarg = 0;
-		cmd.resp_type = MMC_RSP_R1b;
-		if (mmc_send_cmd(mmc, &cmd, NULL)) {
+static int mmc_read_stop(struct mmc *mmc)
+{
+	struct mmc_cmd cmd;
+	int ret;
+
+	cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
+	cmd.cmdarg = 0;
+	cmd.resp_type = MMC_RSP_R1b;
+	ret = mmc_send_cmd(mmc, &cmd, NULL);
 #if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
-			pr_err("mmc fail to send stop cmd\n");
+	if (ret)
+		pr_err("mmc fail to send stop cmd\n");
 #endif
-			return 0;
-		}
-	}
+
+	return ret;
+}
+
+static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
+			   lbaint_t blkcnt)
+{
+	struct mmc_cmd cmd;
+	struct mmc_data data;
+	bool stop;
+
+	if (mmc_read_blocks_prepare(mmc, &cmd, &data, dst, start, blkcnt,
+				    &stop))
+		return 0;
+
+	if (mmc_send_cmd(mmc, &cmd, &data))
+		return 0;
+
+	if (stop && mmc_read_stop(mmc))
+		return 0;
 
 	return blkcnt;
 }
@@ -472,6 +531,100 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	return blkcnt;
 }
 
+#if CONFIG_IS_ENABLED(DM_MMC) && CONFIG_IS_ENABLED(BLK)
+/* Start reading the next piece of @req, at most b_max blocks */
+static int mmc_bread_next(struct mmc *mmc, struct blk_req *req)
+{
+	struct mmc_data *data = &mmc->async_data;
+	void *dst = req->buffer + req->blks * mmc->read_bl_len;
+	struct mmc_cmd cmd;
+	lbaint_t blkcnt;
+	int ret;
+
+	blkcnt = min_t(lbaint_t, req->blkcnt - req->blks, mmc->cfg->b_max);
+	ret = mmc_read_blocks_prepare(mmc, &cmd, data, dst,
+				      req->start + req->blks, blkcnt,
+				      &mmc->async_stop);
+	if (!ret)
+		ret = dm_mmc_send_cmd_start(mmc->dev, &cmd, data);
+	if (ret)
+		data->blocks = 0;
+
+	return ret;
+}
+
+/*
+ * Select the hardware partition of the block device. blk_dselect_hwpart()
+ * cannot be used as it waits for the queue that this read is on.
+ */
+static int mmc_bread_select_hwpart(struct udevice *dev)
+{
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+
+	return blk_get_ops(dev)->select_hwpart(dev, block_dev->hwpart);
+}
+
+int mmc_bread_start(struct udevice *dev, struct blk_req *req)
+{
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct mmc *mmc = find_mmc_device(block_dev->devnum);
+	int err;
+
+	if (!mmc)
+		return -ENODEV;
+
+	err = mmc_bread_select_hwpart(dev);
+	if (err < 0)
+		return err;
+
+	if ((req->start + req->blkcnt) > block_dev->lba) {
+#if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
+		pr_err("MMC: block number 0x" LBAF " exceeds max(0x" LBAF ")\n",
+		       req->start + req->blkcnt, block_dev->lba);
+#endif
+		return -EINVAL;
+	}
+
+	if (mmc_set_blocklen(mmc, mmc->read_bl_len)) {
+		pr_debug("%s: Failed to set blocklen\n", __func__);
+		return -EIO;
+	}
+
+	if (!req->blkcnt)
+		return 0;
+
+	return mmc_bread_next(mmc, req);
+}
+
+int mmc_bread_poll(struct udevice *dev, struct blk_req *req)
+{
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct mmc *mmc = find_mmc_device(block_dev->devnum);
+	struct mmc_data *data = &mmc->async_data;
+	int ret;
+
+	if (data->blocks) {
+		ret = dm_mmc_send_cmd_poll(mmc->dev, data);
+		if (ret == -EBUSY)
+			return ret;
+		if (!ret && mmc->async_stop)
+			ret = mmc_read_stop(mmc);
+		if (!ret)
+			req->blks += data->blocks;
+		data->blocks = 0;
+		if (ret)
+			return ret;
+	}
+
+	if (req->blks == req->blkcnt)
+		return 0;
+
+	ret = mmc_bread_next(mmc, req);
+
+	return ret ? ret : -EBUSY;
+}
+#endif
+
 static int mmc_go_idle(struct mmc *mmc)
 {
 	struct mmc_cmd cmd;
@@ -16,6 +16,28 @@ int mmc_send_status(struct mmc *mmc, unsigned int *status);
 int mmc_poll_for_busy(struct mmc *mmc, int timeout);
 
 int mmc_set_blocklen(struct mmc *mmc, int len);
+
+/**
+ * mmc_can_set_block_count() - Check if a multiple block transfer can use CMD23
+ *
+ * @mmc:	MMC device
+ * @blkcnt:	Number of blocks to transfer
+ * @return true if both the host and the card support SET_BLOCK_COUNT and
+ * @blkcnt fits in its argument
+ */
+bool mmc_can_set_block_count(struct mmc *mmc, lbaint_t blkcnt);
+
+/**
+ * mmc_set_block_count() - Send SET_BLOCK_COUNT (CMD23)
+ *
+ * The following multiple block read or write then ends by itself after
+ * @blkcnt blocks, without a STOP_TRANSMISSION.
+ *
+ * @mmc:	MMC device
+ * @blkcnt:	Number of blocks, 2 to 65535
+ * @return 0 if OK, -ve on error
+ */
+int mmc_set_block_count(struct mmc *mmc, lbaint_t blkcnt);
 #ifdef CONFIG_FSL_ESDHC_ADAPTER_IDENT
 void mmc_adapter_card_type_ident(void);
 #endif
@@ -28,6 +50,12 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		void *dst);
 #endif
 
+#if CONFIG_IS_ENABLED(DM_MMC) && CONFIG_IS_ENABLED(BLK)
+/* Read in the background, see read_start() and read_poll() in blk_ops */
+int mmc_bread_start(struct udevice *dev, struct blk_req *req);
+int mmc_bread_poll(struct udevice *dev, struct blk_req *req);
+#endif
+
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 
 #if CONFIG_IS_ENABLED(BLK)
@@ -132,6 +132,7 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 	struct mmc_cmd cmd;
 	struct mmc_data data;
 	int timeout_ms = 1000;
+	bool predefined = false;
 
 	if ((start + blkcnt) > mmc_get_blk_desc(mmc)->lba) {
 		printf("MMC: block number 0x" LBAF " exceeds max(0x" LBAF ")\n",
@@ -139,6 +140,14 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 		return 0;
 	}
 
+	if (mmc_can_set_block_count(mmc, blkcnt)) {
+		if (mmc_set_block_count(mmc, blkcnt)) {
+			printf("mmc fail to set block count\n");
+			return 0;
+		}
+		predefined = true;
+	}
+
 	if (blkcnt == 0)
 		return 0;
 	else if (blkcnt == 1)
@@ -164,9 +173,10 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 	}
 
 	/* SPI multiblock writes terminate using a special
-	 * token, not a STOP_TRANSMISSION request.
+	 * token, not a STOP_TRANSMISSION request. Neither do
+	 * those with a predefined block count.
 	 */
-	if (!mmc_host_is_spi(mmc) && blkcnt > 1) {
+	if (!mmc_host_is_spi(mmc) && blkcnt > 1 && !predefined) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
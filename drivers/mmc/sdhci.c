@@ -243,18 +243,42 @@ static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data)
 #define SDHCI_CMD_MAX_TIMEOUT			3200
 #define SDHCI_CMD_DEFAULT_TIMEOUT		100
 #define SDHCI_READ_STATUS_TIMEOUT		1000
+/* Time allowed for the data, as sdhci_transfer_data() does, in ms */
+#define SDHCI_DATA_TIMEOUT			10000
 
-#ifdef CONFIG_DM_MMC
-static int sdhci_send_command(struct udevice *dev, struct mmc_cmd *cmd,
-			      struct mmc_data *data)
+/* Check the end of a command and of its data transfer */
+static int sdhci_end_command(struct sdhci_host *host, struct mmc_data *data,
+			     int ret, int is_aligned, int trans_bytes)
 {
-	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	unsigned int stat;
 
-#else
-static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
-			      struct mmc_data *data)
+	if (host->quirks & SDHCI_QUIRK_WAIT_SEND_CMD)
+		udelay(1000);
+
+	stat = sdhci_readl(host, SDHCI_INT_STATUS);
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+	if (!ret) {
+		if ((host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR) &&
+				!is_aligned && (data->flags == MMC_DATA_READ))
+			memcpy(data->dest, aligned_buffer, trans_bytes);
+		return 0;
+	}
+
+	sdhci_reset(host, SDHCI_RESET_CMD);
+	sdhci_reset(host, SDHCI_RESET_DATA);
+	if (stat & SDHCI_INT_TIMEOUT)
+		return -ETIMEDOUT;
+	else
+		return -ECOMM;
+}
+
+/*
+ * Send a command. With @async, an ADMA transfer is left running once the
+ * response is in, for sdhci_send_command_poll() to pick up.
+ */
+static int sdhci_send_command_common(struct mmc *mmc, struct mmc_cmd *cmd,
+				     struct mmc_data *data, bool async)
 {
-#endif
 	struct sdhci_host *host = mmc->priv;
 	unsigned int stat = 0;
 	int ret = 0;
@@ -369,28 +393,68 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 	} else
 		ret = -1;
 
-	if (!ret && data)
+	if (!ret && data) {
+		if (async && (host->flags & (USE_ADMA | USE_ADMA64))) {
+			host->async_data = data;
+			host->async_start = get_timer(0);
+			return 0;
+		}
 		ret = sdhci_transfer_data(host, data);
+	}
 
-	if (host->quirks & SDHCI_QUIRK_WAIT_SEND_CMD)
-		udelay(1000);
+	return sdhci_end_command(host, data, ret, is_aligned, trans_bytes);
+}
 
-	stat = sdhci_readl(host, SDHCI_INT_STATUS);
-	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
-	if (!ret) {
-		if ((host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR) &&
-				!is_aligned && (data->flags == MMC_DATA_READ))
-			memcpy(data->dest, aligned_buffer, trans_bytes);
+#ifdef CONFIG_DM_MMC
+static int sdhci_send_command(struct udevice *dev, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
+{
+	return sdhci_send_command_common(mmc_get_mmc_dev(dev), cmd, data,
+					 false);
+}
+
+static int sdhci_send_command_start(struct udevice *dev, struct mmc_cmd *cmd,
+				    struct mmc_data *data)
+{
+	return sdhci_send_command_common(mmc_get_mmc_dev(dev), cmd, data,
+					 true);
+}
+
+static int sdhci_send_command_poll(struct udevice *dev, struct mmc_data *data)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+	unsigned int stat;
+	int ret;
+
+	/* Only ADMA transfers are left running */
+	if (!host->async_data)
 		return 0;
+
+	stat = sdhci_readl(host, SDHCI_INT_STATUS);
+	if (stat & SDHCI_INT_ERROR) {
+		pr_debug("%s: Error detected in status(0x%X)!\n",
+			 __func__, stat);
+		ret = -EIO;
+	} else if (stat & SDHCI_INT_DATA_END) {
+		ret = 0;
+	} else if (get_timer(host->async_start) > SDHCI_DATA_TIMEOUT) {
+		printf("%s: Transfer data timeout\n", __func__);
+		ret = -ETIMEDOUT;
+	} else {
+		return -EBUSY;
 	}
+	host->async_data = NULL;
 
-	sdhci_reset(host, SDHCI_RESET_CMD);
-	sdhci_reset(host, SDHCI_RESET_DATA);
-	if (stat & SDHCI_INT_TIMEOUT)
-		return -ETIMEDOUT;
-	else
-		return -ECOMM;
+	return sdhci_end_command(host, data, ret, 1, 0);
+}
+#else
+static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
+			      struct mmc_data *data)
+{
+	return sdhci_send_command_common(mmc, cmd, data, false);
 }
+#endif
 
 #if defined(CONFIG_DM_MMC) && defined(MMC_SUPPORTS_TUNING)
 static int sdhci_execute_tuning(struct udevice *dev, uint opcode)
@@ -692,6 +756,8 @@ int sdhci_get_cd(struct udevice *dev)
 
 const struct dm_mmc_ops sdhci_ops = {
 	.send_cmd	= sdhci_send_command,
+	.send_cmd_start	= sdhci_send_command_start,
+	.send_cmd_poll	= sdhci_send_command_poll,
 	.set_ios	= sdhci_set_ios,
 	.get_cd		= sdhci_get_cd,
 #ifdef MMC_SUPPORTS_TUNING
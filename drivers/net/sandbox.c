@@ -329,6 +329,8 @@ static int sb_eth_start(struct udevice *dev)
 		priv->recv_packet_buffer[i] = net_rx_packets[i];
 		priv->recv_packet_length[i] = 0;
 	}
+	priv->rx_split.count = 0;
+	priv->rx_split_used = 0;
 
 	return 0;
 }
@@ -345,6 +347,28 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 	return priv->tx_handler(dev, packet, length);
 }
 
+/*
+ * Emulate a DMA engine which scatters a received frame over the packet buffer
+ * and the next payload slot handed over with eth_set_rx_split()
+ */
+static void sb_eth_rx_split(struct udevice *dev, uchar *packet, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct eth_rx_split *split = &priv->rx_split;
+	int payload_len = len - split->hdr_len;
+	uchar *slot;
+
+	if (priv->rx_split_used >= split->count || payload_len <= 0 ||
+	    payload_len > split->stride)
+		return;
+
+	slot = split->base + priv->rx_split_used++ * split->stride;
+	memcpy(slot, packet + split->hdr_len, payload_len);
+	/* The payload never reaches the packet buffer */
+	memset(packet + split->hdr_len, 0, payload_len);
+	eth_rx_set_payload(dev, slot);
+}
+
 static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -360,6 +384,7 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		debug("eth_sandbox: received packet[%d], %d waiting\n",
 		      lcl_recv_packet_length, priv->recv_packets - 1);
 		*packetp = priv->recv_packet_buffer[0];
+		sb_eth_rx_split(dev, *packetp, lcl_recv_packet_length);
 		return lcl_recv_packet_length;
 	}
 	return 0;
@@ -385,6 +410,20 @@ static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 	return 0;
 }
 
+static int sb_eth_set_rx_split(struct udevice *dev,
+			       const struct eth_rx_split *split)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	if (split)
+		priv->rx_split = *split;
+	else
+		priv->rx_split.count = 0;
+	priv->rx_split_used = 0;
+
+	return 0;
+}
+
 static void sb_eth_stop(struct udevice *dev)
 {
 	debug("eth_sandbox: Stop\n");
@@ -406,6 +445,7 @@ static const struct eth_ops sb_eth_ops = {
 	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
+	.set_rx_split		= sb_eth_set_rx_split,
 };
 
 static int sb_eth_remove(struct udevice *dev)
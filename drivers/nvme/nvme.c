@@ -163,48 +163,32 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 	nvmeq->sq_tail = tail;
 }
 
-static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
-				struct nvme_command *cmd,
-				u32 *result, unsigned timeout)
+/**
+ * nvme_complete_cmd() - check for the completion of the oldest command
+ *
+ * @nvmeq:	The queue to check
+ * @result:	Place to put the result of the command, or NULL
+ * @return 0 if it completed, -EBUSY if it has not yet, -EIO if it failed
+ */
+static int nvme_complete_cmd(struct nvme_queue *nvmeq, u32 *result)
 {
 	u16 head = nvmeq->cq_head;
 	u16 phase = nvmeq->cq_phase;
 	u16 status;
-	ulong start_time;
-	ulong timeout_us = timeout * 100000;
-
-	cmd->common.command_id = nvme_get_cmd_id();
-	nvme_submit_cmd(nvmeq, cmd);
+	int ret = 0;
 
-	start_time = timer_get_us();
-
-	for (;;) {
-		status = nvme_read_completion_status(nvmeq, head);
-		if ((status & 0x01) == phase)
-			break;
-		if (timeout_us > 0 && (timer_get_us() - start_time)
-		    >= timeout_us)
-			return -ETIMEDOUT;
-	}
+	status = nvme_read_completion_status(nvmeq, head);
+	if ((status & 0x01) != phase)
+		return -EBUSY;
 
 	status >>= 1;
 	if (status) {
 		printf("ERROR: status = %x, phase = %d, head = %d\n",
 		       status, phase, head);
-		status = 0;
-		if (++head == nvmeq->q_depth) {
-			head = 0;
-			phase = !phase;
-		}
-		writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
-		nvmeq->cq_head = head;
-		nvmeq->cq_phase = phase;
-
-		return -EIO;
-	}
-
-	if (result)
+		ret = -EIO;
+	} else if (result) {
 		*result = le32_to_cpu(readl(&(nvmeq->cqes[head].result)));
+	}
 
 	if (++head == nvmeq->q_depth) {
 		head = 0;
@@ -214,7 +198,30 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	nvmeq->cq_head = head;
 	nvmeq->cq_phase = phase;
 
-	return status;
+	return ret;
+}
+
+static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
+				struct nvme_command *cmd,
+				u32 *result, unsigned timeout)
+{
+	ulong start_time;
+	ulong timeout_us = timeout * 100000;
+	int ret;
+
+	cmd->common.command_id = nvme_get_cmd_id();
+	nvme_submit_cmd(nvmeq, cmd);
+
+	start_time = timer_get_us();
+
+	for (;;) {
+		ret = nvme_complete_cmd(nvmeq, result);
+		if (ret != -EBUSY)
+			return ret;
+		if (timeout_us > 0 && (timer_get_us() - start_time)
+		    >= timeout_us)
+			return -ETIMEDOUT;
+	}
 }
 
 static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
@@ -676,6 +683,48 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
+static void nvme_init_rw_cmd(struct nvme_ns *ns, struct nvme_command *c,
+			     bool read)
+{
+	c->rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
+	c->rw.flags = 0;
+	c->rw.nsid = cpu_to_le32(ns->ns_id);
+	c->rw.control = 0;
+	c->rw.dsmgmt = 0;
+	c->rw.reftag = 0;
+	c->rw.apptag = 0;
+	c->rw.appmask = 0;
+	c->rw.metadata = 0;
+}
+
+/*
+ * Collect the completion of the read sent for dev->async_ns, waiting for it
+ * if @wait. Its status is left in the namespace for nvme_blk_read_poll().
+ *
+ * @return 0 if the I/O queue is free, -EBUSY if the read is still running
+ */
+static int nvme_async_complete(struct nvme_dev *dev, bool wait)
+{
+	struct nvme_ns *ns = dev->async_ns;
+	int ret;
+
+	while (ns) {
+		ret = nvme_complete_cmd(dev->queues[NVME_IO_Q], NULL);
+		if (ret == -EBUSY && timer_get_us() - dev->async_start >=
+		    IO_TIMEOUT * 100000)
+			ret = -ETIMEDOUT;
+		if (ret != -EBUSY) {
+			ns->async_ret = ret;
+			dev->async_ns = NULL;
+			break;
+		}
+		if (!wait)
+			return -EBUSY;
+	}
+
+	return 0;
+}
+
 static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 			 lbaint_t blkcnt, void *buffer, bool read)
 {
@@ -692,19 +741,14 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
 	u64 total_lbas = blkcnt;
 
+	/* A read for another namespace may be using the queue */
+	nvme_async_complete(dev, true);
+
 	if (!read)
 		flush_dcache_range((unsigned long)buffer,
 				   (unsigned long)buffer + total_len);
 
-	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
-	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
+	nvme_init_rw_cmd(ns, &c, read);
 
 	while (total_lbas) {
 		if (total_lbas < lbas) {
@@ -749,9 +793,92 @@ static ulong nvme_blk_write(struct udevice *udev, lbaint_t blknr,
 	return nvme_blk_rw(udev, blknr, blkcnt, (void *)buffer, false);
 }
 
+/* Send the read command for the next piece of @req */
+static int nvme_blk_read_next(struct udevice *udev, struct blk_req *req)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct nvme_command c;
+	void *buffer = req->buffer + (req->blks << ns->lba_shift);
+	lbaint_t lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
+	ulong len;
+	u64 prp2;
+
+	lbas = min(lbas, req->blkcnt - req->blks);
+	len = lbas << ns->lba_shift;
+	if (nvme_setup_prps(dev, &prp2, len, (ulong)buffer))
+		return -EIO;
+
+	/* Write back any dirty lines before the controller fills them */
+	flush_dcache_range((ulong)buffer, (ulong)buffer + len);
+
+	nvme_init_rw_cmd(ns, &c, true);
+	c.rw.slba = cpu_to_le64(req->start + req->blks);
+	c.rw.length = cpu_to_le16(lbas - 1);
+	c.rw.prp1 = cpu_to_le64((ulong)buffer);
+	c.rw.prp2 = cpu_to_le64(prp2);
+	c.common.command_id = nvme_get_cmd_id();
+	nvme_submit_cmd(dev->queues[NVME_IO_Q], &c);
+
+	ns->async_lbas = lbas;
+	ns->async_ret = -EINPROGRESS;
+	dev->async_ns = ns;
+	dev->async_start = timer_get_us();
+
+	return 0;
+}
+
+static int nvme_blk_read_start(struct udevice *udev, struct blk_req *req)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+
+	if (nvme_async_complete(ns->dev, false))
+		return -EBUSY;
+	ns->async_lbas = 0;
+	ns->async_ret = 0;
+	if (!req->blkcnt)
+		return 0;
+
+	return nvme_blk_read_next(udev, req);
+}
+
+static int nvme_blk_read_poll(struct udevice *udev, struct blk_req *req)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	void *buffer;
+	ulong len;
+	int ret;
+
+	nvme_async_complete(dev, false);
+	if (ns->async_ret == -EINPROGRESS)
+		return -EBUSY;
+	if (ns->async_ret)
+		return ns->async_ret;
+
+	if (ns->async_lbas) {
+		buffer = req->buffer + (req->blks << ns->lba_shift);
+		len = ns->async_lbas << ns->lba_shift;
+		invalidate_dcache_range((ulong)buffer, (ulong)buffer + len);
+		req->blks += ns->async_lbas;
+		ns->async_lbas = 0;
+	}
+	if (req->blks == req->blkcnt)
+		return 0;
+
+	/* Another namespace may have taken the queue in the meantime */
+	if (dev->async_ns)
+		return -EBUSY;
+	ret = nvme_blk_read_next(udev, req);
+
+	return ret ? ret : -EBUSY;
+}
+
 static const struct blk_ops nvme_blk_ops = {
 	.read	= nvme_blk_read,
 	.write	= nvme_blk_write,
+	.read_start	= nvme_blk_read_start,
+	.read_poll	= nvme_blk_read_poll,
 };
 
 U_BOOT_DRIVER(nvme_blk) = {
@@ -627,6 +627,9 @@ struct nvme_dev {
 	u64 *prp_pool;
 	u32 prp_entry_num;
 	u32 nn;
+	/* Namespace with a read in flight on the I/O queue, see read_start() */
+	struct nvme_ns *async_ns;
+	ulong async_start;	/* timer_get_us() when it was sent */
 };
 
 /*
@@ -642,6 +645,8 @@ struct nvme_ns {
 	u8 flbas;
 	u64 mode_select_num_blocks;
 	u32 mode_select_block_len;
+	lbaint_t async_lbas;	/* blocks read by the command in flight */
+	int async_ret;		/* -EINPROGRESS until it completes */
 };
 
 #endif /* __DRIVER_NVME_H__ */
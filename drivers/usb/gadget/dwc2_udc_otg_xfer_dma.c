@@ -92,12 +92,20 @@ static inline void dwc2_ep0_complete_out(void)
 static int setdma_rx(struct dwc2_ep *ep, struct dwc2_request *req)
 {
 	u32 *buf, ctrl;
-	u32 length, pktcnt;
+	u32 length, pktcnt, max;
 	u32 ep_num = ep_index(ep);
 
+	/*
+	 * Take in as much of the request as DOEPTSIZ allows, so that one
+	 * that is queued ahead is filled while the previous one completes
+	 */
+	if (ep_num == EP0_CON)
+		max = ep->ep.maxpacket;
+	else
+		max = rounddown(DOEPT_SIZ_XFER_SIZE_MAX_EP, ep->ep.maxpacket);
+
 	buf = req->req.buf + req->req.actual;
-	length = min_t(u32, req->req.length - req->req.actual,
-		       ep_num ? DMA_BUFFER_SIZE : ep->ep.maxpacket);
+	length = min_t(u32, req->req.length - req->req.actual, max);
 
 	ep->len = length;
 	ep->dma_buf = buf;
@@ -247,9 +255,23 @@ static void complete_rx(struct dwc2_udc *dev, u8 ep_num)
 			/* packet will be completed in complete_tx() */
 			dev->ep0state = WAIT_FOR_IN_COMPLETE;
 		} else {
+			struct dwc2_request *next = NULL;
+
+			/*
+			 * Have the controller fill the next request while this
+			 * one is completed, as that may take a while (eg. a
+			 * flash write)
+			 */
+			if (ep_num != EP0_CON &&
+			    !list_is_last(&req->queue, &ep->queue)) {
+				next = list_entry(req->queue.next,
+						  struct dwc2_request, queue);
+				setdma_rx(ep, next);
+			}
+
 			done(ep, req, 0);
 
-			if (!list_empty(&ep->queue)) {
+			if (!next && !list_empty(&ep->queue)) {
 				req = list_entry(ep->queue.next,
 					struct dwc2_request, queue);
 				debug_cond(DEBUG_OUT_EP != 0,
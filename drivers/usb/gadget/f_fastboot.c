@@ -36,12 +36,24 @@
  * that expect bulk OUT requests to be divisible by maxpacket size.
  */
 
+/*
+ * A download is received through RX_REQ_COUNT OUT requests of
+ * RX_BUFFER_SIZE each, so that the controller fills one while the data of
+ * another is handled. RX_BUFFER_SIZE must also be a multiple of maxpacket.
+ */
+#define RX_REQ_COUNT			2
+#define RX_BUFFER_SIZE			(64 * 1024)
+
 struct f_fastboot {
 	struct usb_function usb_function;
 
 	/* IN/OUT EP's and corresponding requests */
 	struct usb_ep *in_ep, *out_ep;
-	struct usb_request *in_req, *out_req;
+	struct usb_request *in_req;
+	/* Only one is queued for commands, all of them for a download */
+	struct usb_request *out_req[RX_REQ_COUNT];
+	/* Bytes of the download the queued OUT requests are waiting for */
+	unsigned int rx_queued;
 };
 
 static inline struct f_fastboot *func_to_fastboot(struct usb_function *f)
@@ -137,6 +149,7 @@ static struct usb_gadget_strings *fastboot_strings[] = {
 };
 
 static void rx_handler_command(struct usb_ep *ep, struct usb_request *req);
+static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req);
 
 static void fastboot_complete(struct usb_ep *ep, struct usb_request *req)
 {
@@ -200,14 +213,17 @@ static void fastboot_unbind(struct usb_configuration *c, struct usb_function *f)
 static void fastboot_disable(struct usb_function *f)
 {
 	struct f_fastboot *f_fb = func_to_fastboot(f);
+	int i;
 
 	usb_ep_disable(f_fb->out_ep);
 	usb_ep_disable(f_fb->in_ep);
 
-	if (f_fb->out_req) {
-		free(f_fb->out_req->buf);
-		usb_ep_free_request(f_fb->out_ep, f_fb->out_req);
-		f_fb->out_req = NULL;
+	for (i = 0; i < RX_REQ_COUNT; i++) {
+		if (!f_fb->out_req[i])
+			continue;
+		free(f_fb->out_req[i]->buf);
+		usb_ep_free_request(f_fb->out_ep, f_fb->out_req[i]);
+		f_fb->out_req[i] = NULL;
 	}
 	if (f_fb->in_req) {
 		free(f_fb->in_req->buf);
@@ -216,7 +232,8 @@ static void fastboot_disable(struct usb_function *f)
 	}
 }
 
-static struct usb_request *fastboot_start_ep(struct usb_ep *ep)
+static struct usb_request *fastboot_start_ep(struct usb_ep *ep,
+					     unsigned int size)
 {
 	struct usb_request *req;
 
@@ -225,13 +242,13 @@ static struct usb_request *fastboot_start_ep(struct usb_ep *ep)
 		return NULL;
 
 	req->length = EP_BUFFER_SIZE;
-	req->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, EP_BUFFER_SIZE);
+	req->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, size);
 	if (!req->buf) {
 		usb_ep_free_request(ep, req);
 		return NULL;
 	}
 
-	memset(req->buf, 0, req->length);
+	memset(req->buf, 0, size);
 	return req;
 }
 
@@ -243,6 +260,7 @@ static int fastboot_set_alt(struct usb_function *f,
 	struct usb_gadget *gadget = cdev->gadget;
 	struct f_fastboot *f_fb = func_to_fastboot(f);
 	const struct usb_endpoint_descriptor *d;
+	int i;
 
 	debug("%s: func: %s intf: %d alt: %d\n",
 	      __func__, f->name, interface, alt);
@@ -254,13 +272,16 @@ static int fastboot_set_alt(struct usb_function *f,
 		return ret;
 	}
 
-	f_fb->out_req = fastboot_start_ep(f_fb->out_ep);
-	if (!f_fb->out_req) {
-		puts("failed to alloc out req\n");
-		ret = -EINVAL;
-		goto err;
+	for (i = 0; i < RX_REQ_COUNT; i++) {
+		f_fb->out_req[i] = fastboot_start_ep(f_fb->out_ep,
+						     RX_BUFFER_SIZE);
+		if (!f_fb->out_req[i]) {
+			puts("failed to alloc out req\n");
+			ret = -EINVAL;
+			goto err;
+		}
+		f_fb->out_req[i]->complete = rx_handler_command;
 	}
-	f_fb->out_req->complete = rx_handler_command;
 
 	d = fb_ep_desc(gadget, &fs_ep_in, &hs_ep_in);
 	ret = usb_ep_enable(f_fb->in_ep, d);
@@ -269,7 +290,7 @@ static int fastboot_set_alt(struct usb_function *f,
 		goto err;
 	}
 
-	f_fb->in_req = fastboot_start_ep(f_fb->in_ep);
+	f_fb->in_req = fastboot_start_ep(f_fb->in_ep, EP_BUFFER_SIZE);
 	if (!f_fb->in_req) {
 		puts("failed alloc req in\n");
 		ret = -EINVAL;
@@ -277,7 +298,7 @@ static int fastboot_set_alt(struct usb_function *f,
 	}
 	f_fb->in_req->complete = fastboot_complete;
 
-	ret = usb_ep_queue(f_fb->out_ep, f_fb->out_req, 0);
+	ret = usb_ep_queue(f_fb->out_ep, f_fb->out_req[0], 0);
 	if (ret)
 		goto err;
 
@@ -348,14 +369,15 @@ static void compl_do_reset(struct usb_ep *ep, struct usb_request *req)
 
 static unsigned int rx_bytes_expected(struct usb_ep *ep)
 {
-	int rx_remain = fastboot_data_remaining();
+	/* Leave out what the requests already queued are waiting for */
+	int rx_remain = fastboot_data_remaining() - fastboot_func->rx_queued;
 	unsigned int rem;
 	unsigned int maxpacket = ep->maxpacket;
 
 	if (rx_remain <= 0)
 		return 0;
-	else if (rx_remain > EP_BUFFER_SIZE)
-		return EP_BUFFER_SIZE;
+	else if (rx_remain > RX_BUFFER_SIZE)
+		return RX_BUFFER_SIZE;
 
 	/*
 	 * Some controllers e.g. DWC3 don't like OUT transfers to be
@@ -370,6 +392,27 @@ static unsigned int rx_bytes_expected(struct usb_ep *ep)
 	return rx_remain;
 }
 
+/**
+ * rx_queue_dl() - Queue an idle OUT request for more of the download
+ *
+ * @ep: OUT endpoint
+ * @req: Request that is not queued
+ *
+ * The request is left idle if the rest of the download is already expected
+ * by other requests.
+ */
+static void rx_queue_dl(struct usb_ep *ep, struct usb_request *req)
+{
+	req->length = rx_bytes_expected(ep);
+	if (!req->length)
+		return;
+
+	req->complete = rx_handler_dl_image;
+	req->actual = 0;
+	if (!usb_ep_queue(ep, req, 0))
+		fastboot_func->rx_queued += req->length;
+}
+
 static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 {
 	char response[FASTBOOT_RESPONSE_LEN] = {0};
@@ -377,6 +420,11 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 	const unsigned char *buffer = req->buf;
 	unsigned int buffer_size = req->actual;
 
+	/*
+	 * The other requests go on receiving while this one is handled, so
+	 * the host is not held up while the data is written out
+	 */
+	fastboot_func->rx_queued -= req->length;
 	if (req->status != 0) {
 		printf("Bad status: %d\n", req->status);
 		return;
@@ -386,9 +434,7 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 		transfer_size = buffer_size;
 
 	fastboot_data_download(buffer, transfer_size, response);
-	if (response[0]) {
-		fastboot_tx_write_str(response);
-	} else if (!fastboot_data_remaining()) {
+	if (!response[0] && !fastboot_data_remaining()) {
 		fastboot_data_complete(response);
 
 		/*
@@ -398,12 +444,15 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 		req->length = EP_BUFFER_SIZE;
 
 		fastboot_tx_write_str(response);
-	} else {
-		req->length = rx_bytes_expected(ep);
+
+		req->actual = 0;
+		usb_ep_queue(ep, req, 0);
+		return;
 	}
 
-	req->actual = 0;
-	usb_ep_queue(ep, req, 0);
+	if (response[0])
+		fastboot_tx_write_str(response);
+	rx_queue_dl(ep, req);
 }
 
 static void do_exit_on_complete(struct usb_ep *ep, struct usb_request *req)
@@ -421,7 +470,9 @@ static void rx_handler_command(struct usb_ep *ep, struct usb_request *req)
 {
 	char *cmdbuf = req->buf;
 	char response[FASTBOOT_RESPONSE_LEN] = {0};
+	bool download = false;
 	int cmd = -1;
+	int i;
 
 	if (req->status != 0 || req->length == 0)
 		return;
@@ -434,10 +485,8 @@ static void rx_handler_command(struct usb_ep *ep, struct usb_request *req)
 		fastboot_fail("buffer overflow", response);
 	}
 
-	if (!strncmp("DATA", response, 4)) {
-		req->complete = rx_handler_dl_image;
-		req->length = rx_bytes_expected(ep);
-	}
+	if (!strncmp("DATA", response, 4))
+		download = true;
 
 	fastboot_tx_write_str(response);
 
@@ -459,6 +508,16 @@ static void rx_handler_command(struct usb_ep *ep, struct usb_request *req)
 	}
 
 	*cmdbuf = '\0';
+	if (download) {
+		/* Queue every OUT request, this one first */
+		fastboot_func->rx_queued = 0;
+		rx_queue_dl(ep, req);
+		for (i = 0; i < RX_REQ_COUNT; i++) {
+			if (fastboot_func->out_req[i] != req)
+				rx_queue_dl(ep, fastboot_func->out_req[i]);
+		}
+		return;
+	}
 	req->actual = 0;
 	usb_ep_queue(ep, req, 0);
 }
@@ -29,6 +29,7 @@
 #include <search.h>
 #include <errno.h>
 #include <ext4fs.h>
+#include <fs.h>
 #include <mmc.h>
 
 __weak const char *env_ext4_get_intf(void)
@@ -62,6 +63,7 @@ static int env_ext4_save(void)
 		return 1;
 
 	dev = dev_desc->devnum;
+	fs_unmount();
 	ext4fs_set_blk_dev(dev_desc, &info);
 
 	if (!ext4fs_mount(info.size)) {
@@ -107,6 +109,7 @@ static int env_ext4_load(void)
 		goto err_env_relocate;
 
 	dev = dev_desc->devnum;
+	fs_unmount();
 	ext4fs_set_blk_dev(dev_desc, &info);
 
 	if (!ext4fs_mount(info.size)) {
@@ -17,6 +17,7 @@
 #include <search.h>
 #include <errno.h>
 #include <fat.h>
+#include <fs.h>
 #include <mmc.h>
 
 #ifdef CONFIG_SPL_BUILD
@@ -52,6 +53,7 @@ static int env_fat_save(void)
 		return 1;
 
 	dev = dev_desc->devnum;
+	fs_unmount();
 	if (fat_set_blk_dev(dev_desc, &info) != 0) {
 		/*
 		 * This printf is embedded in the messages from env_save that
@@ -99,6 +101,7 @@ static int env_fat_load(void)
 		goto err_env_relocate;
 
 	dev = dev_desc->devnum;
+	fs_unmount();
 	if (fat_set_blk_dev(dev_desc, &info) != 0) {
 		/*
 		 * This printf is embedded in the messages from env_save that
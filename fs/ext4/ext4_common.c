@@ -1522,10 +1522,15 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 
 #endif
 
+/*
+ * Descend the extent tree to the leaf covering fileblock. If end is not NULL,
+ * it is lowered to the first logical block of the next subtree, so that the
+ * leaf is known to cover up to there.
+ */
 static struct ext4_extent_header *ext4fs_get_extent_block
 	(struct ext2_data *data, struct ext_block_cache *cache,
 		struct ext4_extent_header *ext_block,
-		uint32_t fileblock, int log2_blksz)
+		uint32_t fileblock, int log2_blksz, uint32_t *end)
 {
 	struct ext4_extent_idx *index;
 	unsigned long long block;
@@ -1553,6 +1558,8 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 		 */
 		if (i > 0)
 			i--;
+		if (end && i + 1 < le16_to_cpu(ext_block->eh_entries))
+			*end = min(*end, le32_to_cpu(index[i + 1].ei_block));
 
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
@@ -1672,7 +1679,7 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			ext4fs_get_extent_block(ext4fs_root, c,
 						(struct ext4_extent_header *)
 						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
+						fileblock, log2_blksz, NULL);
 		if (!ext_block) {
 			printf("invalid extent block\n");
 			if (!cache)
@@ -1992,6 +1999,90 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	return blknr;
 }
 
+/*
+ * Map the run of blocks starting at fileblock from a single walk of the
+ * extent tree. Unwritten extents read as zeroes, so they are returned as holes.
+ */
+static long int read_extent_run(struct ext2_inode *inode, int fileblock,
+				int maxblocks, int *count,
+				struct ext_block_cache *cache)
+{
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent *extent;
+	uint32_t startblock, len, end = UINT32_MAX;
+	unsigned long long start;
+	int log2_blksz;
+	bool unwritten;
+	int i;
+
+	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
+		- get_fs()->dev_desc->log2blksz;
+	ext_block = ext4fs_get_extent_block(ext4fs_root, cache,
+					    (struct ext4_extent_header *)
+					    inode->b.blocks.dir_blocks,
+					    fileblock, log2_blksz, &end);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		return -EINVAL;
+	}
+
+	extent = (struct ext4_extent *)(ext_block + 1);
+	for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
+		startblock = le32_to_cpu(extent[i].ee_block);
+		len = le16_to_cpu(extent[i].ee_len);
+		unwritten = len > EXT4_EXT_INIT_MAX_LEN;
+		if (unwritten)
+			len -= EXT4_EXT_INIT_MAX_LEN;
+
+		if (startblock > fileblock) {
+			/* Sparse file, up to this extent */
+			end = startblock;
+			break;
+		} else if (fileblock < startblock + len) {
+			*count = min_t(uint32_t, startblock + len - fileblock,
+				       maxblocks);
+			if (unwritten)
+				return 0;
+			start = le16_to_cpu(extent[i].ee_start_hi);
+			start = (start << 32) +
+				le32_to_cpu(extent[i].ee_start_lo);
+			return (fileblock - startblock) + start;
+		}
+	}
+
+	/* Sparse file, up to the next extent or subtree */
+	*count = min_t(uint32_t, end - fileblock, maxblocks);
+
+	return 0;
+}
+
+long int read_allocated_run(struct ext2_inode *inode, int fileblock,
+			    int maxblocks, int *count,
+			    struct ext_block_cache *cache)
+{
+	long int blknr, next;
+	int n;
+
+	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL)
+		return read_extent_run(inode, fileblock, maxblocks, count,
+				       cache);
+
+	/* Block maps have no runs, so merge the blocks which follow on */
+	blknr = read_allocated_block(inode, fileblock, cache);
+	if (blknr < 0)
+		return blknr;
+	for (n = 1; n < maxblocks; n++) {
+		next = read_allocated_block(inode, fileblock + n, cache);
+		if (next < 0)
+			return next;
+		if (next != (blknr ? blknr + n : 0))
+			break;
+	}
+	*count = n;
+
+	return blknr;
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -2039,36 +2130,42 @@ void ext4fs_close(void)
 	ext4fs_reinit_global();
 }
 
-int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
-				struct ext2fs_node **fnode, int *ftype)
+int ext4fs_scan_dir(struct ext2fs_node *diro, char *name,
+		    struct ext2fs_node **fnode, int *ftype,
+		    unsigned int fpos, unsigned int fend)
 {
-	unsigned int fpos = 0;
+	int blksz = EXT2_BLOCK_SIZE(diro->data);
+	unsigned int blkpos = 0, blklen = 0;
 	int status;
 	loff_t actread;
-	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
+	char *block;
 
-#ifdef DEBUG
-	if (name != NULL)
-		printf("Iterate dir %s\n", name);
-#endif /* of DEBUG */
-	if (!diro->inode_read) {
-		status = ext4fs_read_inode(diro->data, diro->ino, &diro->inode);
-		if (status == 0)
-			return 0;
-	}
-	/* Search the file.  */
-	while (fpos < le32_to_cpu(diro->inode.size)) {
-		struct ext2_dirent dirent;
+	block = malloc(blksz);
+	if (!block)
+		return 0;
 
-		status = ext4fs_read_file(diro, fpos,
-					   sizeof(struct ext2_dirent),
-					   (char *)&dirent, &actread);
-		if (status < 0)
-			return 0;
+	/* Search the file, reading one block of it at a time.  */
+	while (fpos < fend) {
+		struct ext2_dirent dirent;
 
-		if (dirent.direntlen == 0) {
+		if (fpos < blkpos || fpos >= blkpos + blklen) {
+			blkpos = fpos & ~(blksz - 1);
+			status = ext4fs_read_file(diro, blkpos, blksz, block,
+						  &actread);
+			if (status < 0)
+				break;
+			blklen = actread;
+		}
+		if (fpos + sizeof(struct ext2_dirent) > blkpos + blklen)
+			dirent.direntlen = 0;
+		else
+			memcpy(&dirent, block + fpos - blkpos,
+			       sizeof(struct ext2_dirent));
+
+		if (dirent.direntlen == 0 || fpos + sizeof(struct ext2_dirent) +
+		    dirent.namelen > blkpos + blklen) {
 			printf("Failed to iterate over directory %s\n", name);
-			return 0;
+			break;
 		}
 
 		if (dirent.namelen != 0) {
@@ -2076,17 +2173,12 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			struct ext2fs_node *fdiro;
 			int type = FILETYPE_UNKNOWN;
 
-			status = ext4fs_read_file(diro,
-						  fpos +
-						  sizeof(struct ext2_dirent),
-						  dirent.namelen, filename,
-						  &actread);
-			if (status < 0)
-				return 0;
+			memcpy(filename, block + fpos - blkpos +
+			       sizeof(struct ext2_dirent), dirent.namelen);
 
 			fdiro = zalloc(sizeof(struct ext2fs_node));
 			if (!fdiro)
-				return 0;
+				break;
 
 			fdiro->data = diro->data;
 			fdiro->ino = le32_to_cpu(dirent.inode);
@@ -2109,7 +2201,7 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 							   &fdiro->inode);
 				if (status == 0) {
 					free(fdiro);
-					return 0;
+					break;
 				}
 				fdiro->inode_read = 1;
 
@@ -2135,6 +2227,7 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 				if (strcmp(filename, name) == 0) {
 					*ftype = type;
 					*fnode = fdiro;
+					free(block);
 					return 1;
 				}
 			} else {
@@ -2145,7 +2238,7 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 								 &fdiro->inode);
 					if (status == 0) {
 						free(fdiro);
-						return 0;
+						break;
 					}
 					fdiro->inode_read = 1;
 				}
@@ -2171,9 +2264,38 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 		}
 		fpos += le16_to_cpu(dirent.direntlen);
 	}
+	free(block);
+
 	return 0;
 }
 
+int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
+				struct ext2fs_node **fnode, int *ftype)
+{
+	int status;
+	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
+
+#ifdef DEBUG
+	if (name != NULL)
+		printf("Iterate dir %s\n", name);
+#endif /* of DEBUG */
+	if (!diro->inode_read) {
+		status = ext4fs_read_inode(diro->data, diro->ino, &diro->inode);
+		if (status == 0)
+			return 0;
+	}
+
+	/* Walk the hashed index down to the block holding the name */
+	if (CONFIG_IS_ENABLED(EXT4_HTREE) && name && fnode && ftype) {
+		status = ext4fs_htree_find(diro, name, fnode, ftype);
+		if (status >= 0)
+			return status;
+	}
+
+	return ext4fs_scan_dir(diro, name, fnode, ftype, 0,
+			       le32_to_cpu(diro->inode.size));
+}
+
 static char *ext4fs_read_symlink(struct ext2fs_node *node)
 {
 	char *symlink;
@@ -2338,7 +2460,11 @@ int ext4fs_open(const char *filename, loff_t *len)
 	if (ext4fs_root == NULL)
 		return -1;
 
-	ext4fs_file = NULL;
+	/* The file system may stay mounted across several opens */
+	if (ext4fs_file) {
+		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
+		ext4fs_file = NULL;
+	}
 	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
 				  FILETYPE_REG);
 	if (status == 0)
@@ -56,6 +56,34 @@ int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			struct ext2fs_node **fnode, int *ftype);
 
+/**
+ * ext4fs_scan_dir() - Look for a name in part of a directory, or list it
+ *
+ * @diro:	Directory node, with its inode read
+ * @name:	Name to look for, or NULL to list the entries
+ * @fnode:	Returns the node found, or NULL to list them
+ * @ftype:	Returns the type of the node found, or NULL to list them
+ * @fpos:	Offset of the first entry in the directory
+ * @fend:	Offset of the end of the entries to scan
+ * @return 1 if found, 0 if not found or on error
+ */
+int ext4fs_scan_dir(struct ext2fs_node *diro, char *name,
+		    struct ext2fs_node **fnode, int *ftype,
+		    unsigned int fpos, unsigned int fend);
+
+/**
+ * ext4fs_htree_find() - Look for a name using the hashed index of a directory
+ *
+ * @diro:	Directory node, with its inode read
+ * @name:	Name to look for
+ * @fnode:	Returns the node found
+ * @ftype:	Returns the type of the node found
+ * @return 1 if found, 0 if not found, -ve if the directory must be scanned
+ * instead (no index, index not understood or error)
+ */
+int ext4fs_htree_find(struct ext2fs_node *diro, char *name,
+		      struct ext2fs_node **fnode, int *ftype);
+
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n);
 uint16_t ext4fs_checksum_update(unsigned int i);
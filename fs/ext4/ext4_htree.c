@@ -0,0 +1,361 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Lookups in ext4 directories with a hashed index (HTree)
+ *
+ * An indexed directory starts with a dx_root block, which holds a sorted
+ * table of (hash, block) pairs after the "." and ".." entries, possibly
+ * pointing at dx_node blocks with more such tables. The leaf blocks are plain
+ * directory blocks, each holding the names whose hash lies between its own
+ * entry and the next one.
+ *
+ * The hashes follow the Linux kernel implementation (fs/ext4/hash.c).
+ */
+
+#include <common.h>
+#include <ext4fs.h>
+#include <ext_common.h>
+#include <malloc.h>
+#include "ext4_common.h"
+
+#define EXT4_FEATURE_COMPAT_DIR_INDEX	0x0020
+#define EXT2_FLAGS_UNSIGNED_HASH	0x0002
+
+enum {
+	DX_HASH_LEGACY,
+	DX_HASH_HALF_MD4,
+	DX_HASH_TEA,
+	DX_HASH_LEGACY_UNSIGNED,
+	DX_HASH_HALF_MD4_UNSIGNED,
+	DX_HASH_TEA_UNSIGNED,
+};
+
+/* Index levels below the root, without the largedir feature */
+#define DX_MAX_LEVELS	2
+
+struct dx_root_info {
+	__le32 reserved_zero;
+	u8 hash_version;
+	u8 info_length;		/* 8 */
+	u8 indirect_levels;
+	u8 unused_flags;
+};
+
+struct dx_entry {
+	__le32 hash;
+	__le32 block;
+};
+
+/* Replaces the hash of the first entry in each table */
+struct dx_countlimit {
+	__le16 limit;
+	__le16 count;
+};
+
+/* "." and ".." take 12 bytes each in the root block */
+#define DX_ROOT_INFO_OFFSET	24
+/* A dx_node starts with an empty entry covering the whole block */
+#define DX_NODE_OFFSET		8
+
+#define TEA_DELTA		0x9e3779b9
+
+static void dx_tea_transform(u32 buf[4], const u32 in[4])
+{
+	u32 sum = 0;
+	u32 b0 = buf[0], b1 = buf[1];
+	u32 a = in[0], b = in[1], c = in[2], d = in[3];
+	int n = 16;
+
+	do {
+		sum += TEA_DELTA;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	} while (--n);
+
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+#define F(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z)	(((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z)	((x) ^ (y) ^ (z))
+
+#define ROUND(f, a, b, c, d, x, s)	\
+	(a += f(b, c, d) + (x), a = (a << (s)) | (a >> (32 - (s))))
+#define K1	0
+#define K2	013240474631UL
+#define K3	015666365641UL
+
+/* The first three rounds of MD4, on half a block */
+static void dx_half_md4_transform(u32 buf[4], const u32 in[8])
+{
+	u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	ROUND(F, a, b, c, d, in[0] + K1, 3);
+	ROUND(F, d, a, b, c, in[1] + K1, 7);
+	ROUND(F, c, d, a, b, in[2] + K1, 11);
+	ROUND(F, b, c, d, a, in[3] + K1, 19);
+	ROUND(F, a, b, c, d, in[4] + K1, 3);
+	ROUND(F, d, a, b, c, in[5] + K1, 7);
+	ROUND(F, c, d, a, b, in[6] + K1, 11);
+	ROUND(F, b, c, d, a, in[7] + K1, 19);
+
+	ROUND(G, a, b, c, d, in[1] + K2, 3);
+	ROUND(G, d, a, b, c, in[3] + K2, 5);
+	ROUND(G, c, d, a, b, in[5] + K2, 9);
+	ROUND(G, b, c, d, a, in[7] + K2, 13);
+	ROUND(G, a, b, c, d, in[0] + K2, 3);
+	ROUND(G, d, a, b, c, in[2] + K2, 5);
+	ROUND(G, c, d, a, b, in[4] + K2, 9);
+	ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+	ROUND(H, a, b, c, d, in[3] + K3, 3);
+	ROUND(H, d, a, b, c, in[7] + K3, 9);
+	ROUND(H, c, d, a, b, in[2] + K3, 11);
+	ROUND(H, b, c, d, a, in[6] + K3, 15);
+	ROUND(H, a, b, c, d, in[1] + K3, 3);
+	ROUND(H, d, a, b, c, in[5] + K3, 9);
+	ROUND(H, c, d, a, b, in[0] + K3, 11);
+	ROUND(H, b, c, d, a, in[4] + K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+/* Value of a name character, which depends on the signedness of char */
+static inline int dx_char(const char *name, int i, bool is_unsigned)
+{
+	return is_unsigned ? (int)(unsigned char)name[i] :
+		(int)(signed char)name[i];
+}
+
+/* The legacy hash, from the first ext3 HTree implementation */
+static u32 dx_hack_hash(const char *name, int len, bool is_unsigned)
+{
+	u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		hash = hash1 + (hash0 ^ (dx_char(name, i, is_unsigned) *
+					 7152373));
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+
+	return hash0 << 1;
+}
+
+/* Pack up to num words of the name, padded with its length */
+static void dx_str2hashbuf(const char *msg, int len, u32 *buf, int num,
+			   bool is_unsigned)
+{
+	u32 pad, val;
+	int i;
+
+	pad = (u32)len | ((u32)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		val = dx_char(msg, i, is_unsigned) + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+/**
+ * ext4fs_dx_hash() - Compute the major hash of a name in an indexed directory
+ *
+ * @name:	Name to hash
+ * @len:	Length of @name
+ * @version:	Hash algorithm (DX_HASH_...)
+ * @seed:	Hash seed from the superblock
+ * @hash:	Returns the hash, with the lowest bit clear
+ * @return 0 if OK, -EINVAL if @version is not known
+ */
+static int ext4fs_dx_hash(const char *name, int len, int version,
+			  const __le32 seed[4], u32 *hash)
+{
+	u32 buf[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+	bool is_unsigned = version >= DX_HASH_LEGACY_UNSIGNED;
+	u32 in[8];
+	int i;
+
+	/* An all-zero seed means the default one */
+	for (i = 0; i < 4; i++) {
+		if (seed[i]) {
+			for (i = 0; i < 4; i++)
+				buf[i] = le32_to_cpu(seed[i]);
+			break;
+		}
+	}
+
+	switch (version) {
+	case DX_HASH_LEGACY:
+	case DX_HASH_LEGACY_UNSIGNED:
+		*hash = dx_hack_hash(name, len, is_unsigned);
+		break;
+	case DX_HASH_HALF_MD4:
+	case DX_HASH_HALF_MD4_UNSIGNED:
+		for (i = 0; i < len; i += 32) {
+			dx_str2hashbuf(name + i, len - i, in, 8, is_unsigned);
+			dx_half_md4_transform(buf, in);
+		}
+		*hash = buf[1];
+		break;
+	case DX_HASH_TEA:
+	case DX_HASH_TEA_UNSIGNED:
+		for (i = 0; i < len; i += 16) {
+			dx_str2hashbuf(name + i, len - i, in, 4, is_unsigned);
+			dx_tea_transform(buf, in);
+		}
+		*hash = buf[0];
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* The lowest bit flags collisions and the top value marks the end */
+	*hash &= ~1;
+	if (*hash == 0xfffffffe)
+		*hash = 0xfffffffc;
+
+	return 0;
+}
+
+/*
+ * Find the entry covering hash in a table of count entries, of which the
+ * first has an implicit hash of 0
+ */
+static struct dx_entry *dx_find_entry(struct dx_entry *entries, int count,
+				      u32 hash)
+{
+	int lo = 1, hi = count - 1, mid;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (le32_to_cpu(entries[mid].hash) > hash)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+
+	return &entries[lo - 1];
+}
+
+/* Read the table of a dx_root or dx_node block, checking its bounds */
+static struct dx_entry *dx_read_table(struct ext2fs_node *diro, u32 block,
+				      char *buf, int offset, int *count)
+{
+	int blksz = EXT2_BLOCK_SIZE(diro->data);
+	struct dx_countlimit *cl;
+	loff_t actread;
+	int limit;
+
+	if (ext4fs_read_file(diro, (loff_t)block * blksz, blksz, buf,
+			     &actread) < 0 || actread != blksz)
+		return NULL;
+
+	cl = (struct dx_countlimit *)(buf + offset);
+	limit = le16_to_cpu(cl->limit);
+	*count = le16_to_cpu(cl->count);
+	if (!*count || *count > limit ||
+	    offset + limit * sizeof(struct dx_entry) > blksz)
+		return NULL;
+
+	return (struct dx_entry *)cl;
+}
+
+int ext4fs_htree_find(struct ext2fs_node *diro, char *name,
+		      struct ext2fs_node **fnode, int *ftype)
+{
+	struct ext2_sblock *sblock = &diro->data->sblock;
+	int blksz = EXT2_BLOCK_SIZE(diro->data);
+	struct dx_entry *entries, *at;
+	struct dx_root_info *info;
+	int count, depth, level, version, ret = -ENOENT;
+	loff_t actread;
+	u32 hash, next;
+	char *buf;
+
+	/*
+	 * Casefolded and encrypted directories hash another form of the name,
+	 * so they are left to the full scan
+	 */
+	if (!(le32_to_cpu(sblock->feature_compatibility) &
+	      EXT4_FEATURE_COMPAT_DIR_INDEX) ||
+	    (le32_to_cpu(diro->inode.flags) &
+	     (EXT4_INDEX_FL | EXT4_CASEFOLD_FL | EXT4_ENCRYPT_FL)) !=
+	    EXT4_INDEX_FL)
+		return -ENOENT;
+
+	buf = malloc(blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	/* The root info follows the "." and ".." entries */
+	if (ext4fs_read_file(diro, 0, blksz, buf, &actread) < 0 ||
+	    actread != blksz)
+		goto out;
+	info = (struct dx_root_info *)(buf + DX_ROOT_INFO_OFFSET);
+	depth = info->indirect_levels;
+	if (info->reserved_zero || info->info_length != 8 ||
+	    depth > DX_MAX_LEVELS)
+		goto out;
+
+	/* The root gives the algorithm, the superblock its signedness */
+	version = info->hash_version;
+	if (version <= DX_HASH_TEA &&
+	    (le32_to_cpu(sblock->flags) & EXT2_FLAGS_UNSIGNED_HASH))
+		version += DX_HASH_LEGACY_UNSIGNED;
+	if (ext4fs_dx_hash(name, strlen(name), version, sblock->hash_seed,
+			   &hash))
+		goto out;
+
+	entries = dx_read_table(diro, 0, buf,
+				DX_ROOT_INFO_OFFSET + info->info_length,
+				&count);
+	for (level = 0; entries && level < depth; level++) {
+		at = dx_find_entry(entries, count, hash);
+		entries = dx_read_table(diro, le32_to_cpu(at->block), buf,
+					DX_NODE_OFFSET, &count);
+	}
+	if (!entries)
+		goto out;
+
+	/*
+	 * Names with the same hash may spill over to the next leaf, whose
+	 * entry then has the lowest bit of its hash set
+	 */
+	for (at = dx_find_entry(entries, count, hash); ; at++) {
+		ret = ext4fs_scan_dir(diro, name, fnode, ftype,
+				      le32_to_cpu(at->block) * blksz,
+				      (le32_to_cpu(at->block) + 1) * blksz);
+		if (ret || at + 1 == entries + count)
+			break;
+		next = le32_to_cpu(at[1].hash);
+		if (!(next & 1) || (next & ~1) != hash)
+			goto out;
+	}
+
+	/* The chain may go on in the next node, which a full scan covers */
+	if (!ret && depth)
+		ret = -ENOENT;
+
+out:
+	free(buf);
+
+	return ret;
+}
@@ -41,28 +41,20 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 }
 
 /*
- * Taken from openmoko-kernel mailing list: By Andy green
- * Optimized read file API : collects and defers contiguous sector
- * reads into one potentially more efficient larger sequential read action
+ * Read the file one run of blocks at a time, as found by read_allocated_run():
+ * each extent is read with a single device access, and holes are zeroed.
  */
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
-	lbaint_t blockcnt;
+	lbaint_t blockcnt, fileblock;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
 	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
 	unsigned int filesize = le32_to_cpu(node->inode.size);
-	lbaint_t previous_block_number = -1;
-	lbaint_t delayed_start = 0;
-	lbaint_t delayed_extent = 0;
-	lbaint_t delayed_skipfirst = 0;
-	lbaint_t delayed_next = 0;
-	char *delayed_buf = NULL;
-	char *start_buf = buf;
-	short status;
+	loff_t left;
+	int skipfirst, count;
 	struct ext_block_cache cache;
 
 	ext_cache_init(&cache);
@@ -77,101 +69,41 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 	}
 
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
+	fileblock = lldiv(pos, blocksize);
+	skipfirst = pos - (blocksize * fileblock);
 
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
+	for (left = len; left > 0; fileblock += count) {
 		long int blknr;
-		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
-		int skipfirst = 0;
-		blknr = read_allocated_block(&node->inode, i, &cache);
+		int status;
+		loff_t n;
+
+		blknr = read_allocated_run(&node->inode, fileblock,
+					   blockcnt - fileblock, &count,
+					   &cache);
 		if (blknr < 0) {
 			ext_cache_fini(&cache);
 			return -1;
 		}
 
-		blknr = blknr << log2_fs_blocksize;
-
-		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
-
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
-		}
-
-		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
-			skipfirst = blockoff;
-			blockend -= skipfirst;
-		}
+		/* Up to `len' bytes, from skipfirst in the first block */
+		n = ((loff_t)count << (log2_fs_blocksize + log2blksz)) -
+			skipfirst;
+		if (n > left)
+			n = left;
 		if (blknr) {
-			int status;
-
-			if (previous_block_number != -1) {
-				if (delayed_next == blknr) {
-					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
-				} else {	/* spill */
-					status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-					if (status == 0) {
-						ext_cache_fini(&cache);
-						return -1;
-					}
-					previous_block_number = blknr;
-					delayed_start = blknr;
-					delayed_extent = blockend;
-					delayed_skipfirst = skipfirst;
-					delayed_buf = buf;
-					delayed_next = blknr +
-						(blockend >> log2blksz);
-				}
-			} else {
-				previous_block_number = blknr;
-				delayed_start = blknr;
-				delayed_extent = blockend;
-				delayed_skipfirst = skipfirst;
-				delayed_buf = buf;
-				delayed_next = blknr +
-					(blockend >> log2blksz);
+			status = ext4fs_devread((lbaint_t)blknr <<
+						log2_fs_blocksize, skipfirst,
+						n, buf);
+			if (status == 0) {
+				ext_cache_fini(&cache);
+				return -1;
 			}
 		} else {
-			int n;
-			int n_left;
-			if (previous_block_number != -1) {
-				/* spill */
-				status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-				if (status == 0) {
-					ext_cache_fini(&cache);
-					return -1;
-				}
-				previous_block_number = -1;
-			}
-			/* Zero no more than `len' bytes. */
-			n = blocksize - skipfirst;
-			n_left = len - ( buf - start_buf );
-			if (n > n_left)
-				n = n_left;
 			memset(buf, 0, n);
 		}
-		buf += blocksize - skipfirst;
-	}
-	if (previous_block_number != -1) {
-		/* spill */
-		status = ext4fs_devread(delayed_start,
-					delayed_skipfirst, delayed_extent,
-					delayed_buf);
-		if (status == 0) {
-			ext_cache_fini(&cache);
-			return -1;
-		}
-		previous_block_number = -1;
+		buf += n;
+		left -= n;
+		skipfirst = 0;
 	}
 
 	*actread  = len;
@@ -20,6 +20,7 @@
 #include <memalign.h>
 #include <linux/compiler.h>
 #include <linux/ctype.h>
+#include <linux/math64.h>
 
 /*
  * Convert a string to lowercase.  Converts at most 'len' characters,
@@ -37,6 +38,8 @@ static void downcase(char *str, size_t len)
 static struct blk_desc *cur_dev;
 static disk_partition_t cur_part_info;
 
+static void fat_map_invalidate(void);
+
 #define DOS_BOOT_MAGIC_OFFSET	0x1fe
 #define DOS_FS_TYPE_OFFSET	0x36
 #define DOS_FS32_TYPE_OFFSET	0x52
@@ -62,6 +65,7 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, disk_partition_t *info)
 
 	cur_dev = dev_desc;
 	cur_part_info = *info;
+	fat_map_invalidate();
 
 	/* Make sure it has a valid FAT header */
 	if (disk_read(0, 1, buffer) != 1) {
@@ -239,6 +243,140 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	return ret;
 }
 
+/*
+ * Extent map of the file being accessed: its cluster chain as runs of
+ * consecutive clusters. It is extended as far as needed while the file is
+ * read or written, so that seeking into a file does not walk its chain one
+ * FAT entry at a time on each access. It is dropped when the file system is
+ * closed or the FAT is modified.
+ */
+struct fat_extent {
+	__u32	index;		/* Index of clust within the file */
+	__u32	clust;		/* First cluster of the run */
+	__u32	count;		/* Number of clusters in the run */
+};
+
+static struct {
+	__u32	start;		/* First cluster of the file */
+	struct fat_extent *ext;
+	int	count;		/* Number of runs in ext */
+	int	size;		/* Room in ext, in runs */
+	__u32	nclust;		/* Number of clusters mapped */
+	bool	eoc;		/* The end of chain was found */
+	bool	bad;		/* An invalid entry was found */
+} fat_map;
+
+static void fat_map_invalidate(void)
+{
+	fat_map.start = 0;
+}
+
+static void fat_map_free(void)
+{
+	fat_map_invalidate();
+	free(fat_map.ext);
+	fat_map.ext = NULL;
+	fat_map.size = 0;
+}
+
+/* Append cluster 'clust' to the map, merging it into the last run if we can */
+static int fat_map_add(__u32 clust)
+{
+	struct fat_extent *ext;
+
+	if (fat_map.count) {
+		ext = &fat_map.ext[fat_map.count - 1];
+		if (ext->clust + ext->count == clust) {
+			ext->count++;
+			fat_map.nclust++;
+			return 0;
+		}
+	}
+
+	if (fat_map.count == fat_map.size) {
+		int size = fat_map.size ? fat_map.size * 2 : 16;
+
+		ext = realloc(fat_map.ext, size * sizeof(*ext));
+		if (!ext)
+			return -ENOMEM;
+		fat_map.ext = ext;
+		fat_map.size = size;
+	}
+
+	ext = &fat_map.ext[fat_map.count++];
+	ext->index = fat_map.nclust++;
+	ext->clust = clust;
+	ext->count = 1;
+
+	return 0;
+}
+
+/*
+ * Look up cluster 'idx' of the file starting at cluster 'start', extending
+ * the map as needed. On success *clust is set to the cluster and *count, if
+ * not NULL, to the number of consecutive clusters from there on that belong
+ * to the file.
+ * Return 0 on success, -ENOENT if the chain is shorter, -EINVAL if it is
+ * corrupt and -ENOMEM if the map cannot grow.
+ */
+static int fat_map_get(fsdata *mydata, __u32 start, __u32 idx,
+		       __u32 *clust, __u32 *count)
+{
+	struct fat_extent *ext;
+	int lo, hi, mid, ret;
+	__u32 next;
+
+	if (fat_map.start != start) {
+		fat_map.start = 0;
+		fat_map.count = 0;
+		fat_map.nclust = 0;
+		fat_map.eoc = false;
+		fat_map.bad = false;
+		if (CHECK_CLUST(start, mydata->fatsize))
+			return -EINVAL;
+		ret = fat_map_add(start);
+		if (ret)
+			return ret;
+		fat_map.start = start;
+	}
+
+	while (idx >= fat_map.nclust) {
+		if (fat_map.bad)
+			return -EINVAL;
+		if (fat_map.eoc)
+			return -ENOENT;
+		ext = &fat_map.ext[fat_map.count - 1];
+		next = get_fatent(mydata, ext->clust + ext->count - 1);
+		if (IS_LAST_CLUST(next, mydata->fatsize)) {
+			fat_map.eoc = true;
+		} else if (CHECK_CLUST(next, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", next);
+			fat_map.bad = true;
+		} else {
+			ret = fat_map_add(next);
+			if (ret)
+				return ret;
+		}
+	}
+
+	/* Find the run holding idx */
+	lo = 0;
+	hi = fat_map.count - 1;
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (fat_map.ext[mid].index <= idx)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	ext = &fat_map.ext[lo];
+	*clust = ext->clust + idx - ext->index;
+	if (count)
+		*count = ext->count - (idx - ext->index);
+
+	return 0;
+}
+
 /*
  * Read at most 'size' bytes from the specified cluster into 'buffer'.
  * Return 0 on success, -1 otherwise.
@@ -311,9 +449,10 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	__u32 start = START(dentptr);
+	__u32 idx, curclust, count;
 	loff_t actsize;
+	u32 offset;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -328,28 +467,29 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
-
 	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize += bytesperclust;
-	}
+	idx = div_u64_rem(pos, bytesperclust, &offset);
+	filesize -= pos - offset;
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
+	/*
+	 * Map the whole range up front, so that runs come out as long as
+	 * possible. A chain shorter than the file is caught below. filesize
+	 * now counts from the start of cluster idx.
+	 */
+	if (fat_map_get(mydata, start,
+			div_u64(filesize - 1, bytesperclust) + idx,
+			&curclust, NULL) == -ENOMEM)
+		return -ENOMEM;
 
 	/* align to beginning of next cluster if any */
-	if (pos) {
+	if (offset) {
 		__u8 *tmp_buffer;
 
+		if (fat_map_get(mydata, start, idx, &curclust, NULL)) {
+			debug("Invalid FAT entry\n");
+			return 0;
+		}
+
 		actsize = min(filesize, (loff_t)bytesperclust);
 		tmp_buffer = malloc_cache_aligned(actsize);
 		if (!tmp_buffer) {
@@ -363,66 +503,33 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 			return -1;
 		}
 		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, tmp_buffer + pos, actsize);
+		actsize -= offset;
+		memcpy(buffer, tmp_buffer + offset, actsize);
 		free(tmp_buffer);
 		*gotsize += actsize;
-		if (!filesize)
-			return 0;
 		buffer += actsize;
-
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
-		}
+		idx++;
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				debug("Invalid FAT entry\n");
-				return 0;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
+	/* read whole runs of consecutive clusters */
+	while (filesize) {
+		if (fat_map_get(mydata, start, idx, &curclust, &count)) {
+			printf("Invalid FAT entry\n");
+			return 0;
 		}
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		actsize = min(filesize, (loff_t)count * bytesperclust);
+		if (get_cluster(mydata, curclust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
+		idx += count;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -1274,4 +1381,5 @@ void fat_closedir(struct fs_dir_stream *dirs)
 
 void fat_close(void)
 {
+	fat_map_free();
 }
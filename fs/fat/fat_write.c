@@ -266,6 +266,9 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 	__u32 bufnum, offset, off16;
 	__u16 val1, val2;
 
+	/* Chains are changing, so the extent map may be stale */
+	fat_map_invalidate();
+
 	switch (mydata->fatsize) {
 	case 32:
 		bufnum = entry / FAT32BUFSIZE;
@@ -726,6 +729,7 @@ set_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos, __u8 *buffer,
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
 	__u32 curclust = START(dentptr);
 	__u32 endclust = 0, newclust = 0;
+	__u32 skip;
 	u64 cur_pos, filesize;
 	loff_t offset, actsize, wsize;
 
@@ -755,6 +759,31 @@ set_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos, __u8 *buffer,
 
 	/* go to cluster at pos */
 	cur_pos = bytesperclust;
+
+	/*
+	 * Use the extent map to skip to the last cluster before pos that is
+	 * in the chain; the loop below does the rest.
+	 */
+	skip = pos > bytesperclust ? div_u64(pos - 1, bytesperclust) : 0;
+	if (skip) {
+		switch (fat_map_get(mydata, curclust, skip, &newclust, NULL)) {
+		case 0:
+			break;
+		case -ENOENT:
+			skip = fat_map.nclust - 1;
+			if (!fat_map_get(mydata, curclust, skip, &newclust,
+					 NULL))
+				break;
+			/* fall through */
+		default:
+			debug("curclust: 0x%x\n", curclust);
+			debug("Invalid FAT entry\n");
+			return -1;
+		}
+		cur_pos += (u64)skip * bytesperclust;
+		curclust = newclust;
+	}
+
 	while (1) {
 		if (pos <= cur_pos)
 			break;
@@ -15,6 +15,7 @@
 #include <sandboxfs.h>
 #include <ubifs_uboot.h>
 #include <btrfs.h>
+#include <squashfs.h>
 #include <asm/io.h>
 #include <div64.h>
 #include <linux/math64.h>
@@ -27,6 +28,22 @@ static int fs_dev_part;
 static disk_partition_t fs_partition;
 static int fs_type = FS_TYPE_ANY;
 
+/*
+ * The file system on a block device stays mounted after an operation, so
+ * that the next one on the same partition does not have to probe it again.
+ * It is dropped once the device is written or reinitialised, which changes
+ * its generation number, see blk_invalidate().
+ */
+static struct {
+	struct blk_desc *desc;	/* NULL if nothing is mounted */
+	unsigned int gen;	/* desc->gen when mounted */
+	int hwpart;
+	lbaint_t start;
+	lbaint_t size;
+	int part;
+	int fstype;
+} fs_mount;
+
 static inline int fs_probe_unsupported(struct blk_desc *fs_dev_desc,
 				      disk_partition_t *fs_partition)
 {
@@ -273,6 +290,27 @@ static struct fstype_info fstypes[] = {
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
 	},
+#endif
+#ifdef CONFIG_FS_SQUASHFS
+	{
+		.fstype = FS_TYPE_SQUASHFS,
+		.name = "squashfs",
+		.null_dev_desc_ok = false,
+		.probe = sqfs_probe,
+		.close = sqfs_close,
+		.ls = fs_ls_generic,
+		.exists = sqfs_exists,
+		.size = sqfs_size,
+		.read = sqfs_read,
+		.write = fs_write_unsupported,
+		.uuid = fs_uuid_unsupported,
+		.opendir = sqfs_opendir,
+		.readdir = sqfs_readdir,
+		.closedir = sqfs_closedir,
+		.unlink = fs_unlink_unsupported,
+		.mkdir = fs_mkdir_unsupported,
+		.ln = fs_ln_unsupported,
+	},
 #endif
 	{
 		.fstype = FS_TYPE_ANY,
@@ -320,6 +358,37 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
+/* Check whether the partition just looked up is mounted as @fstype */
+static bool fs_mount_valid(int part, int fstype)
+{
+	if (!fs_mount.desc || fs_mount.desc != fs_dev_desc)
+		return false;
+
+	if (fs_mount.gen != fs_dev_desc->gen ||
+	    fs_mount.hwpart != fs_dev_desc->hwpart ||
+	    fs_mount.part != part ||
+	    fs_mount.start != fs_partition.start ||
+	    fs_mount.size != fs_partition.size)
+		return false;
+
+	return fstype == FS_TYPE_ANY || fstype == fs_mount.fstype;
+}
+
+/* Keep the file system just probed mounted, if it is on a block device */
+static void fs_mount_set(void)
+{
+	if (!fs_dev_desc)
+		return;
+
+	fs_mount.desc = fs_dev_desc;
+	fs_mount.gen = fs_dev_desc->gen;
+	fs_mount.hwpart = fs_dev_desc->hwpart;
+	fs_mount.part = fs_dev_part;
+	fs_mount.start = fs_partition.start;
+	fs_mount.size = fs_partition.size;
+	fs_mount.fstype = fs_type;
+}
+
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 {
 	struct fstype_info *info;
@@ -346,6 +415,13 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	if (part < 0)
 		return -1;
 
+	if (fs_mount_valid(part, fstype)) {
+		fs_type = fs_mount.fstype;
+		fs_dev_part = part;
+		return 0;
+	}
+	fs_unmount();
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
 				fstype != info->fstype)
@@ -357,6 +433,7 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_mount_set();
 			return 0;
 		}
 	}
@@ -378,10 +455,18 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 		return ret;
 	fs_dev_desc = desc;
 
+	if (fs_mount_valid(part, FS_TYPE_ANY)) {
+		fs_type = fs_mount.fstype;
+		fs_dev_part = part;
+		return 0;
+	}
+	fs_unmount();
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_mount_set();
 			return 0;
 		}
 	}
@@ -389,10 +474,28 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 	return -1;
 }
 
+void fs_unmount(void)
+{
+	if (!fs_mount.desc)
+		return;
+
+	fs_get_info(fs_mount.fstype)->close();
+	fs_mount.desc = NULL;
+}
+
 static void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	if (fs_mount.desc && fs_mount.fstype == fs_type) {
+		/* Keep the file system mounted unless its device has changed */
+		if (fs_mount.gen == fs_mount.desc->gen) {
+			fs_type = FS_TYPE_ANY;
+			return;
+		}
+		fs_mount.desc = NULL;
+	}
+
 	info->close();
 
 	fs_type = FS_TYPE_ANY;
@@ -413,7 +516,6 @@ int fs_ls(const char *dirname)
 
 	ret = info->ls(dirname);
 
-	fs_type = FS_TYPE_ANY;
 	fs_close();
 
 	return ret;
@@ -597,7 +699,6 @@ int fs_unlink(const char *filename)
 
 	ret = info->unlink(filename);
 
-	fs_type = FS_TYPE_ANY;
 	fs_close();
 
 	return ret;
@@ -611,7 +712,6 @@ int fs_mkdir(const char *dirname)
 
 	ret = info->mkdir(dirname);
 
-	fs_type = FS_TYPE_ANY;
 	fs_close();
 
 	return ret;
@@ -0,0 +1,858 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Read-only SquashFS support
+ *
+ * Inodes and directories are kept in metadata blocks, and file contents in
+ * data blocks, each compressed on its own. The tails of small files are
+ * packed together into shared fragment blocks. Recently used blocks are
+ * kept decompressed in two small caches, one for metadata and one for data,
+ * so that walking a directory or reading the files sharing a fragment
+ * decompresses each block only once. Data blocks wanted in full are
+ * decompressed straight into the caller's buffer instead.
+ */
+
+#include <common.h>
+#include <fs.h>
+#include <fs_internal.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <squashfs.h>
+#include <linux/err.h>
+#include <linux/log2.h>
+
+#include "sqfs_decompressor.h"
+#include "sqfs_filesystem.h"
+
+/* Number of decompressed blocks kept around */
+#define SQFS_META_CACHE		8
+#define SQFS_DATA_CACHE		4
+/* Symbolic links followed while resolving one path */
+#define SQFS_MAX_LINKS		8
+/* Deepest directory a path can lead to */
+#define SQFS_MAX_DEPTH		64
+#define SQFS_MAX_LINK_SIZE	4096
+
+struct sqfs_cache_entry {
+	u64 pos;		/* position of the block on disk */
+	u64 next;		/* metadata: position of the next block */
+	u32 len;		/* decompressed length, 0 if unused */
+	unsigned int age;	/* value of the cache clock at last use */
+	u8 *data;
+};
+
+struct sqfs_cache {
+	struct sqfs_cache_entry *entries;
+	unsigned int count;
+	u32 size;		/* size of each buffer */
+	unsigned int clock;
+};
+
+/* The parts of an inode we need, whatever its type */
+struct sqfs_inode {
+	u16 type;
+	u64 size;		/* file, listing or link target length */
+	u64 start;		/* first data block, or listing block */
+	u32 offset;		/* offset of the listing in its block */
+	u32 fragment;
+	u32 frag_offset;
+	/* Metadata following the inode: block list or link target */
+	u64 next_block;
+	u32 next_offset;
+};
+
+struct sqfs_dir_stream {
+	struct fs_dir_stream fs_dirs;
+	struct fs_dirent dirent;
+	u64 block;		/* metadata block holding the next entry */
+	u32 offset;
+	u32 left;		/* bytes of the listing left */
+	u32 entries;		/* entries left under the current header */
+	struct sqfs_dir_header hdr;
+};
+
+/* Inodes from the root down to the directory being looked at */
+struct sqfs_path {
+	u64 refs[SQFS_MAX_DEPTH];
+	int depth;
+};
+
+struct sqfs_ctxt {
+	struct blk_desc *desc;
+	disk_partition_t part;
+	struct sqfs_super_block sb;
+	u32 block_size;
+	u64 *frag_index;	/* metadata blocks of the fragment table */
+	struct sqfs_cache meta;
+	struct sqfs_cache data;
+	u8 *comp_buf;		/* compressed block being read */
+};
+
+static struct sqfs_ctxt ctxt;
+
+static int sqfs_disk_read(u64 pos, u32 len, void *buf)
+{
+	lbaint_t sector = pos >> ctxt.desc->log2blksz;
+	int offset = pos & (ctxt.desc->blksz - 1);
+
+	if (!fs_devread(ctxt.desc, &ctxt.part, sector, offset, len, buf))
+		return -EIO;
+
+	return 0;
+}
+
+static int sqfs_cache_init(struct sqfs_cache *cache, unsigned int count,
+			   u32 size)
+{
+	cache->entries = calloc(count, sizeof(*cache->entries));
+	if (!cache->entries)
+		return -ENOMEM;
+	cache->count = count;
+	cache->size = size;
+	cache->clock = 0;
+
+	return 0;
+}
+
+static void sqfs_cache_free(struct sqfs_cache *cache)
+{
+	unsigned int i;
+
+	if (cache->entries) {
+		for (i = 0; i < cache->count; i++)
+			free(cache->entries[i].data);
+		free(cache->entries);
+	}
+	memset(cache, '\0', sizeof(*cache));
+}
+
+static struct sqfs_cache_entry *sqfs_cache_find(struct sqfs_cache *cache,
+						u64 pos)
+{
+	struct sqfs_cache_entry *entry;
+	unsigned int i;
+
+	for (i = 0; i < cache->count; i++) {
+		entry = &cache->entries[i];
+		if (entry->len && entry->pos == pos) {
+			entry->age = ++cache->clock;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/* Get an entry to fill, replacing the least recently used one */
+static struct sqfs_cache_entry *sqfs_cache_alloc(struct sqfs_cache *cache)
+{
+	struct sqfs_cache_entry *lru = cache->entries;
+	struct sqfs_cache_entry *entry;
+	unsigned int i;
+
+	for (i = 0; i < cache->count; i++) {
+		entry = &cache->entries[i];
+		if (!entry->len) {
+			lru = entry;
+			break;
+		}
+		if (cache->clock - entry->age > cache->clock - lru->age)
+			lru = entry;
+	}
+
+	lru->len = 0;
+	if (!lru->data) {
+		lru->data = malloc_cache_aligned(cache->size);
+		if (!lru->data)
+			return NULL;
+	}
+
+	return lru;
+}
+
+/*
+ * Read a block of @size bytes on disk at @pos, and decompress it unless
+ * @comp is false
+ */
+static int sqfs_load(void *dst, u32 *dstlen, u64 pos, u32 size, bool comp)
+{
+	int ret;
+
+	if (!comp) {
+		if (size > *dstlen)
+			return -EINVAL;
+		*dstlen = size;
+		return sqfs_disk_read(pos, size, dst);
+	}
+
+	if (size > max_t(u32, ctxt.block_size, SQFS_METADATA_SIZE))
+		return -EINVAL;
+	ret = sqfs_disk_read(pos, size, ctxt.comp_buf);
+	if (ret)
+		return ret;
+
+	return sqfs_decompress(dst, dstlen, ctxt.comp_buf, size);
+}
+
+/* Get the metadata block at @pos */
+static struct sqfs_cache_entry *sqfs_read_meta(u64 pos)
+{
+	struct sqfs_cache_entry *entry;
+	__le16 hdr;
+	u32 size, len;
+	int ret;
+
+	entry = sqfs_cache_find(&ctxt.meta, pos);
+	if (entry)
+		return entry;
+
+	ret = sqfs_disk_read(pos, sizeof(hdr), &hdr);
+	if (ret)
+		return ERR_PTR(ret);
+	size = SQFS_METADATA_LEN(le16_to_cpu(hdr));
+	if (!size || size > SQFS_METADATA_SIZE)
+		return ERR_PTR(-EINVAL);
+
+	entry = sqfs_cache_alloc(&ctxt.meta);
+	if (!entry)
+		return ERR_PTR(-ENOMEM);
+	len = ctxt.meta.size;
+	ret = sqfs_load(entry->data, &len, pos + sizeof(hdr), size,
+			!(le16_to_cpu(hdr) & SQFS_METADATA_UNCOMP));
+	if (ret)
+		return ERR_PTR(ret);
+	if (!len)
+		return ERR_PTR(-EINVAL);
+
+	entry->pos = pos;
+	entry->next = pos + sizeof(hdr) + size;
+	entry->len = len;
+	entry->age = ++ctxt.meta.clock;
+
+	return entry;
+}
+
+/* Get the data block or fragment block at @pos, of on-disk @size */
+static struct sqfs_cache_entry *sqfs_read_data(u64 pos, u32 size)
+{
+	struct sqfs_cache_entry *entry;
+	u32 len;
+	int ret;
+
+	entry = sqfs_cache_find(&ctxt.data, pos);
+	if (entry)
+		return entry;
+
+	entry = sqfs_cache_alloc(&ctxt.data);
+	if (!entry)
+		return ERR_PTR(-ENOMEM);
+	len = ctxt.data.size;
+	ret = sqfs_load(entry->data, &len, pos, SQFS_BLOCK_LEN(size),
+			!(size & SQFS_BLOCK_UNCOMP));
+	if (ret)
+		return ERR_PTR(ret);
+	if (!len)
+		return ERR_PTR(-EINVAL);
+
+	entry->pos = pos;
+	entry->len = len;
+	entry->age = ++ctxt.data.clock;
+
+	return entry;
+}
+
+/*
+ * Read @len bytes of metadata from @offset within the block at @block,
+ * moving both past what was read
+ */
+static int sqfs_read_metadata(u64 *block, u32 *offset, void *buf, u32 len)
+{
+	struct sqfs_cache_entry *entry;
+	u8 *dst = buf;
+	u32 n;
+
+	while (len) {
+		entry = sqfs_read_meta(*block);
+		if (IS_ERR(entry))
+			return PTR_ERR(entry);
+		if (*offset >= entry->len) {
+			*offset -= entry->len;
+			*block = entry->next;
+			continue;
+		}
+		n = min(len, entry->len - *offset);
+		memcpy(dst, entry->data + *offset, n);
+		dst += n;
+		len -= n;
+		*offset += n;
+	}
+
+	return 0;
+}
+
+static bool sqfs_is_dir(u16 type)
+{
+	return type == SQFS_DIR_TYPE || type == SQFS_LDIR_TYPE;
+}
+
+static bool sqfs_is_reg(u16 type)
+{
+	return type == SQFS_REG_TYPE || type == SQFS_LREG_TYPE;
+}
+
+static bool sqfs_is_symlink(u16 type)
+{
+	return type == SQFS_SYMLINK_TYPE || type == SQFS_LSYMLINK_TYPE;
+}
+
+static int sqfs_read_inode(u64 ref, struct sqfs_inode *inode)
+{
+	union {
+		struct sqfs_base_inode base;
+		struct sqfs_dir_inode dir;
+		struct sqfs_ldir_inode ldir;
+		struct sqfs_reg_inode reg;
+		struct sqfs_lreg_inode lreg;
+		struct sqfs_symlink_inode symlink;
+	} i;
+	u64 block = le64_to_cpu(ctxt.sb.inode_table_start) +
+		    SQFS_INODE_BLOCK(ref);
+	u32 offset = SQFS_INODE_OFFSET(ref);
+	u8 *rest = (u8 *)&i + sizeof(i.base);
+	u32 size = 0;
+	int ret;
+
+	ret = sqfs_read_metadata(&block, &offset, &i.base, sizeof(i.base));
+	if (ret)
+		return ret;
+
+	memset(inode, '\0', sizeof(*inode));
+	inode->type = le16_to_cpu(i.base.inode_type);
+	inode->fragment = SQFS_INVALID_FRAG;
+	switch (inode->type) {
+	case SQFS_DIR_TYPE:
+		size = sizeof(i.dir);
+		break;
+	case SQFS_LDIR_TYPE:
+		size = sizeof(i.ldir);
+		break;
+	case SQFS_REG_TYPE:
+		size = sizeof(i.reg);
+		break;
+	case SQFS_LREG_TYPE:
+		size = sizeof(i.lreg);
+		break;
+	case SQFS_SYMLINK_TYPE:
+	case SQFS_LSYMLINK_TYPE:
+		size = sizeof(i.symlink);
+		break;
+	}
+	if (size) {
+		ret = sqfs_read_metadata(&block, &offset, rest,
+					 size - sizeof(i.base));
+		if (ret)
+			return ret;
+	}
+
+	switch (inode->type) {
+	case SQFS_DIR_TYPE:
+		inode->start = le32_to_cpu(i.dir.start_block);
+		inode->offset = le16_to_cpu(i.dir.offset);
+		size = le16_to_cpu(i.dir.file_size);
+		/* The size counts three bytes for "." and ".." */
+		inode->size = size > 3 ? size - 3 : 0;
+		break;
+	case SQFS_LDIR_TYPE:
+		inode->start = le32_to_cpu(i.ldir.start_block);
+		inode->offset = le16_to_cpu(i.ldir.offset);
+		size = le32_to_cpu(i.ldir.file_size);
+		inode->size = size > 3 ? size - 3 : 0;
+		break;
+	case SQFS_REG_TYPE:
+		inode->start = le32_to_cpu(i.reg.start_block);
+		inode->fragment = le32_to_cpu(i.reg.fragment);
+		inode->frag_offset = le32_to_cpu(i.reg.offset);
+		inode->size = le32_to_cpu(i.reg.file_size);
+		break;
+	case SQFS_LREG_TYPE:
+		inode->start = le64_to_cpu(i.lreg.start_block);
+		inode->fragment = le32_to_cpu(i.lreg.fragment);
+		inode->frag_offset = le32_to_cpu(i.lreg.offset);
+		inode->size = le64_to_cpu(i.lreg.file_size);
+		break;
+	case SQFS_SYMLINK_TYPE:
+	case SQFS_LSYMLINK_TYPE:
+		inode->size = le32_to_cpu(i.symlink.symlink_size);
+		break;
+	}
+	inode->next_block = block;
+	inode->next_offset = offset;
+
+	return 0;
+}
+
+static int sqfs_dir_open(const struct sqfs_inode *inode,
+			 struct sqfs_dir_stream *dir)
+{
+	if (!sqfs_is_dir(inode->type))
+		return -ENOTDIR;
+
+	dir->block = le64_to_cpu(ctxt.sb.directory_table_start) + inode->start;
+	dir->offset = inode->offset;
+	dir->left = inode->size;
+	dir->entries = 0;
+
+	return 0;
+}
+
+/*
+ * Read the next directory entry, leaving its name in @dir->dirent
+ *
+ * @return 0 if OK, -ENOENT at the end of the directory, other -ve value on
+ * error
+ */
+static int sqfs_dir_next(struct sqfs_dir_stream *dir, u64 *refp, u16 *typep)
+{
+	struct sqfs_dir_entry entry;
+	u32 name_size;
+	int ret;
+
+	if (!dir->left)
+		return -ENOENT;
+
+	if (!dir->entries) {
+		if (dir->left < sizeof(dir->hdr))
+			return -EINVAL;
+		ret = sqfs_read_metadata(&dir->block, &dir->offset, &dir->hdr,
+					 sizeof(dir->hdr));
+		if (ret)
+			return ret;
+		dir->left -= sizeof(dir->hdr);
+		dir->entries = le32_to_cpu(dir->hdr.count) + 1;
+	}
+
+	if (dir->left < sizeof(entry))
+		return -EINVAL;
+	ret = sqfs_read_metadata(&dir->block, &dir->offset, &entry,
+				 sizeof(entry));
+	if (ret)
+		return ret;
+	dir->left -= sizeof(entry);
+
+	name_size = le16_to_cpu(entry.name_size) + 1;
+	if (name_size >= sizeof(dir->dirent.name))
+		return -ENAMETOOLONG;
+	if (dir->left < name_size)
+		return -EINVAL;
+	ret = sqfs_read_metadata(&dir->block, &dir->offset, dir->dirent.name,
+				 name_size);
+	if (ret)
+		return ret;
+	dir->dirent.name[name_size] = '\0';
+	dir->left -= name_size;
+	dir->entries--;
+
+	*refp = ((u64)le32_to_cpu(dir->hdr.start) << 16) |
+		le16_to_cpu(entry.offset);
+	*typep = le16_to_cpu(entry.type);
+
+	return 0;
+}
+
+/* Look up the entry @name, of @len bytes, in directory @inode */
+static int sqfs_dir_lookup(const struct sqfs_inode *inode, const char *name,
+			   size_t len, u64 *refp)
+{
+	struct sqfs_dir_stream dir;
+	u16 type;
+	int ret, cmp;
+
+	ret = sqfs_dir_open(inode, &dir);
+	if (ret)
+		return ret;
+
+	for (;;) {
+		ret = sqfs_dir_next(&dir, refp, &type);
+		if (ret)
+			return ret;
+		cmp = strncmp(dir.dirent.name, name, len);
+		if (!cmp && !dir.dirent.name[len])
+			return 0;
+		/* Entries are sorted, so we are past the name */
+		if (cmp > 0)
+			return -ENOENT;
+	}
+}
+
+static int sqfs_read_link(const struct sqfs_inode *inode, char **targetp)
+{
+	u64 block = inode->next_block;
+	u32 offset = inode->next_offset;
+	char *target;
+	int ret;
+
+	if (inode->size >= SQFS_MAX_LINK_SIZE)
+		return -ENAMETOOLONG;
+	target = malloc(inode->size + 1);
+	if (!target)
+		return -ENOMEM;
+	ret = sqfs_read_metadata(&block, &offset, target, inode->size);
+	if (ret) {
+		free(target);
+		return ret;
+	}
+	target[inode->size] = '\0';
+	*targetp = target;
+
+	return 0;
+}
+
+/* Follow @name from the directory at the end of @path, @links deep */
+static int sqfs_walk(struct sqfs_path *path, const char *name, int links)
+{
+	struct sqfs_inode inode;
+	const char *end;
+	char *target;
+	size_t len;
+	u64 ref;
+	int ret;
+
+	if (*name == '/')
+		path->depth = 0;
+
+	for (; *name; name = end) {
+		while (*name == '/')
+			name++;
+		end = strchrnul(name, '/');
+		len = end - name;
+		if (!len || (len == 1 && name[0] == '.'))
+			continue;
+		if (len == 2 && name[0] == '.' && name[1] == '.') {
+			if (path->depth)
+				path->depth--;
+			continue;
+		}
+
+		ret = sqfs_read_inode(path->refs[path->depth], &inode);
+		if (ret)
+			return ret;
+		ret = sqfs_dir_lookup(&inode, name, len, &ref);
+		if (ret)
+			return ret;
+		ret = sqfs_read_inode(ref, &inode);
+		if (ret)
+			return ret;
+
+		if (sqfs_is_symlink(inode.type)) {
+			if (links >= SQFS_MAX_LINKS)
+				return -ELOOP;
+			ret = sqfs_read_link(&inode, &target);
+			if (ret)
+				return ret;
+			ret = sqfs_walk(path, target, links + 1);
+			free(target);
+			if (ret)
+				return ret;
+		} else {
+			if (path->depth + 1 >= SQFS_MAX_DEPTH)
+				return -ENAMETOOLONG;
+			path->refs[++path->depth] = ref;
+		}
+	}
+
+	return 0;
+}
+
+static int sqfs_resolve(const char *filename, struct sqfs_inode *inode)
+{
+	struct sqfs_path path;
+	int ret;
+
+	path.refs[0] = le64_to_cpu(ctxt.sb.root_inode);
+	path.depth = 0;
+	ret = sqfs_walk(&path, filename, 0);
+	if (ret)
+		return ret;
+
+	return sqfs_read_inode(path.refs[path.depth], inode);
+}
+
+static int sqfs_read_fragment(u32 index, struct sqfs_fragment_entry *frag)
+{
+	u64 block;
+	u32 offset;
+
+	if (index >= le32_to_cpu(ctxt.sb.fragments))
+		return -EINVAL;
+	block = le64_to_cpu(ctxt.frag_index[index / SQFS_FRAGS_PER_BLOCK]);
+	offset = (index % SQFS_FRAGS_PER_BLOCK) * sizeof(*frag);
+
+	return sqfs_read_metadata(&block, &offset, frag, sizeof(*frag));
+}
+
+int sqfs_probe(struct blk_desc *fs_dev_desc, disk_partition_t *fs_partition)
+{
+	struct sqfs_super_block *sb = &ctxt.sb;
+	u32 nfrag, nindex;
+	int ret;
+
+	ctxt.desc = fs_dev_desc;
+	ctxt.part = *fs_partition;
+
+	ret = sqfs_disk_read(0, sizeof(*sb), sb);
+	if (ret)
+		goto err;
+	if (le32_to_cpu(sb->s_magic) != SQFS_MAGIC) {
+		ret = -EINVAL;
+		goto err;
+	}
+	if (le16_to_cpu(sb->s_major) != SQFS_MAJOR) {
+		printf("SquashFS: version %u.%u not supported\n",
+		       le16_to_cpu(sb->s_major), le16_to_cpu(sb->s_minor));
+		ret = -EINVAL;
+		goto err;
+	}
+	ctxt.block_size = le32_to_cpu(sb->block_size);
+	if (!is_power_of_2(ctxt.block_size) ||
+	    ctxt.block_size > SQFS_MAX_BLOCK_SIZE ||
+	    ilog2(ctxt.block_size) != le16_to_cpu(sb->block_log)) {
+		printf("SquashFS: bad block size %u\n", ctxt.block_size);
+		ret = -EINVAL;
+		goto err;
+	}
+
+	ret = sqfs_decompressor_init(le16_to_cpu(sb->compression));
+	if (ret)
+		goto err;
+
+	nfrag = le32_to_cpu(sb->fragments);
+	if (nfrag) {
+		nindex = DIV_ROUND_UP(nfrag, SQFS_FRAGS_PER_BLOCK);
+		ctxt.frag_index = malloc(nindex * sizeof(u64));
+		if (!ctxt.frag_index) {
+			ret = -ENOMEM;
+			goto err;
+		}
+		ret = sqfs_disk_read(le64_to_cpu(sb->fragment_table_start),
+				     nindex * sizeof(u64), ctxt.frag_index);
+		if (ret)
+			goto err;
+	}
+
+	ctxt.comp_buf = malloc_cache_aligned(max_t(u32, ctxt.block_size,
+						   SQFS_METADATA_SIZE));
+	if (!ctxt.comp_buf) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	ret = sqfs_cache_init(&ctxt.meta, SQFS_META_CACHE, SQFS_METADATA_SIZE);
+	if (ret)
+		goto err;
+	ret = sqfs_cache_init(&ctxt.data, SQFS_DATA_CACHE, ctxt.block_size);
+	if (ret)
+		goto err;
+
+	return 0;
+
+err:
+	sqfs_close();
+	return ret;
+}
+
+int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
+{
+	struct sqfs_dir_stream *dir;
+	struct sqfs_inode inode;
+	int ret;
+
+	dir = calloc(1, sizeof(*dir));
+	if (!dir)
+		return -ENOMEM;
+
+	ret = sqfs_resolve(filename, &inode);
+	if (!ret)
+		ret = sqfs_dir_open(&inode, dir);
+	if (ret) {
+		free(dir);
+		return ret;
+	}
+	*dirsp = &dir->fs_dirs;
+
+	return 0;
+}
+
+int sqfs_readdir(struct fs_dir_stream *dirs, struct fs_dirent **dentp)
+{
+	struct sqfs_dir_stream *dir = (struct sqfs_dir_stream *)dirs;
+	struct sqfs_inode inode;
+	u64 ref;
+	u16 type;
+	int ret;
+
+	ret = sqfs_dir_next(dir, &ref, &type);
+	if (ret)
+		return ret;
+
+	dir->dirent.size = 0;
+	if (sqfs_is_dir(type)) {
+		dir->dirent.type = FS_DT_DIR;
+	} else if (sqfs_is_symlink(type)) {
+		dir->dirent.type = FS_DT_LNK;
+	} else {
+		dir->dirent.type = FS_DT_REG;
+		if (sqfs_is_reg(type)) {
+			ret = sqfs_read_inode(ref, &inode);
+			if (ret)
+				return ret;
+			dir->dirent.size = inode.size;
+		}
+	}
+	*dentp = &dir->dirent;
+
+	return 0;
+}
+
+void sqfs_closedir(struct fs_dir_stream *dirs)
+{
+	free(dirs);
+}
+
+int sqfs_exists(const char *filename)
+{
+	struct sqfs_inode inode;
+
+	return !sqfs_resolve(filename, &inode);
+}
+
+int sqfs_size(const char *filename, loff_t *size)
+{
+	struct sqfs_inode inode;
+	int ret;
+
+	ret = sqfs_resolve(filename, &inode);
+	if (ret)
+		return ret;
+	*size = inode.size;
+
+	return 0;
+}
+
+/* Copy @len bytes from @offset within the file's tail in its fragment */
+static int sqfs_read_tail(const struct sqfs_inode *inode, u8 *buf,
+			  u32 offset, u32 len)
+{
+	struct sqfs_fragment_entry frag;
+	struct sqfs_cache_entry *entry;
+	int ret;
+
+	ret = sqfs_read_fragment(inode->fragment, &frag);
+	if (ret)
+		return ret;
+	entry = sqfs_read_data(le64_to_cpu(frag.start),
+			       le32_to_cpu(frag.size));
+	if (IS_ERR(entry))
+		return PTR_ERR(entry);
+	/* The offsets come from the image, so they must not wrap around */
+	if ((u64)inode->frag_offset + offset + len > entry->len)
+		return -EINVAL;
+	memcpy(buf, entry->data + inode->frag_offset + offset, len);
+
+	return 0;
+}
+
+int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
+	      loff_t *actread)
+{
+	u32 bs = ctxt.block_size;
+	struct sqfs_cache_entry *entry;
+	struct sqfs_inode inode;
+	u64 nblocks, i, pos, cur, block_end;
+	u32 lo, skip, n, size, dlen;
+	u8 *dst = buf;
+	loff_t done = 0;
+	u64 lb;
+	int ret;
+
+	*actread = 0;
+	ret = sqfs_resolve(filename, &inode);
+	if (ret)
+		return ret;
+	if (sqfs_is_dir(inode.type))
+		return -EISDIR;
+	if (!sqfs_is_reg(inode.type) || offset > inode.size)
+		return -EINVAL;
+	if (!len || len > inode.size - offset)
+		len = inode.size - offset;
+
+	if (inode.fragment == SQFS_INVALID_FRAG)
+		nblocks = DIV_ROUND_UP(inode.size, bs);
+	else
+		nblocks = inode.size / bs;
+
+	/* Walk the block list to find where each block is on disk */
+	lb = inode.next_block;
+	lo = inode.next_offset;
+	pos = inode.start;
+	for (i = 0; i < nblocks && done < len; i++) {
+		__le32 le_size;
+
+		ret = sqfs_read_metadata(&lb, &lo, &le_size, sizeof(le_size));
+		if (ret)
+			return ret;
+		size = le32_to_cpu(le_size);
+
+		block_end = min(inode.size, (i + 1) * bs);
+		cur = offset + done;
+		if (cur >= block_end) {
+			pos += SQFS_BLOCK_LEN(size);
+			continue;
+		}
+		skip = cur - i * bs;
+		n = min_t(u64, block_end - cur, len - done);
+
+		if (!SQFS_BLOCK_LEN(size)) {
+			/* Sparse block */
+			memset(dst + done, '\0', n);
+		} else if (!skip && n == block_end - i * bs) {
+			dlen = n;
+			ret = sqfs_load(dst + done, &dlen, pos,
+					SQFS_BLOCK_LEN(size),
+					!(size & SQFS_BLOCK_UNCOMP));
+			if (ret)
+				return ret;
+			if (dlen != n)
+				return -EINVAL;
+		} else {
+			entry = sqfs_read_data(pos, size);
+			if (IS_ERR(entry))
+				return PTR_ERR(entry);
+			if (skip + n > entry->len)
+				return -EINVAL;
+			memcpy(dst + done, entry->data + skip, n);
+		}
+		done += n;
+		pos += SQFS_BLOCK_LEN(size);
+	}
+
+	if (done < len) {
+		if (inode.fragment == SQFS_INVALID_FRAG)
+			return -EINVAL;
+		ret = sqfs_read_tail(&inode, dst + done,
+				     offset + done - nblocks * bs, len - done);
+		if (ret)
+			return ret;
+		done = len;
+	}
+	*actread = done;
+
+	return 0;
+}
+
+void sqfs_close(void)
+{
+	sqfs_cache_free(&ctxt.meta);
+	sqfs_cache_free(&ctxt.data);
+	free(ctxt.comp_buf);
+	free(ctxt.frag_index);
+	sqfs_decompressor_cleanup();
+	memset(&ctxt, '\0', sizeof(ctxt));
+}
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SquashFS block decompression
+ *
+ * Each metadata and data block is compressed on its own, so a whole block
+ * is always decompressed in one go.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/lzo.h>
+#include <linux/zstd.h>
+#include <u-boot/zlib.h>
+
+#include "sqfs_decompressor.h"
+#include "sqfs_filesystem.h"
+
+static u16 sqfs_comp;
+#if IS_ENABLED(CONFIG_ZSTD)
+static ZSTD_DCtx *sqfs_zstd_dctx;
+static void *sqfs_zstd_workspace;
+#endif
+
+int sqfs_decompressor_init(u16 comp)
+{
+	switch (comp) {
+#if IS_ENABLED(CONFIG_ZLIB)
+	case SQFS_COMP_ZLIB:
+		break;
+#endif
+#if IS_ENABLED(CONFIG_LZO)
+	case SQFS_COMP_LZO:
+		break;
+#endif
+#if IS_ENABLED(CONFIG_LZ4)
+	case SQFS_COMP_LZ4:
+		break;
+#endif
+#if IS_ENABLED(CONFIG_ZSTD)
+	case SQFS_COMP_ZSTD: {
+		size_t wsize = ZSTD_DCtxWorkspaceBound();
+
+		sqfs_zstd_workspace = malloc(wsize);
+		if (!sqfs_zstd_workspace)
+			return -ENOMEM;
+		sqfs_zstd_dctx = ZSTD_initDCtx(sqfs_zstd_workspace, wsize);
+		if (!sqfs_zstd_dctx) {
+			free(sqfs_zstd_workspace);
+			sqfs_zstd_workspace = NULL;
+			return -ENOMEM;
+		}
+		break;
+	}
+#endif
+	default:
+		printf("SquashFS: compression type %u not supported\n", comp);
+		return -EPROTONOSUPPORT;
+	}
+	sqfs_comp = comp;
+
+	return 0;
+}
+
+void sqfs_decompressor_cleanup(void)
+{
+#if IS_ENABLED(CONFIG_ZSTD)
+	free(sqfs_zstd_workspace);
+	sqfs_zstd_workspace = NULL;
+	sqfs_zstd_dctx = NULL;
+#endif
+	sqfs_comp = 0;
+}
+
+#if IS_ENABLED(CONFIG_ZLIB)
+static int sqfs_zlib_decompress(void *dst, u32 *dstlen, const void *src,
+				u32 srclen)
+{
+	z_stream stream;
+	int ret;
+
+	memset(&stream, '\0', sizeof(stream));
+	stream.next_in = (void *)src;
+	stream.avail_in = srclen;
+	stream.next_out = dst;
+	stream.avail_out = *dstlen;
+
+	if (inflateInit(&stream) != Z_OK)
+		return -ENOMEM;
+	ret = inflate(&stream, Z_FINISH);
+	*dstlen = stream.total_out;
+	inflateEnd(&stream);
+
+	if (ret != Z_STREAM_END) {
+		debug("%s: inflate() returned %d\n", __func__, ret);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+#endif
+
+int sqfs_decompress(void *dst, u32 *dstlen, const void *src, u32 srclen)
+{
+	size_t len = *dstlen;
+	int __maybe_unused ret;
+
+	switch (sqfs_comp) {
+#if IS_ENABLED(CONFIG_ZLIB)
+	case SQFS_COMP_ZLIB:
+		return sqfs_zlib_decompress(dst, dstlen, src, srclen);
+#endif
+#if IS_ENABLED(CONFIG_LZO)
+	case SQFS_COMP_LZO:
+		ret = lzo1x_decompress_safe(src, srclen, dst, &len);
+		if (ret != LZO_E_OK) {
+			debug("%s: LZO error %d\n", __func__, ret);
+			return -EINVAL;
+		}
+		break;
+#endif
+#if IS_ENABLED(CONFIG_LZ4)
+	case SQFS_COMP_LZ4:
+		ret = ulz4_block(src, srclen, dst, &len);
+		if (ret)
+			return ret;
+		break;
+#endif
+#if IS_ENABLED(CONFIG_ZSTD)
+	case SQFS_COMP_ZSTD:
+		len = ZSTD_decompressDCtx(sqfs_zstd_dctx, dst, len, src,
+					  srclen);
+		if (ZSTD_isError(len)) {
+			debug("%s: zstd error %d\n", __func__,
+			      ZSTD_getErrorCode(len));
+			return -EINVAL;
+		}
+		break;
+#endif
+	default:
+		return -EPROTONOSUPPORT;
+	}
+	*dstlen = len;
+
+	return 0;
+}
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SquashFS block decompression
+ */
+
+#ifndef __SQFS_DECOMPRESSOR_H__
+#define __SQFS_DECOMPRESSOR_H__
+
+#include <linux/types.h>
+
+/**
+ * sqfs_decompressor_init() - Set up decompression for a filesystem
+ *
+ * @comp:	Compression type from the superblock (enum sqfs_compression)
+ * @return 0 if OK, -EPROTONOSUPPORT if the algorithm is not built in,
+ * -ENOMEM if out of memory
+ */
+int sqfs_decompressor_init(u16 comp);
+
+/**
+ * sqfs_decompressor_cleanup() - Free what sqfs_decompressor_init() set up
+ */
+void sqfs_decompressor_cleanup(void);
+
+/**
+ * sqfs_decompress() - Decompress one metadata or data block
+ *
+ * @dst:	Destination buffer
+ * @dstlen:	On entry, size of @dst. On exit, number of bytes produced
+ * @src:	Compressed block
+ * @srclen:	Size of the compressed block
+ * @return 0 if OK, -ve on error
+ */
+int sqfs_decompress(void *dst, u32 *dstlen, const void *src, u32 srclen);
+
+#endif /* __SQFS_DECOMPRESSOR_H__ */
@@ -0,0 +1,168 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * SquashFS 4.0 on-disk format
+ *
+ * Everything is stored little-endian. Inodes and directories live in
+ * metadata blocks of up to 8 KiB, each preceded by a 16-bit header giving
+ * its size on disk.
+ */
+
+#ifndef __SQFS_FILESYSTEM_H__
+#define __SQFS_FILESYSTEM_H__
+
+#include <linux/bitops.h>
+#include <linux/sizes.h>
+#include <linux/types.h>
+
+#define SQFS_MAGIC		0x73717368
+#define SQFS_MAJOR		4
+
+#define SQFS_METADATA_SIZE	8192
+/* Metadata block header: bit 15 set if the data is stored uncompressed */
+#define SQFS_METADATA_UNCOMP	BIT(15)
+#define SQFS_METADATA_LEN(h)	((h) & ~SQFS_METADATA_UNCOMP)
+
+/* Data block or fragment size: bit 24 set if stored uncompressed */
+#define SQFS_BLOCK_UNCOMP	BIT(24)
+#define SQFS_BLOCK_LEN(s)	((s) & ~SQFS_BLOCK_UNCOMP)
+#define SQFS_MAX_BLOCK_SIZE	SZ_1M
+
+#define SQFS_INVALID_FRAG	0xffffffff
+#define SQFS_FRAGS_PER_BLOCK	(SQFS_METADATA_SIZE / \
+				 sizeof(struct sqfs_fragment_entry))
+
+/* Superblock flags */
+#define SQFS_COMP_OPT		BIT(10)
+
+/* Inode references: metadata block (from the table start) and offset */
+#define SQFS_INODE_BLOCK(ref)	((ref) >> 16)
+#define SQFS_INODE_OFFSET(ref)	((ref) & 0xffff)
+
+enum sqfs_compression {
+	SQFS_COMP_ZLIB = 1,
+	SQFS_COMP_LZMA,
+	SQFS_COMP_LZO,
+	SQFS_COMP_XZ,
+	SQFS_COMP_LZ4,
+	SQFS_COMP_ZSTD,
+};
+
+enum sqfs_inode_type {
+	SQFS_DIR_TYPE = 1,
+	SQFS_REG_TYPE,
+	SQFS_SYMLINK_TYPE,
+	SQFS_BLKDEV_TYPE,
+	SQFS_CHRDEV_TYPE,
+	SQFS_FIFO_TYPE,
+	SQFS_SOCKET_TYPE,
+	SQFS_LDIR_TYPE,
+	SQFS_LREG_TYPE,
+	SQFS_LSYMLINK_TYPE,
+	SQFS_LBLKDEV_TYPE,
+	SQFS_LCHRDEV_TYPE,
+	SQFS_LFIFO_TYPE,
+	SQFS_LSOCKET_TYPE,
+};
+
+struct sqfs_super_block {
+	__le32 s_magic;
+	__le32 inodes;
+	__le32 mkfs_time;
+	__le32 block_size;
+	__le32 fragments;
+	__le16 compression;
+	__le16 block_log;
+	__le16 flags;
+	__le16 no_ids;
+	__le16 s_major;
+	__le16 s_minor;
+	__le64 root_inode;
+	__le64 bytes_used;
+	__le64 id_table_start;
+	__le64 xattr_id_table_start;
+	__le64 inode_table_start;
+	__le64 directory_table_start;
+	__le64 fragment_table_start;
+	__le64 lookup_table_start;
+} __packed;
+
+struct sqfs_base_inode {
+	__le16 inode_type;
+	__le16 mode;
+	__le16 uid;
+	__le16 guid;
+	__le32 mtime;
+	__le32 inode_number;
+} __packed;
+
+struct sqfs_dir_inode {
+	struct sqfs_base_inode base;
+	__le32 start_block;
+	__le32 nlink;
+	__le16 file_size;
+	__le16 offset;
+	__le32 parent_inode;
+} __packed;
+
+struct sqfs_ldir_inode {
+	struct sqfs_base_inode base;
+	__le32 nlink;
+	__le32 file_size;
+	__le32 start_block;
+	__le32 parent_inode;
+	__le16 i_count;
+	__le16 offset;
+	__le32 xattr;
+	/* + i_count directory index entries */
+} __packed;
+
+struct sqfs_reg_inode {
+	struct sqfs_base_inode base;
+	__le32 start_block;
+	__le32 fragment;
+	__le32 offset;
+	__le32 file_size;
+	/* + one __le32 size per data block */
+} __packed;
+
+struct sqfs_lreg_inode {
+	struct sqfs_base_inode base;
+	__le64 start_block;
+	__le64 file_size;
+	__le64 sparse;
+	__le32 nlink;
+	__le32 fragment;
+	__le32 offset;
+	__le32 xattr;
+	/* + one __le32 size per data block */
+} __packed;
+
+struct sqfs_symlink_inode {
+	struct sqfs_base_inode base;
+	__le32 nlink;
+	__le32 symlink_size;
+	/* + symlink_size bytes of target, not terminated */
+} __packed;
+
+/* Directory listings: runs of entries sharing one inode metadata block */
+struct sqfs_dir_header {
+	__le32 count;		/* number of entries - 1 */
+	__le32 start;		/* metadata block of the inodes */
+	__le32 inode_number;
+} __packed;
+
+struct sqfs_dir_entry {
+	__le16 offset;		/* offset of the inode in its block */
+	__le16 inode_offset;	/* signed, from the header's inode_number */
+	__le16 type;
+	__le16 name_size;	/* length of the name - 1 */
+	/* + name, not terminated */
+} __packed;
+
+struct sqfs_fragment_entry {
+	__le64 start;
+	__le32 size;
+	__le32 unused;
+} __packed;
+
+#endif /* __SQFS_FILESYSTEM_H__ */
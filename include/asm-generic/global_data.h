@@ -67,6 +67,7 @@ typedef struct global_data {
 	struct udevice	*dm_root;	/* Root instance for Driver Model */
 	struct udevice	*dm_root_f;	/* Pre-relocation root instance */
 	struct list_head uclass_root;	/* Head of core tree */
+	struct lists_index *dm_index;	/* Driver lookup index, or NULL */
 #endif
 #ifdef CONFIG_TIMER
 	struct udevice	*timer;		/* Timer instance for Driver Model */
@@ -77,6 +78,8 @@ typedef struct global_data {
 	unsigned long fdt_size;		/* Space reserved for relocated FDT */
 #ifdef CONFIG_OF_LIVE
 	struct device_node *of_root;
+	void *new_of_live;	/* Live tree built before relocation */
+	unsigned long of_live_size;	/* Space reserved for new_of_live */
 #endif
 
 #if CONFIG_IS_ENABLED(MULTI_DTB_FIT)
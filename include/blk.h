@@ -77,6 +77,7 @@ struct blk_desc {
 	lbaint_t	lba;		/* number of blocks */
 	unsigned long	blksz;		/* block size */
 	int		log2blksz;	/* for convenience: log2(blksz) */
+	unsigned int	gen;		/* changed with the device contents */
 	char		vendor[BLK_VEN_SIZE + 1]; /* device vendor string */
 	char		product[BLK_PRD_SIZE + 1]; /* device product number */
 	char		revision[BLK_REV_SIZE + 1]; /* firmware revision */
@@ -92,6 +93,9 @@ struct blk_desc {
 	 * device. Once these functions are removed we can drop this field.
 	 */
 	struct udevice *bdev;
+	/* Reads queued by blk_dread_submit(), the first one maybe started */
+	struct blk_req *reqs;
+	bool req_started;
 #else
 	unsigned long	(*block_read)(struct blk_desc *block_dev,
 				      lbaint_t start,
@@ -129,6 +133,27 @@ int blkcache_read(int iftype, int dev,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer);
 
+/**
+ * blkcache_readahead() - decide whether to read ahead after a cache miss
+ *
+ * If a read which missed the cache continues the previous one on the same
+ * device, more blocks than requested should be read in one go and passed to
+ * blkcache_fill(), so that the following sequential reads hit the cache.
+ *
+ * @param iftype - IF_TYPE_x for type of device
+ * @param dev - device index of particular type
+ * @param start - starting block number
+ * @param blkcnt - number of blocks requested
+ * @param blksz - size in bytes of each block
+ * @param bufp - set to a buffer large enough for the blocks to read
+ *
+ * @return - number of blocks to read from start into *bufp, which is more
+ * than blkcnt, or 0 to only read the blocks requested
+ */
+lbaint_t blkcache_readahead(int iftype, int dev,
+			    lbaint_t start, lbaint_t blkcnt,
+			    unsigned long blksz, void **bufp);
+
 /**
  * blkcache_fill() - make data read from a block device available
  * to the block cache
@@ -157,7 +182,10 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
+ * The cache holds entries of a fixed number of blocks, aligned to that number
+ * on the device, organised in sets of a few entries each.
+ *
+ * @param blocks - blocks per entry, at most 32; larger reads are not cached
  * @param entries - maximum entries in cache
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
@@ -171,6 +199,9 @@ struct block_cache_stats {
 	unsigned entries; /* current entry count */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
+	unsigned evictions;
+	unsigned sets;
+	unsigned ways; /* entries per set */
 };
 
 /**
@@ -189,6 +220,13 @@ static inline int blkcache_read(int iftype, int dev,
 	return 0;
 }
 
+static inline lbaint_t blkcache_readahead(int iftype, int dev,
+					  lbaint_t start, lbaint_t blkcnt,
+					  unsigned long blksz, void **bufp)
+{
+	return 0;
+}
+
 static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
@@ -201,6 +239,29 @@ static inline void blkcache_invalidate(int iftype, int dev) {}
 struct udevice;
 
 /* Operations on block devices */
+/**
+ * struct blk_req - A read queued with blk_dread_submit()
+ *
+ * The caller fills in @start, @blkcnt and @buffer and keeps the request
+ * until it has completed.
+ *
+ * @start:	Start block number to read (0=first)
+ * @blkcnt:	Number of blocks to read
+ * @buffer:	Destination buffer for data read
+ * @blks:	Number of blocks read so far
+ * @ret:	-EINPROGRESS until the request completes, then 0 if all the
+ *		blocks were read or -ve error number
+ * @next:	Next request queued on the same device
+ */
+struct blk_req {
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	lbaint_t blks;
+	int ret;
+	struct blk_req *next;
+};
+
 struct blk_ops {
 	/**
 	 * read() - read from a block device
@@ -258,6 +319,36 @@ struct blk_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
+
+	/**
+	 * read_start() - start reading from a block device
+	 *
+	 * This starts the transfer and returns without waiting for it.
+	 * read_poll() is then called until the request completes. A device
+	 * has at most one request started at a time.
+	 *
+	 * This is optional. Without it, blk_dread_submit() uses read().
+	 *
+	 * @dev:	Device to read from
+	 * @req:	Request to start
+	 * @return 0 if started, -EBUSY if the controller is busy with another
+	 * device so the request has to be started later, other -ve error
+	 * number on failure
+	 */
+	int (*read_start)(struct udevice *dev, struct blk_req *req);
+
+	/**
+	 * read_poll() - check on the request started by read_start()
+	 *
+	 * Large requests may be transferred in several pieces; @req->blks
+	 * counts the blocks read so far.
+	 *
+	 * @dev:	Device being read from
+	 * @req:	Request being read
+	 * @return 0 if the request completed, -EBUSY if it is still in
+	 * progress, other -ve error number on failure
+	 */
+	int (*read_poll)(struct udevice *dev, struct blk_req *req);
 };
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
@@ -275,6 +366,55 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+/**
+ * blk_dread_submit() - Queue a read from a block device
+ *
+ * If the driver can read in the background, this returns once the read
+ * is queued, so the caller can get on with other work while the data is
+ * transferred. blk_dpoll() and blk_req_wait() move the queue along.
+ * Otherwise the read is done before returning. Requests complete in the
+ * order they were submitted.
+ *
+ * Reads, writes and erases through the other functions wait for the
+ * queue to empty first.
+ *
+ * @desc:	Block device to read from
+ * @req:	Request with @start, @blkcnt and @buffer filled in
+ * @return 0 if the request was queued or has completed, -ve on error
+ */
+int blk_dread_submit(struct blk_desc *desc, struct blk_req *req);
+
+/**
+ * blk_dpoll() - Move along the reads queued on a block device
+ *
+ * This completes the request in progress if its data has arrived and
+ * starts the next one.
+ *
+ * @desc:	Block device
+ * @return 0 if no requests are left, -EBUSY if some are still queued
+ */
+int blk_dpoll(struct blk_desc *desc);
+
+/**
+ * blk_req_wait() - Wait for a request queued with blk_dread_submit()
+ *
+ * @desc:	Block device the request was submitted to
+ * @req:	Request to wait for
+ * @return 0 if all the blocks were read, -ve on error
+ */
+int blk_req_wait(struct blk_desc *desc, struct blk_req *req);
+
+/**
+ * blk_invalidate() - Note that the contents of a block device have changed
+ *
+ * This drops the cached blocks of the device and gives it a new generation
+ * number, so that a file system kept mounted from it is probed again. Each
+ * generation number is used only once, also across devices.
+ *
+ * @desc:	Block device which was written or (re)initialised
+ */
+void blk_invalidate(struct blk_desc *desc);
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -429,6 +569,9 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
 	ulong blks_read;
+	lbaint_t ra;
+	void *rabuf;
+
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
@@ -438,6 +581,16 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	 * bloats the code slightly (cause some board to fail to build), and
 	 * it would be an error to try an operation that does not exist.
 	 */
+	ra = blkcache_readahead(block_dev->if_type, block_dev->devnum,
+				start, blkcnt, block_dev->blksz, &rabuf);
+	if (ra && start + ra <= block_dev->lba &&
+	    block_dev->block_read(block_dev, start, ra, rabuf) == ra) {
+		memcpy(buffer, rabuf, blkcnt * block_dev->blksz);
+		blkcache_fill(block_dev->if_type, block_dev->devnum,
+			      start, ra, block_dev->blksz, rabuf);
+		return blkcnt;
+	}
+
 	blks_read = block_dev->block_read(block_dev, start, blkcnt, buffer);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
@@ -446,17 +599,23 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	return blks_read;
 }
 
+static inline void blk_invalidate(struct blk_desc *desc)
+{
+	blkcache_invalidate(desc->if_type, desc->devnum);
+	desc->gen++;
+}
+
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_invalidate(block_dev);
 	return block_dev->block_write(block_dev, start, blkcnt, buffer);
 }
 
 static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_invalidate(block_dev);
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
@@ -307,6 +307,21 @@ ulong	ticks2usec    (unsigned long ticks);
 
 /* lib/lz4_wrapper.c */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
+/* Decompress a single raw LZ4 block, without the frame around it */
+int ulz4_block(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+/* lib/zstd/zstd.c */
+/**
+ * zstd_decompress_buf() - Decompress all the Zstandard frames in a buffer
+ *
+ * @src:	Compressed data
+ * @srcn:	Length of the compressed data
+ * @dst:	Buffer for the decompressed data
+ * @dstn:	Size of @dst on entry, length of the decompressed data on exit
+ * @return 0 if OK, -ENOSPC if @dst is too small, -ENOMEM if out of memory,
+ * -EINVAL if the data is corrupt
+ */
+int zstd_decompress_buf(const void *src, size_t srcn, void *dst, size_t *dstn);
 
 /* lib/qsort.c */
 void qsort(void *base, size_t nmemb, size_t size,
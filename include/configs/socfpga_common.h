@@ -116,9 +116,15 @@
  * MMC Driver
  */
 #ifdef CONFIG_CMD_MMC
-/* FIXME */
-/* using smaller max blk cnt to avoid flooding the limited stack we have */
-#define CONFIG_SYS_MMC_MAX_BLK_COUNT	256	/* FIXME -- SPL only? */
+/*
+ * The DWMMC descriptors and bounce buffers come from malloc(), which is
+ * small in SPL. U-Boot proper transfers up to the 16-bit CMD23 limit.
+ */
+#ifdef CONFIG_SPL_BUILD
+#define CONFIG_SYS_MMC_MAX_BLK_COUNT	256
+#else
+#define CONFIG_SYS_MMC_MAX_BLK_COUNT	65535
+#endif
 #endif
 
 /*
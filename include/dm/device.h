@@ -162,9 +162,21 @@ static inline int dev_of_offset(const struct udevice *dev)
 	return ofnode_to_offset(dev->node);
 }
 
+/**
+ * dev_set_ofnode() - Change the device tree node of a device
+ *
+ * Drivers which move a device to a different node after binding it must
+ * use this rather than writing dev->node, so that lookups by node find
+ * the device.
+ *
+ * @dev:	Device to update
+ * @node:	New node for the device
+ */
+void dev_set_ofnode(struct udevice *dev, ofnode node);
+
 static inline void dev_set_of_offset(struct udevice *dev, int of_offset)
 {
-	dev->node = offset_to_ofnode(of_offset);
+	dev_set_ofnode(dev, offset_to_ofnode(of_offset));
 }
 
 static inline bool dev_has_of_node(struct udevice *dev)
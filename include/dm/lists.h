@@ -32,6 +32,34 @@ struct driver *lists_driver_lookup_name(const char *name);
  */
 struct uclass_driver *lists_uclass_lookup(enum uclass_id id);
 
+/**
+ * lists_driver_lookup_compat() - Return the driver for a compatible string
+ *
+ * If several drivers match, the first one in the linker list is returned.
+ * This is only available with CONFIG_OF_CONTROL and without
+ * CONFIG_OF_PLATDATA.
+ *
+ * @compat:	Compatible string to look up
+ * @of_idp:	Returns the matching entry of the driver's of_match table
+ * @return pointer to driver, or NULL if none matches
+ */
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **of_idp);
+
+/**
+ * lists_index_init() - Index the driver linker lists
+ *
+ * This builds hash tables which lists_driver_lookup_name(),
+ * lists_driver_lookup_compat() and lists_uclass_lookup() use instead of
+ * walking the linker lists, once per driver or device tree node. The index
+ * is stored in global data and allocated only once. It is only available
+ * with CONFIG_DM_DRIVER_INDEX.
+ *
+ * @return 0 if OK, -ENOMEM if out of memory, -E2BIG if there are too many
+ * drivers
+ */
+int lists_index_init(void);
+
 /**
  * lists_bind_drivers() - search for and bind all drivers to parent
  *
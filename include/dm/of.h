@@ -18,12 +18,14 @@ typedef u32 phandle;
  *
  * @name: Property name
  * @length: Length of property in bytes
+ * @hash: Hash of @name, from of_prop_hash()
  * @value: Pointer to property value
  * @next: Pointer to next property, or NULL if none
  */
 struct property {
 	char *name;
 	int length;
+	u32 hash;
 	void *value;
 	struct property *next;
 };
@@ -34,6 +36,8 @@ struct property {
  * @name: Node name
  * @type: Node type (value of device_type property) or "<NULL>" if none
  * @phandle: Phandle value of this none, or 0 if none
+ * @prop_filter: Bits set by of_prop_filter() for the hash of each property
+ *	name, so that most lookups of missing properties can stop early
  * @full_name: Full path to node, e.g. "/bus@1/spi@1100"
  * @properties: Pointer to head of list of properties, or NULL if none
  * @parent: Pointer to parent node, or NULL if this is the root node
@@ -44,6 +48,7 @@ struct device_node {
 	const char *name;
 	const char *type;
 	phandle phandle;
+	u32 prop_filter;
 	const char *full_name;
 
 	struct property *properties;
@@ -79,6 +79,44 @@ int of_simple_addr_cells(const struct device_node *np);
  */
 int of_simple_size_cells(const struct device_node *np);
 
+/**
+ * of_prop_hash() - Get the hash of a property name
+ *
+ * @name: Name of property
+ * @return hash value, used for struct property's hash member
+ */
+u32 of_prop_hash(const char *name);
+
+/**
+ * of_prop_filter() - Get the node filter bits for a property name hash
+ *
+ * A node's prop_filter is the OR of these bits for all of its properties,
+ * so a property is certainly missing if any of its bits are clear.
+ *
+ * @hash: Hash of the property name, from of_prop_hash()
+ * @return filter bits for the hash
+ */
+static inline u32 of_prop_filter(u32 hash)
+{
+	return 1U << (hash & 31) | 1U << ((hash >> 5) & 31);
+}
+
+/**
+ * of_prop_add_hash() - Set up the hash of a property added to a node
+ *
+ * This must be called for each property added to a node, so that
+ * of_find_property() can find it.
+ *
+ * @np: Node holding the property
+ * @pp: Property to set up, whose name is already set
+ */
+static inline void of_prop_add_hash(struct device_node *np,
+				    struct property *pp)
+{
+	pp->hash = of_prop_hash(pp->name);
+	np->prop_filter |= of_prop_filter(pp->hash);
+}
+
 /**
  * of_find_property() - find a property in a node
  *
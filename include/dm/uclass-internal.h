@@ -155,6 +155,21 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 				 struct udevice **devp);
 
+/**
+ * uclass_find_device_by_phandle_id() - Find a uclass device by phandle ID
+ *
+ * This searches the devices in the uclass for one with the given phandle.
+ *
+ * The device is NOT probed, it is merely returned.
+ *
+ * @id: ID to look up
+ * @phandle_id: Phandle of the device's node
+ * @devp: Returns pointer to device (there is only one for each node)
+ * @return 0 if OK, -ve on error
+ */
+int uclass_find_device_by_phandle_id(enum uclass_id id, uint phandle_id,
+				     struct udevice **devp);
+
 /**
  * uclass_find_device_by_phandle() - Find a uclass device by phandle
  *
@@ -196,6 +211,46 @@ int uclass_unbind_device(struct udevice *dev);
 static inline int uclass_unbind_device(struct udevice *dev) { return 0; }
 #endif
 
+/**
+ * uclass_set_seq() - Set the sequence number of a device
+ *
+ * This updates dev->seq and the uclass's index, if there is one, so it
+ * must be used instead of writing dev->seq directly.
+ *
+ * @dev:	Pointer to the device
+ * @seq:	New sequence number, or -1 for none
+ */
+void uclass_set_seq(struct udevice *dev, int seq);
+
+/**
+ * uclass_index_add_device() - Add a device to its uclass's index
+ *
+ * Add the device to the uclass's lookup tables by device tree node and
+ * phandle, if the uclass has them. This is called when a device is bound
+ * and when its node changes.
+ *
+ * @dev:	Pointer to the device
+ */
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+void uclass_index_add_device(struct udevice *dev);
+#else
+static inline void uclass_index_add_device(struct udevice *dev) {}
+#endif
+
+/**
+ * uclass_index_remove_device() - Remove a device from its uclass's index
+ *
+ * This is the counterpart of uclass_index_add_device(), called when a
+ * device is unbound and before its node changes.
+ *
+ * @dev:	Pointer to the device
+ */
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+void uclass_index_remove_device(struct udevice *dev);
+#else
+static inline void uclass_index_remove_device(struct udevice *dev) {}
+#endif
+
 /**
  * uclass_pre_probe_device() - Deal with a device that is about to be probed
  *
@@ -8,6 +8,7 @@
 #define __DWMMC_HW_H
 
 #include <asm/io.h>
+#include <bouncebuf.h>
 #include <mmc.h>
 
 #define DWMCI_CTRL		0x000
@@ -155,6 +156,12 @@
  * @fifoth_val:	Value for FIFOTH register (or 0 to leave unset)
  * @mmc:	Pointer to generic MMC structure for this device
  * @priv:	Private pointer for use by controller
+ * @idmac:	IDMAC descriptor chain, allocated on first use
+ * @idmac_count: Number of descriptors in @idmac
+ * @bbstate:	Bounce buffer of the DMA transfer in progress
+ * @async_data:	Data left to transfer by dwmci_send_cmd_start(), or NULL
+ * @async_start: Time the transfer of @async_data was started
+ * @async_timeout: Time allowed for the transfer of @async_data, in ms
  */
 struct dwmci_host {
 	const char *name;
@@ -195,6 +202,13 @@ struct dwmci_host {
 
 	/* use fifo mode to read and write data */
 	bool fifo_mode;
+
+	struct dwmci_idmac *idmac;
+	unsigned int idmac_count;
+	struct bounce_buffer bbstate;
+	struct mmc_data *async_data;
+	ulong async_start;
+	unsigned int async_timeout;
 };
 
 struct dwmci_idmac {
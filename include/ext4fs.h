@@ -28,9 +28,12 @@
 #define __EXT4__
 #include <ext_common.h>
 
+#define EXT4_ENCRYPT_FL		0x00000800 /* Encrypted inode */
 #define EXT4_INDEX_FL		0x00001000 /* Inode uses hash tree index */
 #define EXT4_EXTENTS_FL		0x00080000 /* Inode uses extents */
+#define EXT4_CASEFOLD_FL	0x40000000 /* Casefolded directory */
 #define EXT4_EXT_MAGIC			0xf30a
+#define EXT4_EXT_INIT_MAX_LEN	0x8000 /* Longer ones are unwritten */
 #define EXT4_FEATURE_RO_COMPAT_GDT_CSUM	0x0010
 #define EXT4_FEATURE_RO_COMPAT_METADATA_CSUM 0x0400
 #define EXT4_FEATURE_INCOMPAT_EXTENTS	0x0040
@@ -155,6 +158,20 @@ int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf);
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, disk_partition_t *info);
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache);
+/**
+ * read_allocated_run() - Find where a run of file blocks is stored
+ *
+ * @inode:	Inode of the file
+ * @fileblock:	First logical block of the run
+ * @maxblocks:	Maximum number of blocks wanted, at least 1
+ * @count:	Returns the number of blocks in the run, from 1 to @maxblocks
+ * @cache:	Cache for the extent tree blocks
+ * @return first physical block of the run, which is contiguous on disk, 0 if
+ * the run is a hole to read as zeroes, -ve on error
+ */
+long int read_allocated_run(struct ext2_inode *inode, int fileblock,
+			    int maxblocks, int *count,
+			    struct ext_block_cache *cache);
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 disk_partition_t *fs_partition);
 int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
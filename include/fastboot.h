@@ -36,6 +36,9 @@ enum {
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_FORMAT)
 	FASTBOOT_COMMAND_OEM_FORMAT,
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_STREAM)
+	FASTBOOT_COMMAND_OEM_STREAM,
+#endif
 
 	FASTBOOT_COMMAND_COUNT
 };
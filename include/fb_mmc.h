@@ -28,6 +28,24 @@ int fastboot_mmc_get_part_info(const char *part_name,
  */
 void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 			      u32 download_bytes, char *response);
+
+struct sparse_stream;
+
+/**
+ * fastboot_mmc_stream_start() - Get ready to write a sparse image as it comes
+ *
+ * @cmd: Named partition to write image to
+ * @ss: Stream to set up
+ * @buf: Buffer to gather image data in
+ * @buf_size: Size of buf
+ * @stream_response: Buffer for the response if the stream fails later on
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 on success, -ve if the partition cannot be written
+ */
+int fastboot_mmc_stream_start(const char *cmd, struct sparse_stream *ss,
+			      void *buf, u32 buf_size, char *stream_response,
+			      char *response);
+
 /**
  * fastboot_mmc_flash_erase() - Erase eMMC for fastboot
  *
@@ -13,6 +13,7 @@
 #define FS_TYPE_SANDBOX	3
 #define FS_TYPE_UBIFS	4
 #define FS_TYPE_BTRFS	5
+#define FS_TYPE_SQUASHFS 6
 
 /*
  * Tell the fs layer which block device an partition to use for future
@@ -37,6 +38,21 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype);
  */
 int fs_set_blk_dev_with_part(struct blk_desc *desc, int part);
 
+/**
+ * fs_unmount() - Drop the file system kept mounted between operations
+ *
+ * The file system found by fs_set_blk_dev() stays mounted until its device
+ * is written or reinitialised, so that later operations on the same
+ * partition do not probe it again. Call this before using a file system
+ * driver directly, e.g. through fat_set_blk_dev(), as that replaces the
+ * state the mounted file system relies on.
+ */
+#if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_FS_LOADER)
+void fs_unmount(void);
+#else
+static inline void fs_unmount(void) {}
+#endif
+
 /**
  * fs_get_type_name() - Get type of current filesystem
  *
@@ -23,6 +23,16 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/*
+	 * Optional: zero blocks without writing them, eg. by an erase that
+	 * leaves the blocks reading as zero. Only called for whole groups of
+	 * erase_grp blocks; returns the number of blocks zeroed.
+	 */
+	lbaint_t	erase_grp;
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+
 	void		(*mssg)(const char *str, char *response);
 };
 
@@ -37,5 +47,76 @@ static inline int is_sparse_image(void *buf)
 	return 0;
 }
 
+/**
+ * struct sparse_stream - State of a sparse image being written piecemeal
+ *
+ * Filled in by sparse_stream_start(); the fields are private to
+ * lib/image-sparse.c.
+ */
+struct sparse_stream {
+	struct sparse_storage	*info;
+	const char	*part_name;
+	char		*response;
+	void		*buf;		/* Staging for RAW data */
+	size_t		buf_size;
+	size_t		buf_used;
+	int		state;
+	union {
+		u8		buf[sizeof(sparse_header_t)];
+		sparse_header_t	file;
+		chunk_header_t	chunk;
+		u32		fill_val;
+	} hdr;				/* Header being gathered */
+	uint		hdr_len;
+	sparse_header_t	file;
+	unsigned int	chunk;		/* Current chunk number */
+	u64		left;		/* Bytes left in the chunk */
+	u64		extra;		/* Header bytes to skip */
+	lbaint_t	blk;
+	lbaint_t	zero_blks;	/* Zero blocks held back */
+	u64		total_blocks;
+	u64		bytes_written;
+};
+
 int write_sparse_image(struct sparse_storage *info, const char *part_name,
 		       void *data, char *response);
+
+/**
+ * sparse_stream_start() - Prepare to write a sparse image as it arrives
+ *
+ * RAW data that comes in pieces smaller than @buf_size is gathered in @buf
+ * so that the storage sees large writes, also across RAW chunks; larger
+ * pieces are written straight from where they are.
+ *
+ * @ss:		Stream state to set up
+ * @info:	Storage to write the image to
+ * @part_name:	Name of the partition, for messages
+ * @buf:	Staging buffer, aligned for the storage
+ * @buf_size:	Size of @buf in bytes
+ * @response:	Where info->mssg() puts the reason of a failure
+ * @return 0
+ */
+int sparse_stream_start(struct sparse_stream *ss,
+			struct sparse_storage *info, const char *part_name,
+			void *buf, size_t buf_size, char *response);
+
+/**
+ * sparse_stream_write() - Write the next piece of a sparse image
+ *
+ * Data after the last chunk of the image is ignored.
+ *
+ * @ss:		Stream state
+ * @data:	Next bytes of the image
+ * @len:	Number of bytes at @data
+ * @return 0 on success, -1 if the image is bad or a write failed
+ */
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			size_t len);
+
+/**
+ * sparse_stream_finish() - Check that the whole sparse image was written
+ *
+ * @ss:		Stream state
+ * @return 0 on success, -1 if the image was incomplete or failed earlier
+ */
+int sparse_stream_finish(struct sparse_stream *ss);
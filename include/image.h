@@ -92,6 +92,19 @@ struct fdt_region;
 #define IMAGE_ENABLE_SHA256	0
 #endif
 
+/*
+ * Hashing while an image is read needs the progressive hashes of hash.c.
+ * Hardware ones may only read the data at the end, when the buffers used
+ * for reading have been reused.
+ */
+#if defined(USE_HOSTCC) || defined(CONFIG_SHA_PROG_HW_ACCEL)
+#define IMAGE_ENABLE_HASH_STREAM	0
+#elif defined(CONFIG_SPL_BUILD)
+#define IMAGE_ENABLE_HASH_STREAM	IS_ENABLED(CONFIG_SPL_HASH_SUPPORT)
+#else
+#define IMAGE_ENABLE_HASH_STREAM	IS_ENABLED(CONFIG_HASH)
+#endif
+
 #endif /* IMAGE_ENABLE_FIT */
 
 #ifdef CONFIG_SYS_BOOT_GET_CMDLINE
@@ -303,6 +316,7 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_ZSTD,			/* zstd  Compression Used	*/
 
 	IH_COMP_COUNT,
 };
@@ -868,6 +882,73 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+/**
+ * struct image_decomp_stream - State of a streaming decompression
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @dst:	Place to decompress to
+ * @dst_len:	Space available at @dst
+ * @out:	Number of bytes written to @dst so far
+ * @done:	true once the end of the compressed data has been seen
+ * @priv:	Private data of the decompressor
+ */
+struct image_decomp_stream {
+	int comp;
+	void *dst;
+	size_t dst_len;
+	size_t out;
+	bool done;
+	void *priv;
+};
+
+/**
+ * image_decomp_can_stream() - Check if data can be decompressed in pieces
+ *
+ * @comp:	Compression algorithm (IH_COMP_...)
+ * @return true if image_decomp_start() supports @comp
+ */
+bool image_decomp_can_stream(int comp);
+
+/**
+ * image_decomp_start() - Start decompressing data fed in pieces
+ *
+ * This allows compressed data to be decompressed as it is read, without
+ * holding all of it in memory. The output goes to a single buffer.
+ *
+ * @ds:		Stream state to set up
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @dst:	Place to decompress to
+ * @dst_len:	Space available at @dst
+ * @return 0 if OK, -ENOSYS if @comp cannot be streamed, -ENOMEM if out of
+ *	memory
+ */
+int image_decomp_start(struct image_decomp_stream *ds, int comp, void *dst,
+		       size_t dst_len);
+
+/**
+ * image_decomp_feed() - Decompress the next piece of data
+ *
+ * @ds:		Stream state
+ * @src:	Compressed data following what was fed before
+ * @len:	Number of bytes at @src, may be anything
+ * @return 0 if OK, -ENOSPC if the output does not fit, -EINVAL if the data
+ *	is corrupt, -ENOMEM if out of memory
+ */
+int image_decomp_feed(struct image_decomp_stream *ds, const void *src,
+		      size_t len);
+
+/**
+ * image_decomp_end() - Finish decompressing and free the stream state
+ *
+ * This must be called once for each image_decomp_start() which succeeded,
+ * also after an error.
+ *
+ * @ds:		Stream state
+ * @lenp:	Returns the number of bytes decompressed (may be NULL)
+ * @return 0 if OK, -EINVAL if the compressed data was incomplete
+ */
+int image_decomp_end(struct image_decomp_stream *ds, size_t *lenp);
+
 /**
  * Set up properties in the FDT
  *
@@ -1054,6 +1135,76 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 
 int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *data, size_t size);
+
+/* Most hash nodes an image may have to be verified while it is read */
+#define FIT_HASH_STREAM_MAX	4
+
+/**
+ * struct fit_image_hash_stream - Verification of an image fed in pieces
+ *
+ * @fit:		FIT holding the image
+ * @image_noffset:	Offset of the image node
+ * @count:		Number of entries in @hash
+ * @hash:		One entry for each hash node of the image
+ */
+struct fit_image_hash_stream {
+	const void *fit;
+	int image_noffset;
+	int count;
+	struct fit_hash_ctx {
+		int noffset;		/* Offset of the hash node */
+		const char *name;	/* Name of the algorithm */
+		struct hash_algo *algo;	/* NULL if the node is ignored */
+		void *ctx;		/* Progressive hash context */
+	} hash[FIT_HASH_STREAM_MAX];
+};
+
+/**
+ * fit_image_hash_start() - Start verifying an image while it is read
+ *
+ * This checks the same as fit_image_verify_with_data(), but the data is
+ * hashed as it arrives, with fit_image_hash_update(), instead of in one go
+ * once all of it is in memory.
+ *
+ * @hs:			Verification state to set up
+ * @fit:		FIT holding the image
+ * @image_noffset:	Offset of the image node
+ * @return 0 if OK, -ENOSYS if the image can only be verified as a whole,
+ *	for example because it is signed; fit_image_verify_with_data() must
+ *	then be used instead
+ */
+int fit_image_hash_start(struct fit_image_hash_stream *hs, const void *fit,
+			 int image_noffset);
+
+/**
+ * fit_image_hash_update() - Hash the next piece of image data
+ *
+ * @hs:		Verification state
+ * @data:	Data following what was given before
+ * @size:	Number of bytes at @data
+ */
+void fit_image_hash_update(struct fit_image_hash_stream *hs, const void *data,
+			   size_t size);
+
+/**
+ * fit_image_hash_finish() - Check the hashes of the image data
+ *
+ * This must be called once for each fit_image_hash_start() which succeeded.
+ *
+ * @hs:		Verification state
+ * @return 1 if all hashes are valid, 0 otherwise
+ */
+int fit_image_hash_finish(struct fit_image_hash_stream *hs);
+
+/**
+ * fit_image_hash_abort() - Give up verifying an image
+ *
+ * This frees the hash contexts, for when fit_image_hash_finish() is not
+ * called.
+ *
+ * @hs:		Verification state
+ */
+void fit_image_hash_abort(struct fit_image_hash_stream *hs);
 int fit_image_verify(const void *fit, int noffset);
 int fit_config_verify(const void *fit, int conf_noffset);
 int fit_all_image_verify(const void *fit);
@@ -70,6 +70,7 @@
 #define MMC_CAP_NONREMOVABLE	BIT(14)
 #define MMC_CAP_NEEDS_POLL	BIT(15)
 #define MMC_CAP_CD_ACTIVE_HIGH  BIT(16)
+#define MMC_CAP_CMD23		BIT(17)	/* host handles SET_BLOCK_COUNT */
 
 #define MMC_MODE_8BIT		BIT(30)
 #define MMC_MODE_4BIT		BIT(29)
@@ -78,6 +79,8 @@
 
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_DATA_STAT_AFTER_ERASE	0x00800000
+#define SD_SCR_CMD23_SUPPORT	BIT(1)
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -223,6 +226,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_ERASE_GROUP_DEF		175	/* R/W */
 #define EXT_CSD_BOOT_BUS_WIDTH		177
 #define EXT_CSD_PART_CONF		179	/* R/W */
+#define EXT_CSD_ERASED_MEM_CONT		181	/* RO */
 #define EXT_CSD_BUS_WIDTH		183	/* R/W */
 #define EXT_CSD_STROBE_SUPPORT		184	/* R/W */
 #define EXT_CSD_HS_TIMING		185	/* R/W */
@@ -416,6 +420,32 @@ struct dm_mmc_ops {
 	int (*send_cmd)(struct udevice *dev, struct mmc_cmd *cmd,
 			struct mmc_data *data);
 
+	/**
+	 * send_cmd_start() - Send a command and start its data transfer
+	 *
+	 * Unlike send_cmd(), this returns once the response has arrived,
+	 * without waiting for the data. send_cmd_poll() is then called until
+	 * the transfer is over. This is optional: send_cmd() is used instead
+	 * if it is not provided.
+	 *
+	 * @dev:	Device to receive the command
+	 * @cmd:	Command to send
+	 * @data:	Data to send/receive
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*send_cmd_start)(struct udevice *dev, struct mmc_cmd *cmd,
+			      struct mmc_data *data);
+
+	/**
+	 * send_cmd_poll() - Check on the data transfer of send_cmd_start()
+	 *
+	 * @dev:	Device to check
+	 * @data:	Data passed to send_cmd_start()
+	 * @return 0 if the transfer is over, -EBUSY if it is still in
+	 * progress, other -ve on error
+	 */
+	int (*send_cmd_poll)(struct udevice *dev, struct mmc_data *data);
+
 	/**
 	 * set_ios() - Set the I/O speed/width for an MMC device
 	 *
@@ -472,6 +502,9 @@ struct dm_mmc_ops {
 
 int dm_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		    struct mmc_data *data);
+int dm_mmc_send_cmd_start(struct udevice *dev, struct mmc_cmd *cmd,
+			  struct mmc_data *data);
+int dm_mmc_send_cmd_poll(struct udevice *dev, struct mmc_data *data);
 int dm_mmc_set_ios(struct udevice *dev);
 int dm_mmc_get_cd(struct udevice *dev);
 int dm_mmc_get_wp(struct udevice *dev);
@@ -650,6 +683,11 @@ struct mmc {
 				  * accessing the boot partitions
 				  */
 	u32 quirks;
+#if CONFIG_IS_ENABLED(DM_MMC) && CONFIG_IS_ENABLED(BLK)
+	/* Piece of a read started by mmc_bread_start(), blocks is 0 if none */
+	struct mmc_data async_data;
+	bool async_stop;	/* async_data needs a STOP_TRANSMISSION */
+#endif
 };
 
 struct mmc_hwpart_conf {
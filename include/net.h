@@ -111,6 +111,33 @@ enum eth_recv_flags {
 	ETH_RECV_CHECK_DEVICE		= 1 << 0,
 };
 
+/**
+ * struct eth_rx_split - request to receive frame payloads in place
+ *
+ * A driver whose DMA engine can scatter a received frame over two buffers
+ * may deliver the payload straight into memory chosen by the network stack,
+ * so that for example TFTP data lands at its load address without being
+ * copied out of the packet buffer.
+ *
+ * @hdr_len: Number of bytes at the start of each frame which are kept in the
+ *	     driver's own packet buffer (Ethernet, IP, UDP and protocol
+ *	     headers)
+ * @base: Start of the first payload slot
+ * @stride: Size of each payload slot. Frames with a longer payload are not
+ *	    split
+ * @count: Number of payload slots. These are used in the order in which
+ *	   frames arrive; once they are all used frames are no longer split
+ * @udp_dport: UDP destination port of the frames the caller expects. Any
+ *	       other split frame is put back together before it is processed
+ */
+struct eth_rx_split {
+	int hdr_len;
+	uchar *base;
+	int stride;
+	int count;
+	int udp_dport;
+};
+
 /**
  * struct eth_ops - functions of Ethernet MAC controllers
  *
@@ -136,6 +163,12 @@ enum eth_recv_flags {
  *		    ROM on the board. This is how the driver should expose it
  *		    to the network stack. This function should fill in the
  *		    eth_pdata::enetaddr field - optional
+ * set_rx_split: Place the payload of frames received from now on in the
+ *		 slots described by the eth_rx_split, or stop doing so if it
+ *		 is NULL. For each frame split this way, recv() must call
+ *		 eth_rx_set_payload(). The packet buffer returned by recv()
+ *		 must still be large enough to hold the complete frame, since
+ *		 the uclass may have to copy the payload back - optional
  */
 struct eth_ops {
 	int (*start)(struct udevice *dev);
@@ -146,6 +179,8 @@ struct eth_ops {
 	int (*mcast)(struct udevice *dev, const u8 *enetaddr, int join);
 	int (*write_hwaddr)(struct udevice *dev);
 	int (*read_rom_hwaddr)(struct udevice *dev);
+	int (*set_rx_split)(struct udevice *dev,
+			    const struct eth_rx_split *split);
 };
 
 #define eth_get_ops(dev) ((struct eth_ops *)(dev)->driver->ops)
@@ -162,6 +197,35 @@ unsigned char *eth_get_ethaddr(void); /* get the current device MAC */
 int eth_is_active(struct udevice *dev); /* Test device for active state */
 int eth_init_state_only(void); /* Set active state */
 void eth_halt_state_only(void); /* Set passive state */
+
+/**
+ * eth_set_rx_split() - Ask the current device to receive payloads in place
+ *
+ * @split: Description of the payload slots, or NULL to stop splitting frames
+ * @return 0 if OK, -ENOSYS if the device cannot do this, other -ve on error
+ */
+int eth_set_rx_split(const struct eth_rx_split *split);
+
+/**
+ * eth_get_rx_payload() - Get the payload location of the frame being handled
+ *
+ * This may be called from a packet handler to find out whether the driver
+ * placed the payload of the current frame in one of the slots set up with
+ * eth_set_rx_split(). The headers are always in the packet buffer.
+ *
+ * @return pointer to the payload, or NULL if the frame is contiguous
+ */
+uchar *eth_get_rx_payload(void);
+
+/**
+ * eth_rx_set_payload() - Record where the payload of a split frame was placed
+ *
+ * This is called by drivers from their recv() method.
+ *
+ * @dev: Ethernet device
+ * @payload: Location of the payload, i.e. of the bytes following hdr_len
+ */
+void eth_rx_set_payload(struct udevice *dev, uchar *payload);
 #endif
 
 #ifndef CONFIG_DM_ETH
@@ -218,6 +282,19 @@ static __always_inline void eth_halt_state_only(void)
 	eth_get_dev()->state = ETH_STATE_PASSIVE;
 }
 
+struct eth_rx_split;
+
+/* Receiving payloads in place needs driver model */
+static inline int eth_set_rx_split(const struct eth_rx_split *split)
+{
+	return -ENOSYS;
+}
+
+static inline uchar *eth_get_rx_payload(void)
+{
+	return NULL;
+}
+
 /*
  * Set the hardware address for an ethernet interface based on 'eth%daddr'
  * environment variable (or just 'ethaddr' if eth_number is 0).
@@ -346,6 +423,7 @@ struct vlan_ethernet_hdr {
 #define PROT_PPP_SES	0x8864		/* PPPoE session messages	*/
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -531,7 +609,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL
+	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, WGET
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
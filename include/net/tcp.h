@@ -0,0 +1,163 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP client
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+/*
+ *	TCP header, following the IP header.
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* Sequence number		*/
+	u32		tcp_ack;	/* Acknowledgment number	*/
+	u8		tcp_hlen;	/* 4 bits header length, 4 reserved */
+	u8		tcp_flags;	/* Control bits			*/
+	u16		tcp_win;	/* Receive window		*/
+	u16		tcp_xsum;	/* Checksum			*/
+	u16		tcp_urg;	/* Urgent pointer		*/
+} __attribute__((packed));
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+/* Control bits */
+#define TCP_FIN		0x01
+#define TCP_SYN		0x02
+#define TCP_RST		0x04
+#define TCP_PSH		0x08
+#define TCP_ACK		0x10
+#define TCP_URG		0x20
+
+/* Options */
+#define TCP_OPT_EOL	0
+#define TCP_OPT_NOP	1
+#define TCP_OPT_MSS	2
+
+/* Our MSS: the largest segment that fits an Ethernet frame */
+#define TCP_MSS		(ETH_DATA_LEN - IP_TCP_HDR_SIZE)
+/* Largest application payload tcp_send() accepts at once */
+#define TCP_TX_MAX	TCP_MSS
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_FIN_WAIT_1,
+	TCP_FIN_WAIT_2,
+	TCP_CLOSE_WAIT,
+	TCP_LAST_ACK,
+};
+
+/**
+ * enum tcp_event - connection events reported to the user of the connection
+ *
+ * @TCP_EV_CONNECTED: The three-way handshake completed
+ * @TCP_EV_EOF: The peer sent FIN after all of its data was received
+ * @TCP_EV_RESET: The peer reset or refused the connection
+ * @TCP_EV_TIMEOUT: Retransmissions were exhausted or the peer went silent
+ */
+enum tcp_event {
+	TCP_EV_CONNECTED,
+	TCP_EV_EOF,
+	TCP_EV_RESET,
+	TCP_EV_TIMEOUT,
+};
+
+/**
+ * struct tcp_ops - callbacks of the user of a connection
+ *
+ * @rx: Called with data received from the peer. @offset is the position of
+ *	@data in the byte stream, counted from 0. Segments may be passed in
+ *	any order, and retransmitted data may be passed again. Return 0 if
+ *	the data was consumed, or a -ve error to have the segment dropped.
+ *	Dropped in-sequence data will not be acknowledged, so only do that
+ *	for out-of-sequence data or when giving up on the connection.
+ * @event: Called on connection state changes
+ */
+struct tcp_ops {
+	int (*rx)(u32 offset, const uchar *data, unsigned int len);
+	void (*event)(enum tcp_event event);
+};
+
+/**
+ * tcp_connect() - Open a connection to a remote port
+ *
+ * The connection is reported as established through the event callback.
+ *
+ * @dest: Remote IP address
+ * @dport: Remote TCP port
+ * @ops: Callbacks for the connection
+ * @return 0 if the SYN was sent or is waiting for ARP, -ve on error
+ */
+int tcp_connect(struct in_addr dest, int dport, const struct tcp_ops *ops);
+
+/**
+ * tcp_send() - Queue data to be sent once the connection is established
+ *
+ * The data is copied. Only a single segment can be outstanding at a time.
+ *
+ * @data: Data to send
+ * @len: Length of data, at most TCP_TX_MAX
+ * @return 0 if OK, -EBUSY if data is still outstanding, -E2BIG if too large
+ */
+int tcp_send(const void *data, unsigned int len);
+
+/**
+ * tcp_close() - Close our side of the connection once queued data is sent
+ */
+void tcp_close(void);
+
+/**
+ * tcp_abort() - Reset the connection immediately
+ */
+void tcp_abort(void);
+
+/**
+ * tcp_get_state() - Get the state of the connection
+ *
+ * @return the current state
+ */
+enum tcp_state tcp_get_state(void);
+
+/**
+ * tcp_set_tcp_header() - Construct the IP and TCP headers of a segment
+ *
+ * The payload must already be at IP_TCP_HDR_SIZE from @pkt. A SYN segment
+ * carries options and no payload.
+ *
+ * @pkt: Start of the IP header
+ * @dest: Remote IP address
+ * @dport: Remote TCP port
+ * @sport: Local TCP port
+ * @payload_len: Length of the payload
+ * @flags: TCP control bits
+ * @seq: Sequence number
+ * @ack: Acknowledgment number
+ * @return size of the IP and TCP headers including options
+ */
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 flags, u32 seq, u32 ack);
+
+/**
+ * tcp_receive() - Process a received TCP segment
+ *
+ * @ip: Start of the IP header
+ * @len: Length of the IP datagram
+ */
+void tcp_receive(struct ip_tcp_hdr *ip, unsigned int len);
+
+#endif /* __TCP_H__ */
@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * HTTP/1.1 download over TCP
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+/* Begin a download of net_boot_file_name to load_addr */
+void wget_start(void);
+
+#endif /* __WGET_H__ */
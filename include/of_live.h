@@ -9,6 +9,8 @@
 #ifndef _OF_LIVE_H
 #define _OF_LIVE_H
 
+#include <linux/types.h>
+
 struct device_node;
 
 /**
@@ -20,4 +22,41 @@ struct device_node;
  */
 int of_live_build(const void *fdt_blob, struct device_node **rootp);
 
+/**
+ * of_live_size() - get the size of a live tree image for a flat DT
+ *
+ * @fdt_blob: Input tree to convert
+ * @sizep: Returns the number of bytes needed by of_live_build_image()
+ * @return 0 if OK, -ve on error
+ */
+int of_live_size(const void *fdt_blob, ulong *sizep);
+
+/**
+ * of_live_build_image() - build a live tree image in a block of memory
+ *
+ * The image holds all the nodes and properties of the tree in one block,
+ * which can be built before relocation and used afterwards without
+ * unflattening the tree again. Property names and values point into
+ * @fdt_blob, so it must not be changed while the image is in use. If it is
+ * moved, call of_live_relocate() with the new address.
+ *
+ * @fdt_blob: Input tree to convert
+ * @buf: Memory for the image, which must be aligned for a pointer
+ * @size: Size of @buf in bytes
+ * @return 0 if OK, -ENOSPC if @buf is too small, other -ve on error
+ */
+int of_live_build_image(const void *fdt_blob, void *buf, ulong size);
+
+/**
+ * of_live_relocate() - adjust a live tree image for a new flat DT address
+ *
+ * This updates the pointers into the flat DT if it has moved since the
+ * image was built, e.g. when U-Boot relocates.
+ *
+ * @buf: Image built by of_live_build_image()
+ * @fdt_blob: Current address of the flat DT the image was built from
+ * @return root node of the tree in the image
+ */
+struct device_node *of_live_relocate(void *buf, const void *fdt_blob);
+
 #endif
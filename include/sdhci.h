@@ -332,6 +332,9 @@ struct sdhci_host {
 	struct sdhci_adma_desc *adma_desc_table;
 	uint desc_slot;
 #endif
+	/* ADMA transfer left running by send_cmd_start(), or NULL */
+	struct mmc_data *async_data;
+	ulong async_start;	/* when it was started */
 };
 
 #ifdef CONFIG_MMC_SDHCI_IO_ACCESSORS
@@ -41,6 +41,26 @@ uint32_t crc32_no_comp (uint32_t, const unsigned char *, uint);
 void crc32_wd_buf(const unsigned char *input, uint ilen,
 		    unsigned char *output, uint chunk_sz);
 
+/* arch/arm/cpu/armv8/crc32.S */
+
+/**
+ * crc32_armv8_supported() - Check for the ARMv8 CRC32 instructions
+ *
+ * @return non-zero if the CPU implements them
+ */
+int crc32_armv8_supported(void);
+
+/**
+ * crc32_armv8_le() - Update a CRC as crc32_no_comp() does, using the ARMv8
+ *		      CRC32 instructions
+ *
+ * @crc:	Current CRC value
+ * @buf:	Data to add
+ * @len:	Length of data in bytes
+ * @return updated CRC value
+ */
+uint32_t crc32_armv8_le(uint32_t crc, const unsigned char *buf, size_t len);
+
 /* lib/crc32c.c */
 void crc32c_init(uint32_t *, uint32_t);
 uint32_t crc32c_cal(uint32_t, const char *, int, uint32_t *);
@@ -101,6 +101,18 @@ void sha1_hmac(const unsigned char *key, int keylen,
  */
 int sha1_self_test( void );
 
+/**
+ * \brief	   Hash blocks with the ARMv8 Crypto Extensions
+ *
+ * \param state    SHA-1 intermediate digest state
+ * \param data	   buffer holding the data
+ * \param blocks   number of 64-byte blocks in the buffer
+ *
+ * \return	   0 if done, or -ENOSYS if the CPU lacks the instructions
+ */
+int sha1_armv8_ce_process(unsigned long state[5], const unsigned char *data,
+			  unsigned int blocks);
+
 #ifdef __cplusplus
 }
 #endif
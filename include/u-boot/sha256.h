@@ -22,4 +22,11 @@ void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
 void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+/*
+ * Hash @blocks blocks of 64 bytes with the ARMv8 Crypto Extensions. Returns 0
+ * if done, or -ENOSYS if the CPU lacks them and software must be used.
+ */
+int sha256_armv8_ce_process(uint32_t state[8], const uint8_t *data,
+			    uint32_t blocks);
+
 #endif /* _SHA256_H */
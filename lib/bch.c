@@ -83,6 +83,9 @@
 #define kzalloc(size, flags)	calloc(1, size)
 #define kfree free
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+#ifndef __always_inline
+#define __always_inline inline __attribute__((always_inline))
+#endif
 #endif
 
 #include <asm/byteorder.h>
@@ -214,6 +217,64 @@ static void store_ecc8(struct bch_control *bch, uint8_t *dst,
 	memcpy(dst, pad, BCH_ECC_BYTES(bch)-4*nwords);
 }
 
+/*
+ * process 32-bit aligned data words, with the parity remainder held in @r
+ *
+ * This is always inlined so that callers passing a constant @l get a copy
+ * with the inner loop unrolled and the remainder kept in registers.
+ */
+static __always_inline void encode_bch_words(struct bch_control *bch,
+					     const uint32_t *pdata,
+					     unsigned int mlen, uint32_t *r,
+					     const unsigned int l)
+{
+	unsigned int i;
+	uint32_t w;
+	const uint32_t * const tab0 = bch->mod8_tab;
+	const uint32_t * const tab1 = tab0 + 256*(l+1);
+	const uint32_t * const tab2 = tab1 + 256*(l+1);
+	const uint32_t * const tab3 = tab2 + 256*(l+1);
+	const uint32_t *p0, *p1, *p2, *p3;
+
+	/*
+	 * split each 32-bit word into 4 polynomials of weight 8 as follows:
+	 *
+	 * 31 ...24  23 ...16  15 ... 8  7 ... 0
+	 * xxxxxxxx  yyyyyyyy  zzzzzzzz  tttttttt
+	 *                               tttttttt  mod g = r0 (precomputed)
+	 *                     zzzzzzzz  00000000  mod g = r1 (precomputed)
+	 *           yyyyyyyy  00000000  00000000  mod g = r2 (precomputed)
+	 * xxxxxxxx  00000000  00000000  00000000  mod g = r3 (precomputed)
+	 * xxxxxxxx  yyyyyyyy  zzzzzzzz  tttttttt  mod g = r0^r1^r2^r3
+	 */
+	while (mlen--) {
+		/* input data is read in big-endian format */
+		w = r[0]^cpu_to_be32(*pdata++);
+		p0 = tab0 + (l+1)*((w >>  0) & 0xff);
+		p1 = tab1 + (l+1)*((w >>  8) & 0xff);
+		p2 = tab2 + (l+1)*((w >> 16) & 0xff);
+		p3 = tab3 + (l+1)*((w >> 24) & 0xff);
+
+		for (i = 0; i < l; i++)
+			r[i] = r[i+1]^p0[i]^p1[i]^p2[i]^p3[i];
+
+		r[l] = p0[l]^p1[l]^p2[l]^p3[l];
+	}
+}
+
+/*
+ * run encode_bch_words() on a local copy of the remainder, which the compiler
+ * can keep in registers when @_l is a constant
+ */
+#define ENCODE_BCH_WORDS(_bch, _pdata, _mlen, _l)			\
+	do {								\
+		uint32_t _r[(_l)+1];					\
+									\
+		memcpy(_r, (_bch)->ecc_buf, sizeof(_r));		\
+		encode_bch_words(_bch, _pdata, _mlen, _r, _l);		\
+		memcpy((_bch)->ecc_buf, _r, sizeof(_r));		\
+	} while (0)
+
 /**
  * encode_bch - calculate BCH ecc parity of data
  * @bch:   BCH control structure
@@ -232,20 +293,15 @@ void encode_bch(struct bch_control *bch, const uint8_t *data,
 		unsigned int len, uint8_t *ecc)
 {
 	const unsigned int l = BCH_ECC_WORDS(bch)-1;
-	unsigned int i, mlen;
+	unsigned int mlen;
 	unsigned long m;
-	uint32_t w, r[l+1];
-	const uint32_t * const tab0 = bch->mod8_tab;
-	const uint32_t * const tab1 = tab0 + 256*(l+1);
-	const uint32_t * const tab2 = tab1 + 256*(l+1);
-	const uint32_t * const tab3 = tab2 + 256*(l+1);
-	const uint32_t *pdata, *p0, *p1, *p2, *p3;
+	const uint32_t *pdata;
 
 	if (ecc) {
 		/* load ecc parity bytes into internal 32-bit buffer */
 		load_ecc8(bch, bch->ecc_buf, ecc);
 	} else {
-		memset(bch->ecc_buf, 0, sizeof(r));
+		memset(bch->ecc_buf, 0, (l+1)*sizeof(*bch->ecc_buf));
 	}
 
 	/* process first unaligned data bytes */
@@ -262,33 +318,26 @@ void encode_bch(struct bch_control *bch, const uint8_t *data,
 	mlen  = len/4;
 	data += 4*mlen;
 	len  -= 4*mlen;
-	memcpy(r, bch->ecc_buf, sizeof(r));
 
+#if defined(CONFIG_BCH_CONST_PARAMS)
+	ENCODE_BCH_WORDS(bch, pdata, mlen, l);
+#else
 	/*
-	 * split each 32-bit word into 4 polynomials of weight 8 as follows:
-	 *
-	 * 31 ...24  23 ...16  15 ... 8  7 ... 0
-	 * xxxxxxxx  yyyyyyyy  zzzzzzzz  tttttttt
-	 *                               tttttttt  mod g = r0 (precomputed)
-	 *                     zzzzzzzz  00000000  mod g = r1 (precomputed)
-	 *           yyyyyyyy  00000000  00000000  mod g = r2 (precomputed)
-	 * xxxxxxxx  00000000  00000000  00000000  mod g = r3 (precomputed)
-	 * xxxxxxxx  yyyyyyyy  zzzzzzzz  tttttttt  mod g = r0^r1^r2^r3
+	 * use a specialised copy for the ecc sizes of the usual NAND
+	 * configurations: 4-bit (m=13) and 8-bit (m=13, 14) correction
 	 */
-	while (mlen--) {
-		/* input data is read in big-endian format */
-		w = r[0]^cpu_to_be32(*pdata++);
-		p0 = tab0 + (l+1)*((w >>  0) & 0xff);
-		p1 = tab1 + (l+1)*((w >>  8) & 0xff);
-		p2 = tab2 + (l+1)*((w >> 16) & 0xff);
-		p3 = tab3 + (l+1)*((w >> 24) & 0xff);
-
-		for (i = 0; i < l; i++)
-			r[i] = r[i+1]^p0[i]^p1[i]^p2[i]^p3[i];
-
-		r[l] = p0[l]^p1[l]^p2[l]^p3[l];
+	switch (l) {
+	case 1:
+		ENCODE_BCH_WORDS(bch, pdata, mlen, 1);
+		break;
+	case 3:
+		ENCODE_BCH_WORDS(bch, pdata, mlen, 3);
+		break;
+	default:
+		ENCODE_BCH_WORDS(bch, pdata, mlen, l);
+		break;
 	}
-	memcpy(bch->ecc_buf, r, sizeof(r));
+#endif
 
 	/* process last unaligned bytes */
 	if (len)
@@ -384,7 +433,7 @@ static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 			      unsigned int *syn)
 {
 	int i, j, s;
-	unsigned int m;
+	unsigned int m, e, e2, x;
 	uint32_t poly;
 	const int t = GF_T(bch);
 
@@ -402,8 +451,16 @@ static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 		s -= 32;
 		while (poly) {
 			i = deg(poly);
-			for (j = 0; j < 2*t; j += 2)
-				syn[j] ^= a_pow(bch, (j+1)*(i+s));
+			/*
+			 * step through the exponents (j+1)*(i+s) by adding
+			 * 2*(i+s) modulo n, rather than reducing each product
+			 */
+			e = modulo(bch, i+s);
+			e2 = mod_s(bch, 2*e);
+			for (j = 0, x = e; j < 2*t; j += 2) {
+				syn[j] ^= bch->a_pow_tab[x];
+				x = mod_s(bch, x+e2);
+			}
 
 			poly ^= (1 << i);
 		}
@@ -1037,6 +1094,7 @@ int decode_bch(struct bch_control *bch, const uint8_t *data, unsigned int len,
 	unsigned int nbits;
 	int i, err, nroots;
 	uint32_t sum;
+	unsigned int synsum;
 
 	/* sanity check: make sure data length can be handled */
 	if (8*len > (bch->n-bch->ecc_bits))
@@ -1069,6 +1127,16 @@ int decode_bch(struct bch_control *bch, const uint8_t *data, unsigned int len,
 		syn = bch->syn;
 	}
 
+	/*
+	 * an all-zero syndrome means no error: skip the error locator
+	 * polynomial and root finding altogether, which matters on reads of
+	 * clean pages with a calc_ecc already XORed with the received ecc
+	 */
+	for (i = 0, synsum = 0; i < 2*(int)GF_T(bch); i++)
+		synsum |= syn[i];
+	if (!synsum)
+		return 0;
+
 	err = compute_error_locator_polynomial(bch, syn);
 	if (err > 0) {
 		nroots = find_poly_roots(bch, 1, bch->elp, errloc);
@@ -44,43 +44,233 @@
 
 #include <linux/math64.h>
 
+enum {
+	SPARSE_STREAM_FILE_HDR,
+	SPARSE_STREAM_CHUNK_HDR,
+	SPARSE_STREAM_FILL_VAL,
+	SPARSE_STREAM_RAW,
+	SPARSE_STREAM_SKIP,
+	SPARSE_STREAM_DONE,
+	SPARSE_STREAM_ERROR,
+};
+
 static void default_log(const char *ignored, char *response) {}
 
-int write_sparse_image(struct sparse_storage *info,
-		       const char *part_name, void *data, char *response)
+static int sparse_stream_fail(struct sparse_stream *ss, const char *msg)
+{
+	ss->info->mssg(msg, ss->response);
+	ss->state = SPARSE_STREAM_ERROR;
+
+	return -1;
+}
+
+/*
+ * Gather the next want bytes of a header in ss->hdr, however the data is
+ * split. Returns true once they are all there.
+ */
+static bool sparse_stream_take(struct sparse_stream *ss, const u8 **data,
+			       size_t *len, uint want)
 {
+	uint n = min_t(size_t, want - ss->hdr_len, *len);
+
+	memcpy(ss->hdr.buf + ss->hdr_len, *data, n);
+	ss->hdr_len += n;
+	*data += n;
+	*len -= n;
+	if (ss->hdr_len < want)
+		return false;
+	ss->hdr_len = 0;
+
+	return true;
+}
+
+/* Skip the bytes left in the current chunk, then go on to the next one */
+static void sparse_stream_next(struct sparse_stream *ss, u64 skip)
+{
+	ss->left = skip;
+	if (ss->left || ss->extra)
+		ss->state = SPARSE_STREAM_SKIP;
+	else if (++ss->chunk == ss->file.total_chunks)
+		ss->state = SPARSE_STREAM_DONE;
+	else
+		ss->state = SPARSE_STREAM_CHUNK_HDR;
+}
+
+static int sparse_stream_check_size(struct sparse_stream *ss,
+				    lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
 	lbaint_t blk;
-	lbaint_t blkcnt;
+
+	/* Count the blocks that are held back to be merged */
+	blk = ss->blk + ss->buf_used / info->blksz + ss->zero_blks;
+	if (blk + blkcnt > info->start + info->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		return sparse_stream_fail(ss,
+			"Request would exceed partition size!");
+	}
+
+	return 0;
+}
+
+static int sparse_stream_write_blks(struct sparse_stream *ss,
+				    const void *buf, lbaint_t blkcnt)
+{
 	lbaint_t blks;
-	uint32_t bytes_written = 0;
-	unsigned int chunk;
-	unsigned int offset;
-	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
-	uint32_t fill_val;
-	sparse_header_t *sparse_header;
-	chunk_header_t *chunk_header;
-	uint32_t total_blocks = 0;
+
+	blks = ss->info->write(ss->info, ss->blk, blkcnt, buf);
+	/* blks might be > blkcnt (eg. NAND bad-blocks) */
+	if (blks < blkcnt) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n", __func__,
+		       "Write failed, block #", ss->blk, blks);
+		return sparse_stream_fail(ss, "flash write failure");
+	}
+	ss->blk += blks;
+	ss->bytes_written += blkcnt * ss->info->blksz;
+
+	return 0;
+}
+
+/* Write out the RAW data held in the staging buffer */
+static int sparse_stream_flush_raw(struct sparse_stream *ss)
+{
+	lbaint_t blkcnt = ss->buf_used / ss->info->blksz;
+	int ret;
+
+	if (!blkcnt)
+		return 0;
+	ret = sparse_stream_write_blks(ss, ss->buf, blkcnt);
+	ss->buf_used = 0;
+
+	return ret;
+}
+
+static int sparse_stream_fill(struct sparse_stream *ss, u32 fill_val,
+			      lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
 	int fill_buf_num_blks;
-	int i;
-	int j;
+	uint32_t *fill_buf;
+	lbaint_t i, j;
+	int ret = 0;
 
 	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	fill_buf = (uint32_t *)memalign(ARCH_DMA_MINALIGN,
+					ROUNDUP(info->blksz *
+						fill_buf_num_blks,
+						ARCH_DMA_MINALIGN));
+	if (!fill_buf)
+		return sparse_stream_fail(ss,
+					  "Malloc failed for: CHUNK_TYPE_FILL");
 
-	/* Read and skip over sparse image header */
-	sparse_header = (sparse_header_t *)data;
+	for (i = 0; i < (info->blksz * fill_buf_num_blks / sizeof(fill_val));
+	     i++)
+		fill_buf[i] = fill_val;
 
-	data += sparse_header->file_hdr_sz;
-	if (sparse_header->file_hdr_sz > sizeof(sparse_header_t)) {
-		/*
-		 * Skip the remaining bytes in a header that is longer than
-		 * we expected.
-		 */
-		data += (sparse_header->file_hdr_sz - sizeof(sparse_header_t));
+	for (i = 0; i < blkcnt && !ret; i += j) {
+		j = blkcnt - i;
+		if (j > fill_buf_num_blks)
+			j = fill_buf_num_blks;
+		ret = sparse_stream_write_blks(ss, fill_buf, j);
 	}
+	free(fill_buf);
 
-	if (!info->mssg)
-		info->mssg = default_log;
+	return ret;
+}
+
+/*
+ * Zero blocks by erasing the whole erase groups among them and writing the
+ * rest. The blocks the storage fails to erase are written too.
+ */
+static int sparse_stream_zero(struct sparse_stream *ss, lbaint_t blkcnt)
+{
+	struct sparse_storage *info = ss->info;
+	u32 grp = info->erase_grp ? info->erase_grp : 1;
+	lbaint_t head, blks;
+	u32 rem;
+	int ret;
+
+	div_u64_rem(ss->blk, grp, &rem);
+	head = min_t(lbaint_t, rem ? grp - rem : 0, blkcnt);
+	if (head) {
+		ret = sparse_stream_fill(ss, 0, head);
+		if (ret)
+			return ret;
+		blkcnt -= head;
+	}
+
+	div_u64_rem(blkcnt, grp, &rem);
+	if (blkcnt > rem) {
+		blks = info->erase(info, ss->blk, blkcnt - rem);
+		/* An error (e.g. -1) erased nothing, so all of it is written */
+		if (blks > blkcnt - rem)
+			blks = 0;
+		debug("%s: erased " LBAFU " of " LBAFU " blocks at " LBAFU "\n",
+		      __func__, blks, blkcnt - rem, ss->blk);
+		ss->blk += blks;
+		ss->bytes_written += blks * info->blksz;
+		blkcnt -= blks;
+	}
+
+	return blkcnt ? sparse_stream_fill(ss, 0, blkcnt) : 0;
+}
+
+/* Zero the blocks of the zero FILL chunks that are held back */
+static int sparse_stream_flush_zero(struct sparse_stream *ss)
+{
+	lbaint_t blkcnt = ss->zero_blks;
+
+	if (!blkcnt)
+		return 0;
+	ss->zero_blks = 0;
+
+	return sparse_stream_zero(ss, blkcnt);
+}
+
+/*
+ * Write out everything held back. Only one of RAW data and zero blocks is
+ * held at a time.
+ */
+static int sparse_stream_flush(struct sparse_stream *ss)
+{
+	int ret;
+
+	ret = sparse_stream_flush_raw(ss);
+	if (ret)
+		return ret;
+
+	return sparse_stream_flush_zero(ss);
+}
+
+/*
+ * Zero FILL chunks in a row are gathered into one run, which is erased
+ * when the storage can do that
+ */
+static int sparse_stream_fill_chunk(struct sparse_stream *ss, u32 fill_val,
+				    lbaint_t blkcnt)
+{
+	int ret;
+
+	if (!fill_val && ss->info->erase) {
+		ret = sparse_stream_flush_raw(ss);
+		ss->zero_blks += blkcnt;
+		return ret;
+	}
+	ret = sparse_stream_flush(ss);
+	if (ret)
+		return ret;
+
+	return sparse_stream_fill(ss, fill_val, blkcnt);
+}
+
+static int sparse_stream_file_hdr(struct sparse_stream *ss)
+{
+	sparse_header_t *sparse_header = &ss->hdr.file;
+	uint offset;
+
+	if (!is_sparse_image(sparse_header))
+		return sparse_stream_fail(ss, "not a sparse image");
+	ss->file = *sparse_header;
 
 	debug("=== Sparse Image Header ===\n");
 	debug("magic: 0x%x\n", sparse_header->magic);
@@ -92,170 +282,304 @@ int write_sparse_image(struct sparse_storage *info,
 	debug("total_blks: %d\n", sparse_header->total_blks);
 	debug("total_chunks: %d\n", sparse_header->total_chunks);
 
+	if (sparse_header->file_hdr_sz < sizeof(sparse_header_t) ||
+	    sparse_header->chunk_hdr_sz < sizeof(chunk_header_t))
+		return sparse_stream_fail(ss, "sparse image header size issue");
+
 	/*
 	 * Verify that the sparse block size is a multiple of our
 	 * storage backend block size
 	 */
-	div_u64_rem(sparse_header->blk_sz, info->blksz, &offset);
-	if (offset) {
+	div_u64_rem(sparse_header->blk_sz, ss->info->blksz, &offset);
+	if (!sparse_header->blk_sz || offset) {
 		printf("%s: Sparse image block size issue [%u]\n",
 		       __func__, sparse_header->blk_sz);
-		info->mssg("sparse image block size issue", response);
-		return -1;
+		return sparse_stream_fail(ss, "sparse image block size issue");
 	}
 
 	puts("Flashing Sparse Image\n");
 
-	/* Start processing chunks */
-	blk = info->start;
-	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
-		/* Read and skip over chunk header */
-		chunk_header = (chunk_header_t *)data;
-		data += sizeof(chunk_header_t);
-
-		if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
-			debug("=== Chunk Header ===\n");
-			debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
-			debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
-			debug("total_size: 0x%x\n", chunk_header->total_sz);
-		}
+	/*
+	 * Skip the remaining bytes in a header that is longer than we
+	 * expected.
+	 */
+	ss->chunk = -1;
+	sparse_stream_next(ss, sparse_header->file_hdr_sz -
+			   sizeof(sparse_header_t));
 
-		if (sparse_header->chunk_hdr_sz > sizeof(chunk_header_t)) {
-			/*
-			 * Skip the remaining bytes in a header that is longer
-			 * than we expected.
-			 */
-			data += (sparse_header->chunk_hdr_sz -
-				 sizeof(chunk_header_t));
-		}
+	return 0;
+}
 
-		chunk_data_sz = sparse_header->blk_sz * chunk_header->chunk_sz;
-		blkcnt = chunk_data_sz / info->blksz;
-		switch (chunk_header->chunk_type) {
-		case CHUNK_TYPE_RAW:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
-				info->mssg("Bogus chunk size for chunk type Raw",
-					   response);
-				return -1;
-			}
+static int sparse_stream_chunk_hdr(struct sparse_stream *ss)
+{
+	chunk_header_t *chunk_header = &ss->hdr.chunk;
+	sparse_header_t *sparse_header = &ss->file;
+	u64 chunk_data_sz;
+	lbaint_t blkcnt;
+	u32 data_sz;
+	int ret;
 
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				return -1;
-			}
+	if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
+		debug("=== Chunk Header ===\n");
+		debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
+		debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
+		debug("total_size: 0x%x\n", chunk_header->total_sz);
+	}
 
-			blks = info->write(info, blk, blkcnt, data);
-			/* blks might be > blkcnt (eg. NAND bad-blocks) */
-			if (blks < blkcnt) {
-				printf("%s: %s" LBAFU " [" LBAFU "]\n",
-				       __func__, "Write failed, block #",
-				       blk, blks);
-				info->mssg("flash write failure", response);
-				return -1;
-			}
-			blk += blks;
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
+	chunk_data_sz = (u64)sparse_header->blk_sz * chunk_header->chunk_sz;
+	blkcnt = chunk_data_sz / ss->info->blksz;
+	data_sz = chunk_header->total_sz - sparse_header->chunk_hdr_sz;
+
+	/* The rest of a header longer than we expected comes before the data */
+	ss->extra = sparse_header->chunk_hdr_sz - sizeof(chunk_header_t);
+
+	switch (chunk_header->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (chunk_header->total_sz < sparse_header->chunk_hdr_sz ||
+		    data_sz != chunk_data_sz)
+			return sparse_stream_fail(ss,
+				"Bogus chunk size for chunk type Raw");
+
+		ret = sparse_stream_check_size(ss, blkcnt);
+		if (!ret)
+			/* RAW data goes on from any staged by the last chunk */
+			ret = sparse_stream_flush_zero(ss);
+		if (ret)
+			return ret;
+		ss->total_blocks += chunk_header->chunk_sz;
+		if (!chunk_data_sz) {
+			sparse_stream_next(ss, 0);
 			break;
+		}
+		ss->left = chunk_data_sz;
+		ss->state = SPARSE_STREAM_RAW;
+		break;
 
-		case CHUNK_TYPE_FILL:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
-				info->mssg("Bogus chunk size for chunk type FILL", response);
-				return -1;
-			}
+	case CHUNK_TYPE_FILL:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + sizeof(uint32_t)))
+			return sparse_stream_fail(ss,
+				"Bogus chunk size for chunk type FILL");
 
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
-			}
+		ret = sparse_stream_check_size(ss, blkcnt);
+		if (ret)
+			return ret;
+		ss->left = blkcnt;
+		ss->total_blocks += chunk_header->chunk_sz;
+		ss->state = SPARSE_STREAM_FILL_VAL;
+		break;
 
-			fill_val = *(uint32_t *)data;
-			data = (char *)data + sizeof(uint32_t);
-
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				return -1;
-			}
+	case CHUNK_TYPE_DONT_CARE:
+		if (chunk_header->total_sz != sparse_header->chunk_hdr_sz)
+			return sparse_stream_fail(ss,
+				"Bogus chunk size for chunk type Dont Care");
+
+		ret = sparse_stream_flush(ss);
+		if (ret)
+			return ret;
+		ss->blk += ss->info->reserve(ss->info, ss->blk, blkcnt);
+		ss->total_blocks += chunk_header->chunk_sz;
+		sparse_stream_next(ss, 0);
+		break;
+
+	case CHUNK_TYPE_CRC32:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + sizeof(uint32_t)))
+			return sparse_stream_fail(ss,
+				"Bogus chunk size for chunk type CRC32");
+
+		ss->total_blocks += chunk_header->chunk_sz;
+		sparse_stream_next(ss, data_sz);
+		break;
+
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       chunk_header->chunk_type);
+		return sparse_stream_fail(ss, "Unknown chunk type");
+	}
+
+	return 0;
+}
+
+/* Consume RAW chunk data, writing it out in runs of whole blocks */
+static int sparse_stream_raw(struct sparse_stream *ss, const u8 **data,
+			     size_t *len)
+{
+	lbaint_t blksz = ss->info->blksz;
+	size_t n = min_t(u64, *len, ss->left);
+	int ret;
+
+	if (!ss->buf_used && n >= ss->buf_size && n >= blksz) {
+		/* Enough data at hand: write it where it is */
+		n -= n % blksz;
+		ret = sparse_stream_write_blks(ss, *data, n / blksz);
+		if (ret)
+			return ret;
+	} else {
+		n = min_t(size_t, n, ss->buf_size - ss->buf_used);
+		if (!n)
+			return sparse_stream_fail(ss,
+				"sparse image buffer too small");
+		memcpy(ss->buf + ss->buf_used, *data, n);
+		ss->buf_used += n;
+	}
+	*data += n;
+	*len -= n;
+	ss->left -= n;
+
+	if (ss->buf_used == ss->buf_size) {
+		ret = sparse_stream_flush_raw(ss);
+		if (ret)
+			return ret;
+	}
+	if (!ss->left)
+		sparse_stream_next(ss, 0);
+
+	return 0;
+}
+
+int sparse_stream_start(struct sparse_stream *ss,
+			struct sparse_storage *info, const char *part_name,
+			void *buf, size_t buf_size, char *response)
+{
+	if (!info->mssg)
+		info->mssg = default_log;
 
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
+	memset(ss, '\0', sizeof(*ss));
+	ss->info = info;
+	ss->part_name = part_name;
+	ss->response = response;
+	ss->buf = buf;
+	/* Only whole blocks are staged */
+	ss->buf_size = buf_size - buf_size % info->blksz;
+	ss->blk = info->start;
+	ss->state = SPARSE_STREAM_FILE_HDR;
+
+	return 0;
+}
+
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			size_t len)
+{
+	const u8 *p = data;
+	u64 n;
+	int ret = 0;
+
+	/* Nothing more is written once something went wrong */
+	if (ss->state == SPARSE_STREAM_ERROR)
+		return -1;
+
+	while (len && !ret) {
+		switch (ss->state) {
+		case SPARSE_STREAM_FILE_HDR:
+			if (sparse_stream_take(ss, &p, &len,
+					       sizeof(sparse_header_t)))
+				ret = sparse_stream_file_hdr(ss);
+			break;
+		case SPARSE_STREAM_CHUNK_HDR:
+			if (sparse_stream_take(ss, &p, &len,
+					       sizeof(chunk_header_t)))
+				ret = sparse_stream_chunk_hdr(ss);
+			break;
+		case SPARSE_STREAM_FILL_VAL:
+			/* The value comes after the rest of the header */
+			if (ss->extra) {
+				n = min_t(u64, len, ss->extra);
+				ss->extra -= n;
+				p += n;
+				len -= n;
+			} else if (sparse_stream_take(ss, &p, &len,
+						      sizeof(uint32_t))) {
+				ret = sparse_stream_fill_chunk(ss,
+							       ss->hdr.fill_val,
+							       ss->left);
+				/* A failure must stay latched in ss->state */
+				if (!ret)
+					sparse_stream_next(ss, 0);
 			}
-			bytes_written += blkcnt * info->blksz;
-			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
 			break;
-
-		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
-			total_blocks += chunk_header->chunk_sz;
+		case SPARSE_STREAM_RAW:
+			if (ss->extra) {
+				n = min_t(u64, len, ss->extra);
+				ss->extra -= n;
+				p += n;
+				len -= n;
+			} else {
+				ret = sparse_stream_raw(ss, &p, &len);
+			}
 			break;
-
-		case CHUNK_TYPE_CRC32:
-			if (chunk_header->total_sz !=
-			    sparse_header->chunk_hdr_sz) {
-				info->mssg("Bogus chunk size for chunk type Dont Care",
-					   response);
-				return -1;
+		case SPARSE_STREAM_SKIP:
+			n = min_t(u64, len, ss->left + ss->extra);
+			if (n > ss->extra) {
+				ss->left -= n - ss->extra;
+				ss->extra = 0;
+			} else {
+				ss->extra -= n;
 			}
-			total_blocks += chunk_header->chunk_sz;
-			data += chunk_data_sz;
+			p += n;
+			len -= n;
+			sparse_stream_next(ss, ss->left);
 			break;
-
+		case SPARSE_STREAM_DONE:
+			/* Anything after the last chunk is ignored */
+			return 0;
 		default:
-			printf("%s: Unknown chunk type: %x\n", __func__,
-			       chunk_header->chunk_type);
-			info->mssg("Unknown chunk type", response);
 			return -1;
 		}
 	}
 
-	debug("Wrote %d blocks, expected to write %d blocks\n",
-	      total_blocks, sparse_header->total_blks);
-	printf("........ wrote %u bytes to '%s'\n", bytes_written, part_name);
+	return ret;
+}
+
+int sparse_stream_finish(struct sparse_stream *ss)
+{
+	struct sparse_storage *info = ss->info;
+
+	if (ss->state == SPARSE_STREAM_ERROR)
+		return -1;
+	if (ss->state != SPARSE_STREAM_DONE) {
+		info->mssg("sparse image truncated", ss->response);
+		ss->state = SPARSE_STREAM_ERROR;
+		return -1;
+	}
+	if (sparse_stream_flush(ss))
+		return -1;
+
+	debug("Wrote %llu blocks, expected to write %d blocks\n",
+	      ss->total_blocks, ss->file.total_blks);
+	printf("........ wrote %llu bytes to '%s'\n", ss->bytes_written,
+	       ss->part_name);
 
-	if (total_blocks != sparse_header->total_blks) {
-		info->mssg("sparse image write failure", response);
+	if (ss->total_blocks != ss->file.total_blks) {
+		info->mssg("sparse image write failure", ss->response);
 		return -1;
 	}
 
 	return 0;
 }
+
+int write_sparse_image(struct sparse_storage *info,
+		       const char *part_name, void *data, char *response)
+{
+	struct sparse_stream ss;
+	size_t size = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE;
+	void *buf;
+	int ret;
+
+	/*
+	 * The whole image is in memory, so RAW chunks at least as large as
+	 * the buffer are written from where they are. Smaller ones are
+	 * gathered into large writes, or written one by one if there is no
+	 * memory for that. The chunks give the length of the image.
+	 */
+	buf = memalign(ARCH_DMA_MINALIGN, size);
+	if (!buf)
+		size = 0;
+	sparse_stream_start(&ss, info, part_name, buf, size, response);
+	ret = sparse_stream_write(&ss, data, SIZE_MAX - (uintptr_t)data);
+	if (!ret)
+		ret = sparse_stream_finish(&ss);
+	free(buf);
+
+	return ret;
+}
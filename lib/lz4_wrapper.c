@@ -135,3 +135,19 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	*dstn = out - dst;
 	return ret;
 }
+
+int ulz4_block(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	int ret;
+
+	/* constant folding essential, do not touch params! */
+	ret = LZ4_decompress_generic(src, dst, srcn, *dstn, endOnInputSize,
+				     full, 0, noDict, dst, NULL, 0);
+	if (ret < 0) {
+		*dstn = 0;
+		return -EPROTO;		/* decompression error */
+	}
+
+	*dstn = ret;
+	return 0;
+}
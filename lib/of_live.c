@@ -15,6 +15,28 @@
 #include <dm/of_access.h>
 #include <linux/err.h>
 
+/**
+ * struct of_live_hdr - Header at the start of a live tree image
+ *
+ * The nodes and properties follow the header in the same block of memory.
+ * Apart from pointers into the flat tree, which of_live_relocate() adjusts,
+ * all pointers in the image point within it. The strings here are used in
+ * place of string constants, which would move when U-Boot relocates.
+ *
+ * @fdt: Flat tree which the image's property names and values point into
+ * @fdt_size: Size of @fdt in bytes
+ * @root: Root node of the tree
+ * @null_str: Name and type of nodes which do not have them
+ * @name_str: Name of the "name" properties added to nodes
+ */
+struct of_live_hdr {
+	const void *fdt;
+	ulong fdt_size;
+	struct device_node *root;
+	char null_str[8];
+	char name_str[8];
+};
+
 static void *unflatten_dt_alloc(void **mem, unsigned long size,
 				unsigned long align)
 {
@@ -35,13 +57,15 @@ static void *unflatten_dt_alloc(void **mem, unsigned long size,
  * @dad: Parent struct device_node
  * @nodepp: The device_node tree created by the call
  * @fpsize: Size of the node path up at t05he current depth.
- * @dryrun: If true, do not allocate device nodes but still calculate needed
- * memory size
+ * @depthp: Depth of the flat tree walk, updated as it goes
+ * @hdr: Header of the image being built, or NULL to not allocate device nodes
+ * but still calculate needed memory size
  */
 static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 			       struct device_node *dad,
 			       struct device_node **nodepp,
-			       unsigned long fpsize, bool dryrun)
+			       unsigned long fpsize, int *depthp,
+			       struct of_live_hdr *hdr)
 {
 	const __be32 *p;
 	struct device_node *np;
@@ -49,7 +73,7 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 	const char *pathp;
 	int l;
 	unsigned int allocl;
-	static int depth;
+	bool dryrun = !hdr;
 	int old_depth;
 	int offset;
 	int has_name = 0;
@@ -163,6 +187,7 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 			pp->name = (char *)pname;
 			pp->length = sz;
 			pp->value = (__be32 *)p;
+			of_prop_add_hash(np, pp);
 			*prev_pp = pp;
 			prev_pp = &pp->next;
 		}
@@ -188,9 +213,10 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		pp = unflatten_dt_alloc(&mem, sizeof(struct property) + sz,
 					__alignof__(struct property));
 		if (!dryrun) {
-			pp->name = "name";
+			pp->name = hdr->name_str;
 			pp->length = sz;
 			pp->value = pp + 1;
+			of_prop_add_hash(np, pp);
 			*prev_pp = pp;
 			prev_pp = &pp->next;
 			memcpy(pp->value, ps, sz - 1);
@@ -205,17 +231,18 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		np->type = of_get_property(np, "device_type", NULL);
 
 		if (!np->name)
-			np->name = "<NULL>";
+			np->name = hdr->null_str;
 		if (!np->type)
-			np->type = "<NULL>";	}
+			np->type = hdr->null_str;
+	}
 
-	old_depth = depth;
-	*poffset = fdt_next_node(blob, *poffset, &depth);
-	if (depth < 0)
-		depth = 0;
-	while (*poffset > 0 && depth > old_depth) {
+	old_depth = *depthp;
+	*poffset = fdt_next_node(blob, *poffset, depthp);
+	if (*depthp < 0)
+		*depthp = 0;
+	while (*poffset > 0 && *depthp > old_depth) {
 		mem = unflatten_dt_node(blob, mem, poffset, np, NULL,
-					fpsize, dryrun);
+					fpsize, depthp, hdr);
 		if (!mem)
 			return NULL;
 	}
@@ -247,83 +274,133 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 	return mem;
 }
 
-/**
- * unflatten_device_tree() - create tree of device_nodes from flat blob
- *
- * unflattens a device-tree, creating the
- * tree of struct device_node. It also fills the "name" and "type"
- * pointers of the nodes so the normal device-tree walking functions
- * can be used.
- * @blob: The blob to expand
- * @mynodes: The device_node tree created by the call
- * @return 0 if OK, -ve on error
- */
-static int unflatten_device_tree(const void *blob,
-				 struct device_node **mynodes)
+int of_live_size(const void *fdt_blob, ulong *sizep)
 {
-	unsigned long size;
-	int start;
+	int start = 0;
+	int depth = 0;
 	void *mem;
 
-	debug(" -> unflatten_device_tree()\n");
-
-	if (!blob) {
+	if (!fdt_blob) {
 		debug("No device tree pointer\n");
 		return -EINVAL;
 	}
 
-	debug("Unflattening device tree:\n");
-	debug("magic: %08x\n", fdt_magic(blob));
-	debug("size: %08x\n", fdt_totalsize(blob));
-	debug("version: %08x\n", fdt_version(blob));
+	debug("magic: %08x\n", fdt_magic(fdt_blob));
+	debug("size: %08x\n", fdt_totalsize(fdt_blob));
+	debug("version: %08x\n", fdt_version(fdt_blob));
 
-	if (fdt_check_header(blob)) {
+	if (fdt_check_header(fdt_blob)) {
 		debug("Invalid device tree blob header\n");
 		return -EINVAL;
 	}
 
-	/* First pass, scan for size */
-	start = 0;
-	size = (unsigned long)unflatten_dt_node(blob, NULL, &start, NULL, NULL,
-						0, true);
-	if (!size)
+	mem = unflatten_dt_node(fdt_blob, (void *)sizeof(struct of_live_hdr),
+				&start, NULL, NULL, 0, &depth, NULL);
+	if (!mem)
 		return -EFAULT;
-	size = ALIGN(size, 4);
 
-	debug("  size is %lx, allocating...\n", size);
+	/* Leave room for an end-of-tree marker */
+	*sizep = ALIGN((ulong)mem, 4) + 4;
 
-	/* Allocate memory for the expanded device tree */
-	mem = malloc(size + 4);
-	memset(mem, '\0', size);
+	return 0;
+}
 
-	*(__be32 *)(mem + size) = cpu_to_be32(0xdeadbeef);
+int of_live_build_image(const void *fdt_blob, void *buf, ulong size)
+{
+	struct of_live_hdr *hdr = buf;
+	ulong need;
+	int start = 0;
+	int depth = 0;
+	int ret;
 
-	debug("  unflattening %p...\n", mem);
+	ret = of_live_size(fdt_blob, &need);
+	if (ret)
+		return ret;
+	if (need > size) {
+		debug("Need %lx bytes for live tree, have %lx\n", need, size);
+		return -ENOSPC;
+	}
 
-	/* Second pass, do actual unflattening */
-	start = 0;
-	unflatten_dt_node(blob, mem, &start, NULL, mynodes, 0, false);
-	if (be32_to_cpup(mem + size) != 0xdeadbeef) {
+	debug("  unflattening %p...\n", buf);
+	memset(buf, '\0', need);
+	hdr->fdt = fdt_blob;
+	hdr->fdt_size = fdt_totalsize(fdt_blob);
+	strcpy(hdr->null_str, "<NULL>");
+	strcpy(hdr->name_str, "name");
+	*(__be32 *)(buf + need - 4) = cpu_to_be32(0xdeadbeef);
+
+	unflatten_dt_node(fdt_blob, hdr + 1, &start, NULL, &hdr->root, 0,
+			  &depth, hdr);
+	if (be32_to_cpup(buf + need - 4) != 0xdeadbeef) {
 		debug("End of tree marker overwritten: %08x\n",
-		      be32_to_cpup(mem + size));
+		      be32_to_cpup(buf + need - 4));
 		return -ENOSPC;
 	}
 
-	debug(" <- unflatten_device_tree()\n");
-
 	return 0;
 }
 
+static void of_live_reloc_ptr(void *ptrp, const struct of_live_hdr *hdr,
+			      long delta)
+{
+	const void **ptr = ptrp;
+
+	if (*ptr >= hdr->fdt && *ptr < hdr->fdt + hdr->fdt_size)
+		*ptr += delta;
+}
+
+static void of_live_reloc_node(struct device_node *np,
+			       const struct of_live_hdr *hdr, long delta)
+{
+	struct device_node *child;
+	struct property *pp;
+
+	of_live_reloc_ptr(&np->name, hdr, delta);
+	of_live_reloc_ptr(&np->type, hdr, delta);
+	for (pp = np->properties; pp; pp = pp->next) {
+		of_live_reloc_ptr(&pp->name, hdr, delta);
+		of_live_reloc_ptr(&pp->value, hdr, delta);
+	}
+	for (child = np->child; child; child = child->sibling)
+		of_live_reloc_node(child, hdr, delta);
+}
+
+struct device_node *of_live_relocate(void *buf, const void *fdt_blob)
+{
+	struct of_live_hdr *hdr = buf;
+
+	if (hdr->fdt != fdt_blob) {
+		debug("%s: flat tree moved from %p to %p\n", __func__,
+		      hdr->fdt, fdt_blob);
+		of_live_reloc_node(hdr->root, hdr, fdt_blob - hdr->fdt);
+		hdr->fdt = fdt_blob;
+	}
+
+	return hdr->root;
+}
+
 int of_live_build(const void *fdt_blob, struct device_node **rootp)
 {
+	ulong size;
+	void *buf;
 	int ret;
 
 	debug("%s: start\n", __func__);
-	ret = unflatten_device_tree(fdt_blob, rootp);
+	ret = of_live_size(fdt_blob, &size);
+	if (ret)
+		goto err;
+	debug("  size is %lx, allocating...\n", size);
+	buf = malloc(size);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	ret = of_live_build_image(fdt_blob, buf, size);
 	if (ret) {
-		debug("Failed to create live tree: err=%d\n", ret);
-		return ret;
+		free(buf);
+		goto err;
 	}
+	*rootp = of_live_relocate(buf, fdt_blob);
 	ret = of_alias_scan();
 	if (ret) {
 		debug("Failed to scan live tree aliases: err=%d\n", ret);
@@ -331,5 +408,8 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 	}
 	debug("%s: stop\n", __func__);
 
+	return ret;
+err:
+	debug("Failed to create live tree: err=%d\n", ret);
 	return ret;
 }
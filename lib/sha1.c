@@ -65,7 +65,7 @@ void sha1_starts (sha1_context * ctx)
 	ctx->state[4] = 0xC3D2E1F0;
 }
 
-static void sha1_process(sha1_context *ctx, const unsigned char data[64])
+static void sha1_process_one(sha1_context *ctx, const unsigned char data[64])
 {
 	unsigned long temp, W[16], A, B, C, D, E;
 
@@ -219,6 +219,19 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 	ctx->state[4] += E;
 }
 
+static void sha1_process(sha1_context *ctx, const unsigned char *data,
+			 unsigned int blocks)
+{
+#if defined(CONFIG_ARMV8_CE_SHA1) && !defined(USE_HOSTCC)
+	if (!sha1_armv8_ce_process(ctx->state, data, blocks))
+		return;
+#endif
+	while (blocks--) {
+		sha1_process_one(ctx, data);
+		data += 64;
+	}
+}
+
 /*
  * SHA-1 process buffer
  */
@@ -242,16 +255,16 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 
 	if (left && ilen >= fill) {
 		memcpy ((void *) (ctx->buffer + left), (void *) input, fill);
-		sha1_process (ctx, ctx->buffer);
+		sha1_process(ctx, ctx->buffer, 1);
 		input += fill;
 		ilen -= fill;
 		left = 0;
 	}
 
-	while (ilen >= 64) {
-		sha1_process (ctx, input);
-		input += 64;
-		ilen -= 64;
+	if (ilen >= 64) {
+		sha1_process(ctx, input, ilen / 64);
+		input += ilen & ~0x3F;
+		ilen &= 0x3F;
 	}
 
 	if (ilen > 0) {
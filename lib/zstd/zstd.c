@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Buffer to buffer Zstandard decompression
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/zstd.h>
+
+int zstd_decompress_buf(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	ZSTD_DCtx *dctx;
+	void *workspace;
+	size_t wsize, ret;
+
+	/* The output buffer holds the history, so no window is allocated */
+	wsize = ZSTD_DCtxWorkspaceBound();
+	workspace = malloc(wsize);
+	if (!workspace) {
+		debug("%s: cannot allocate workspace of size %zu\n", __func__,
+		      wsize);
+		return -ENOMEM;
+	}
+
+	dctx = ZSTD_initDCtx(workspace, wsize);
+	if (!dctx) {
+		free(workspace);
+		return -EINVAL;
+	}
+
+	ret = ZSTD_decompressDCtx(dctx, dst, *dstn, src, srcn);
+	free(workspace);
+	if (ZSTD_isError(ret)) {
+		debug("%s: error %d\n", __func__, ZSTD_getErrorCode(ret));
+		switch (ZSTD_getErrorCode(ret)) {
+		case ZSTD_error_dstSize_tooSmall:
+			return -ENOSPC;
+		case ZSTD_error_memory_allocation:
+			return -ENOMEM;
+		default:
+			return -EINVAL;
+		}
+	}
+	*dstn = ret;
+
+	return 0;
+}
@@ -20,9 +20,15 @@ DECLARE_GLOBAL_DATA_PTR;
  * struct eth_device_priv - private structure for each Ethernet device
  *
  * @state: The state of the Ethernet MAC driver (defined by enum eth_state_t)
+ * @rx_split: Payload slots handed to the driver by eth_set_rx_split()
+ * @rx_split_active: true if the driver accepted @rx_split
+ * @rx_payload: Payload location of the frame being processed, if split
  */
 struct eth_device_priv {
 	enum eth_state_t state;
+	struct eth_rx_split rx_split;
+	bool rx_split_active;
+	uchar *rx_payload;
 };
 
 /**
@@ -311,6 +317,7 @@ void eth_halt(void)
 	if (!current || !eth_is_active(current))
 		return;
 
+	eth_set_rx_split(NULL);
 	eth_get_ops(current)->stop(current);
 	priv = current->uclass_priv;
 	if (priv)
@@ -352,9 +359,94 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+int eth_set_rx_split(const struct eth_rx_split *split)
+{
+	struct udevice *current;
+	struct eth_device_priv *priv;
+	int ret;
+
+	current = eth_get_dev();
+	if (!current)
+		return -ENODEV;
+
+	if (!eth_is_active(current))
+		return -EINVAL;
+
+	priv = dev_get_uclass_priv(current);
+	if (!eth_get_ops(current)->set_rx_split)
+		return split ? -ENOSYS : 0;
+	if (!split && !priv->rx_split_active)
+		return 0;
+
+	ret = eth_get_ops(current)->set_rx_split(current, split);
+	if (ret) {
+		debug("%s: set_rx_split() returned error %d\n", __func__, ret);
+		split = NULL;
+	}
+	priv->rx_split_active = split != NULL;
+	if (split)
+		priv->rx_split = *split;
+
+	return ret;
+}
+
+uchar *eth_get_rx_payload(void)
+{
+	struct udevice *current = eth_get_dev();
+	struct eth_device_priv *priv;
+
+	if (!current)
+		return NULL;
+	priv = dev_get_uclass_priv(current);
+
+	return priv ? priv->rx_payload : NULL;
+}
+
+void eth_rx_set_payload(struct udevice *dev, uchar *payload)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	priv->rx_payload = payload;
+}
+
+/*
+ * Put a split frame back together unless it is exactly what the caller of
+ * eth_set_rx_split() asked for: an unfragmented UDP datagram for the
+ * expected port whose headers are all in the packet buffer. Anything else
+ * (ARP, ICMP, other UDP ports, packet capture...) expects a contiguous frame.
+ */
+static void eth_rx_join_split(struct eth_device_priv *priv, uchar *packet,
+			      int len)
+{
+	struct ethernet_hdr *et = (struct ethernet_hdr *)packet;
+	struct ip_udp_hdr *ip = (struct ip_udp_hdr *)(packet + ETHER_HDR_SIZE);
+	int hdr_len = priv->rx_split.hdr_len;
+	bool keep;
+
+	keep = hdr_len >= ETHER_HDR_SIZE + IP_UDP_HDR_SIZE &&
+	       ntohs(et->et_protlen) == PROT_IP &&
+	       ip->ip_hl_v == 0x45 &&
+	       !(ntohs(ip->ip_off) & (IP_OFFS | IP_FLAGS_MFRAG)) &&
+	       ip->ip_p == IPPROTO_UDP &&
+	       ntohs(ip->udp_dst) == priv->rx_split.udp_dport &&
+	       !IS_ENABLED(CONFIG_UDP_CHECKSUM);
+#if defined(CONFIG_CMD_PCAP)
+	keep = keep && !pcap_active();
+#endif
+#if defined(CONFIG_API) || defined(CONFIG_EFI_LOADER)
+	keep = keep && !push_packet;
+#endif
+	if (keep)
+		return;
+
+	memcpy(packet + hdr_len, priv->rx_payload, len - hdr_len);
+	priv->rx_payload = NULL;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
+	struct eth_device_priv *priv;
 	uchar *packet;
 	int flags;
 	int ret;
@@ -367,18 +459,25 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
+	priv = dev_get_uclass_priv(current);
+
 	/* Process up to 32 packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
 	for (i = 0; i < 32; i++) {
+		priv->rx_payload = NULL;
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
-		if (ret > 0)
+		if (ret > 0) {
+			if (priv->rx_payload)
+				eth_rx_join_split(priv, packet, ret);
 			net_process_received_packet(packet, ret);
+		}
 		if (ret >= 0 && eth_get_ops(current)->free_pkt)
 			eth_get_ops(current)->free_pkt(current, packet, ret);
 		if (ret <= 0)
 			break;
 	}
+	priv->rx_payload = NULL;
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
@@ -507,6 +606,8 @@ static int eth_post_probe(struct udevice *dev)
 			ops->write_hwaddr += gd->reloc_off;
 		if (ops->read_rom_hwaddr)
 			ops->read_rom_hwaddr += gd->reloc_off;
+		if (ops->set_rx_split)
+			ops->set_rx_split += gd->reloc_off;
 
 		reloc_done++;
 	}
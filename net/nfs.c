@@ -28,6 +28,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <env.h>
 #include <net.h>
 #include <malloc.h>
 #include <mapmem.h>
@@ -35,6 +36,9 @@
 #include "bootp.h"
 
 #define HASHES_PER_LINE 65	/* Number of "loading" hashes per line	*/
+#define HASH_BYTES	((NFS_READ_SIZE / 2) * 10)	/* Bytes per hash */
+/* Part of a READ reply up to the data, for the largest attributes */
+#define NFS_READ_HDR_SIZE	((6 + NFS_MAX_ATTRS) * sizeof(uint32_t))
 #define NFS_RETRY_COUNT 30
 #ifndef CONFIG_NFS_TIMEOUT
 # define NFS_TIMEOUT 2000UL
@@ -47,10 +51,26 @@
 
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
 static ulong nfs_timeout = NFS_TIMEOUT;
 
+/*
+ * READ requests in flight. Each reply is matched to its request by XID and
+ * stored at the offset of that request, so replies may arrive in any order.
+ */
+struct nfs_read {
+	unsigned long id;	/* XID of the last request sent, 0 if idle */
+	u32 offset;
+	u32 len;
+};
+
+static struct nfs_read nfs_reads[NFS_WINDOW_MAX];
+static int nfs_window_size = CONFIG_NFS_WINDOWSIZE;
+static int nfs_read_size = NFS_READ_SIZE;
+static u32 nfs_read_next;	/* offset of the next READ to issue */
+static u32 nfs_file_size;	/* size of the file once EOF was seen */
+static u32 nfs_read_bytes;	/* bytes received so far */
+static u32 nfs_num_hash;	/* hashes printed so far */
+
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
 static char filefh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle */
 static int filefh3_length;	/* (variable) length of filefh when NFSv3 */
@@ -170,7 +190,8 @@ static uint32_t *rpc_add_credentials(uint32_t *p)
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
-static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+static unsigned long rpc_req(int rpc_prog, int rpc_proc, uint32_t *data,
+			     int datalen)
 {
 	struct rpc_t rpc_pkt;
 	unsigned long id;
@@ -215,6 +236,8 @@ static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
 
 	net_send_udp_packet(net_server_ethaddr, nfs_server_ip, sport,
 			    nfs_our_port, pktlen);
+
+	return id;
 }
 
 /**************************************************************************
@@ -356,7 +379,7 @@ static void nfs_lookup_req(char *fname)
 /**************************************************************************
 NFS_READ - Read File on NFS Server
 **************************************************************************/
-static void nfs_read_req(int offset, int readlen)
+static unsigned long nfs_read_req(u32 offset, u32 readlen)
 {
 	uint32_t data[1024];
 	uint32_t *p;
@@ -383,7 +406,45 @@ static void nfs_read_req(int offset, int readlen)
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
-	rpc_req(PROG_NFS, NFS_READ, data, len);
+	return rpc_req(PROG_NFS, NFS_READ, data, len);
+}
+
+/* Issue READs for the following parts of the file until the window is full */
+static void nfs_read_fill(void)
+{
+	struct nfs_read *rd;
+
+	for (rd = nfs_reads; rd < nfs_reads + nfs_window_size; rd++) {
+		if (rd->id)
+			continue;
+		if (nfs_read_next >= nfs_file_size)
+			break;
+		rd->offset = nfs_read_next;
+		rd->len = nfs_read_size;
+		nfs_read_next += nfs_read_size;
+		rd->id = nfs_read_req(rd->offset, rd->len);
+	}
+}
+
+/* Send all READs in flight again */
+static void nfs_read_resend(void)
+{
+	struct nfs_read *rd;
+
+	for (rd = nfs_reads; rd < nfs_reads + nfs_window_size; rd++) {
+		if (rd->id)
+			rd->id = nfs_read_req(rd->offset, rd->len);
+	}
+}
+
+static void nfs_read_start(void)
+{
+	memset(nfs_reads, 0, sizeof(nfs_reads));
+	nfs_read_next = 0;
+	nfs_file_size = ~0U;
+	nfs_read_bytes = 0;
+	nfs_num_hash = 0;
+	nfs_read_fill();
 }
 
 /**************************************************************************
@@ -416,7 +477,7 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_resend();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
@@ -659,20 +720,31 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
-static int nfs_read_reply(uchar *pkt, unsigned len)
+static int nfs_read_reply(uchar *pkt, unsigned len, struct nfs_read **rdp,
+			  bool *eof)
 {
 	struct rpc_t rpc_pkt;
+	struct nfs_read *rd;
+	unsigned long id;
 	int rlen;
+	int data_offset;
 	uchar *data_ptr;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	/* Only copy the header; the data is stored straight from the packet */
+	memset(&rpc_pkt.u.reply, 0, NFS_READ_HDR_SIZE);
+	memcpy(&rpc_pkt.u.data[0], pkt,
+	       min_t(unsigned int, len, NFS_READ_HDR_SIZE));
 
-	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
-		return -NFS_RPC_ERR;
-	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
+	id = ntohl(rpc_pkt.u.reply.id);
+	for (rd = nfs_reads; rd < nfs_reads + nfs_window_size; rd++) {
+		if (id && rd->id == id)
+			break;
+	}
+	if (rd == nfs_reads + nfs_window_size)
 		return -NFS_RPC_DROP;
+	*rdp = rd;
 
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
@@ -685,38 +757,76 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
-		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		data_offset = 19;
+		/* NFSv2 only returns less than requested at the end */
+		*eof = rlen < rd->len;
 	} else {  /* NFSV3_FLAG */
 		int nfsv3_data_offset =
 			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
 
 		/* count value */
 		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+		*eof = !!rpc_pkt.u.reply.data[2 + nfsv3_data_offset];
 		/* Skip unused values :
-			EOF:		32 bits value,
 			data_size:	32 bits value,
 		*/
-		data_ptr = (uchar *)
-			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
+		data_offset = 4 + nfsv3_data_offset;
 	}
+	data_ptr = pkt + ((uchar *)&rpc_pkt.u.reply.data[data_offset] -
+			  (uchar *)&rpc_pkt);
 
-	if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + rlen) > len)
-			return -9999;
+	if (rlen < 0 || rlen > rd->len || data_ptr + rlen > pkt + len)
+		return -9999;
 
-	if (store_block(data_ptr, nfs_offset, rlen))
-			return -9999;
+	if (store_block(data_ptr, rd->offset, rlen))
+		return -9999;
 
 	return rlen;
 }
 
+/* Account for a READ reply and keep the window full */
+static void nfs_read_done(struct nfs_read *rd, int rlen, bool eof)
+{
+	struct nfs_read *r;
+	bool busy = false;
+
+	nfs_read_bytes += rlen;
+	while (nfs_read_bytes / HASH_BYTES > nfs_num_hash) {
+		putc('#');
+		if (!(++nfs_num_hash % HASHES_PER_LINE))
+			puts("\n\t ");
+	}
+
+	if ((eof || !rlen) && rd->offset + rlen < nfs_file_size) {
+		nfs_file_size = rd->offset + rlen;
+		/* Forget about requests beyond the end of the file */
+		for (r = nfs_reads; r < nfs_reads + nfs_window_size; r++) {
+			if (r->offset >= nfs_file_size)
+				r->id = 0;
+		}
+	}
+
+	rd->offset += rlen;
+	rd->len -= rlen;
+	if (rd->len && rd->offset < nfs_file_size)
+		/* Short read before the end of the file: ask for the rest */
+		rd->id = nfs_read_req(rd->offset, rd->len);
+	else
+		rd->id = 0;
+
+	nfs_read_fill();
+
+	for (r = nfs_reads; r < nfs_reads + nfs_window_size; r++)
+		busy |= !!r->id;
+	if (!busy) {
+		nfs_download_state = NETLOOP_SUCCESS;
+		nfs_state = STATE_UMOUNT_REQ;
+		nfs_send();
+	}
+}
+
 /**************************************************************************
 Interfaces of U-BOOT
 **************************************************************************/
@@ -737,6 +847,8 @@ static void nfs_timeout_handler(void)
 static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			unsigned src, unsigned len)
 {
+	struct nfs_read *rd;
+	bool eof;
 	int rlen;
 	int reply;
 
@@ -809,9 +921,7 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_send();
 		} else {
 			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			nfs_read_start();
 		}
 		break;
 
@@ -834,22 +944,18 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		break;
 
 	case STATE_READ_REQ:
-		rlen = nfs_read_reply(pkt, len);
+		rlen = nfs_read_reply(pkt, len, &rd, &eof);
 		if (rlen == -NFS_RPC_DROP)
 			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
-			nfs_send();
+		if (rlen >= 0) {
+			nfs_read_done(rd, rlen, eof);
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
+			debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		}
@@ -860,9 +966,32 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 void nfs_start(void)
 {
+	char *ep;
+
 	debug("%s\n", __func__);
 	nfs_download_state = NETLOOP_FAIL;
 
+	/* Allow the user to choose the READ size and the number in flight */
+	nfs_read_size = NFS_READ_SIZE;
+	ep = env_get("nfsreadsize");
+	if (ep != NULL)
+		nfs_read_size = simple_strtol(ep, NULL, 10);
+	if (nfs_read_size < 512 || nfs_read_size > NFS_READ_SIZE_MAX) {
+		printf("NFS read size must be between 512 and %d\n",
+		       NFS_READ_SIZE_MAX);
+		nfs_read_size = NFS_READ_SIZE;
+	}
+
+	nfs_window_size = CONFIG_NFS_WINDOWSIZE;
+	ep = env_get("nfswindowsize");
+	if (ep != NULL)
+		nfs_window_size = simple_strtol(ep, NULL, 10);
+	if (nfs_window_size < 1 || nfs_window_size > NFS_WINDOW_MAX) {
+		printf("NFS window size must be between 1 and %d\n",
+		       NFS_WINDOW_MAX);
+		nfs_window_size = CONFIG_NFS_WINDOWSIZE;
+	}
+
 	nfs_server_ip = net_server_ip;
 	nfs_path = (char *)nfs_path_buff;
 
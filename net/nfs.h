@@ -44,6 +44,20 @@
 #define NFS_READ_SIZE	1024	/* biggest power of two that fits Ether frame */
 #define NFS_MAX_ATTRS	26
 
+/*
+ * Largest block size that can be selected with the "nfsreadsize" environment
+ * variable. Bigger replies than the default are fragmented, so this needs
+ * CONFIG_IP_DEFRAG. 8192 is also the limit of NFSv2.
+ */
+#ifdef CONFIG_IP_DEFRAG
+#define NFS_READ_SIZE_MAX	8192
+#else
+#define NFS_READ_SIZE_MAX	NFS_READ_SIZE
+#endif
+
+/* Maximum number of READ requests in flight */
+#define NFS_WINDOW_MAX	16
+
 /* Values for Accept State flag on RPC answers (See: rfc1831) */
 enum rpc_accept_stat {
 	NFS_RPC_SUCCESS = 0,	/* RPC executed successfully */
@@ -56,7 +70,7 @@ enum rpc_accept_stat {
 
 struct rpc_t {
 	union {
-		uint8_t data[NFS_READ_SIZE + (6 + NFS_MAX_ATTRS) *
+		uint8_t data[NFS_READ_SIZE_MAX + (6 + NFS_MAX_ATTRS) *
 			sizeof(uint32_t)];
 		struct {
 			uint32_t id;
@@ -74,7 +88,7 @@ struct rpc_t {
 			uint32_t verifier;
 			uint32_t v2;
 			uint32_t astatus;
-			uint32_t data[NFS_READ_SIZE / sizeof(uint32_t) +
+			uint32_t data[NFS_READ_SIZE_MAX / sizeof(uint32_t) +
 				NFS_MAX_ATTRS];
 		} reply;
 	} u;
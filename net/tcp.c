@@ -0,0 +1,668 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP client
+ *
+ * This supports a single, actively opened connection, which is all that is
+ * needed to download a file. Received data is handed to the user of the
+ * connection together with its offset in the byte stream, so it can be
+ * stored at its final location straight away even when segments arrive out
+ * of order. We therefore never buffer received data ourselves and can offer
+ * the peer a full 64KiB receive window.
+ *
+ * Out-of-order segments are remembered as a short list of sequence ranges
+ * and answered with an immediate duplicate ACK, which lets the sender detect
+ * the loss and retransmit the missing segment without waiting for its
+ * retransmission timer (RFC 5681 fast retransmit, no SACK needed). In-order
+ * data is acknowledged for every second full-sized segment or after a short
+ * delay (RFC 1122 delayed ACK).
+ */
+
+#include <common.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <asm/unaligned.h>
+
+/* Initial retransmission timeout, doubled on every retry (RFC 6298) */
+#define TCP_RTO_MS		1000UL
+#define TCP_RTO_MAX_MS		16000UL
+#define TCP_RETRIES		6
+/* Delayed ACK timeout; RFC 1122 requires less than 500ms */
+#define TCP_DELACK_MS		40UL
+/* Give up if the peer has been silent for this long */
+#define TCP_IDLE_MS		30000UL
+/* Receive window we advertise */
+#define TCP_RCV_WND		0xffff
+/* Number of out-of-order ranges tracked beyond tcp_rcv_nxt */
+#define TCP_OOO_MAX		8
+/* Duplicate ACKs which trigger a fast retransmit */
+#define TCP_DUPACK_THRESH	3
+
+/* Length of the MSS option we send with our SYN */
+#define TCP_SYN_OPT_LEN		4
+
+struct tcp_range {
+	u32 start;
+	u32 end;
+};
+
+static enum tcp_state tcp_state;
+static const struct tcp_ops *tcp_ops;
+static struct in_addr tcp_remote_ip;
+static int tcp_remote_port;
+static int tcp_local_port;
+
+/* Send sequence space: oldest unacknowledged and next sequence number */
+static u32 tcp_iss;
+static u32 tcp_snd_una;
+static u32 tcp_snd_nxt;
+/* MSS announced by the peer */
+static unsigned int tcp_peer_mss;
+
+/* Receive sequence space */
+static u32 tcp_irs;
+static u32 tcp_rcv_nxt;
+/* Out-of-order data already passed on, sorted by sequence number */
+static struct tcp_range tcp_ooo[TCP_OOO_MAX];
+static int tcp_ooo_count;
+
+/* Data queued by tcp_send(), kept until acknowledged */
+static uchar tcp_tx_buf[TCP_TX_MAX];
+static unsigned int tcp_tx_len;
+static u32 tcp_tx_seq;
+static bool tcp_tx_sent;
+/* tcp_close() was called; a FIN follows the queued data */
+static bool tcp_fin_queued;
+static bool tcp_fin_sent;
+
+static int tcp_dupacks;
+/* Full-sized segments received since we last sent an ACK */
+static int tcp_unacked_segs;
+static bool tcp_delack_pending;
+static ulong tcp_delack_start;
+static bool tcp_rto_pending;
+static ulong tcp_rto_start;
+static ulong tcp_rto;
+static int tcp_retries;
+static ulong tcp_last_rx;
+
+static inline bool tcp_seq_lt(u32 a, u32 b)
+{
+	return (s32)(a - b) < 0;
+}
+
+static inline bool tcp_seq_le(u32 a, u32 b)
+{
+	return (s32)(a - b) <= 0;
+}
+
+enum tcp_state tcp_get_state(void)
+{
+	return tcp_state;
+}
+
+/* Internet checksum of the pseudo header, TCP header and payload */
+static unsigned int tcp_checksum(struct ip_tcp_hdr *ip, unsigned int tcp_len)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} __packed pseudo;
+	unsigned int sum;
+
+	net_copy_ip(&pseudo.src, &ip->ip_src);
+	net_copy_ip(&pseudo.dst, &ip->ip_dst);
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_TCP;
+	pseudo.len = htons(tcp_len);
+
+	sum = compute_ip_checksum(&pseudo, sizeof(pseudo));
+
+	return add_ip_checksums(sizeof(pseudo), sum,
+				compute_ip_checksum(&ip->tcp_src, tcp_len));
+}
+
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 flags, u32 seq, u32 ack)
+{
+	struct ip_tcp_hdr *ip = (struct ip_tcp_hdr *)pkt;
+	int tcp_len = TCP_HDR_SIZE;
+	uchar *opt = pkt + IP_TCP_HDR_SIZE;
+
+	if (flags & TCP_SYN) {
+		opt[0] = TCP_OPT_MSS;
+		opt[1] = TCP_SYN_OPT_LEN;
+		put_unaligned_be16(TCP_MSS, opt + 2);
+		tcp_len += TCP_SYN_OPT_LEN;
+		payload_len = 0;
+	}
+
+	/* Zero the pad byte of an odd-sized segment for the checksum */
+	if ((tcp_len + payload_len) & 1)
+		pkt[IP_HDR_SIZE + tcp_len + payload_len] = 0;
+
+	net_set_ip_header(pkt, dest, net_ip,
+			  IP_HDR_SIZE + tcp_len + payload_len, IPPROTO_TCP);
+
+	ip->tcp_src = htons(sport);
+	ip->tcp_dst = htons(dport);
+	ip->tcp_seq = htonl(seq);
+	ip->tcp_ack = htonl(ack);
+	ip->tcp_hlen = (tcp_len / 4) << 4;
+	ip->tcp_flags = flags;
+	ip->tcp_win = htons(TCP_RCV_WND);
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	ip->tcp_xsum = tcp_checksum(ip, tcp_len + payload_len);
+
+	return IP_HDR_SIZE + tcp_len;
+}
+
+static void tcp_send_segment(u8 flags, u32 seq, const uchar *data,
+			     unsigned int len)
+{
+	uchar *payload = net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE;
+
+	if (len)
+		memcpy(payload, data, len);
+
+	/* Every segment but the first SYN acknowledges what we received */
+	if (tcp_state != TCP_SYN_SENT)
+		flags |= TCP_ACK;
+	if (flags & TCP_ACK) {
+		tcp_unacked_segs = 0;
+		tcp_delack_pending = false;
+	}
+
+	net_send_ip_packet(net_server_ethaddr, tcp_remote_ip, tcp_remote_port,
+			   tcp_local_port, len, IPPROTO_TCP, flags, seq,
+			   tcp_rcv_nxt);
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+}
+
+static void tcp_start_rto(void)
+{
+	if (tcp_rto_pending)
+		return;
+	tcp_rto_pending = true;
+	tcp_rto_start = get_timer(0);
+}
+
+/* Send whatever is queued and has not been sent yet */
+static void tcp_output(void)
+{
+	if (tcp_state != TCP_ESTABLISHED && tcp_state != TCP_CLOSE_WAIT)
+		return;
+
+	if (tcp_tx_len && !tcp_tx_sent) {
+		tcp_tx_seq = tcp_snd_nxt;
+		tcp_send_segment(TCP_PSH, tcp_tx_seq, tcp_tx_buf, tcp_tx_len);
+		tcp_snd_nxt += tcp_tx_len;
+		tcp_tx_sent = true;
+		tcp_start_rto();
+	}
+
+	if (tcp_fin_queued && !tcp_fin_sent) {
+		tcp_send_segment(TCP_FIN, tcp_snd_nxt, NULL, 0);
+		tcp_snd_nxt++;
+		tcp_fin_sent = true;
+		tcp_state = tcp_state == TCP_ESTABLISHED ? TCP_FIN_WAIT_1 :
+			    TCP_LAST_ACK;
+		tcp_start_rto();
+	}
+}
+
+/* Resend the oldest unacknowledged segment */
+static void tcp_retransmit(void)
+{
+	u32 tx_end = tcp_tx_seq + tcp_tx_len;
+
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_send_segment(TCP_SYN, tcp_iss, NULL, 0);
+	} else if (tcp_tx_sent && tcp_seq_lt(tcp_snd_una, tx_end)) {
+		u32 done = tcp_snd_una - tcp_tx_seq;
+
+		tcp_send_segment(TCP_PSH, tcp_snd_una, tcp_tx_buf + done,
+				 tcp_tx_len - done);
+	} else if (tcp_fin_sent) {
+		tcp_send_segment(TCP_FIN, tcp_snd_nxt - 1, NULL, 0);
+	}
+	tcp_rto_start = get_timer(0);
+}
+
+/* Drop the connection without telling the peer */
+static void tcp_closed(void)
+{
+	tcp_state = TCP_CLOSED;
+	tcp_rto_pending = false;
+	tcp_delack_pending = false;
+	net_set_timeout_handler(0, NULL);
+}
+
+/* The connection failed: drop it and tell its user */
+static void tcp_fail(enum tcp_event event)
+{
+	tcp_closed();
+	tcp_ops->event(event);
+}
+
+static void tcp_timeout_handler(void);
+
+/* Schedule the net_loop() timeout for the earliest pending TCP timer */
+static void tcp_update_timer(void)
+{
+	ulong now = get_timer(0);
+	ulong wait = TCP_IDLE_MS - min(now - tcp_last_rx, TCP_IDLE_MS);
+
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	if (tcp_delack_pending)
+		wait = min(wait, TCP_DELACK_MS -
+			   min(now - tcp_delack_start, TCP_DELACK_MS));
+	if (tcp_rto_pending)
+		wait = min(wait, tcp_rto - min(now - tcp_rto_start, tcp_rto));
+
+	net_set_timeout_handler(max(wait, 1UL), tcp_timeout_handler);
+}
+
+static void tcp_timeout_handler(void)
+{
+	ulong now = get_timer(0);
+
+	if (tcp_delack_pending && now - tcp_delack_start >= TCP_DELACK_MS)
+		tcp_send_ack();
+
+	if (tcp_rto_pending && now - tcp_rto_start >= tcp_rto) {
+		if (++tcp_retries > TCP_RETRIES) {
+			tcp_fail(TCP_EV_TIMEOUT);
+			return;
+		}
+		tcp_rto = min(tcp_rto * 2, TCP_RTO_MAX_MS);
+		debug("TCP: retransmit, rto %lu ms\n", tcp_rto);
+		tcp_retransmit();
+	}
+
+	if (now - tcp_last_rx >= TCP_IDLE_MS) {
+		tcp_fail(TCP_EV_TIMEOUT);
+		return;
+	}
+
+	tcp_update_timer();
+}
+
+int tcp_connect(struct in_addr dest, int dport, const struct tcp_ops *ops)
+{
+	tcp_ops = ops;
+	tcp_remote_ip = dest;
+	tcp_remote_port = dport;
+	tcp_local_port = random_port();
+	/* RFC 793 suggests a clock-driven initial sequence number */
+	tcp_iss = (u32)get_ticks();
+	tcp_snd_una = tcp_iss;
+	tcp_snd_nxt = tcp_iss + 1;
+	tcp_peer_mss = 536;
+	tcp_rcv_nxt = 0;
+	tcp_ooo_count = 0;
+	tcp_tx_len = 0;
+	tcp_tx_sent = false;
+	tcp_fin_queued = false;
+	tcp_fin_sent = false;
+	tcp_dupacks = 0;
+	tcp_unacked_segs = 0;
+	tcp_delack_pending = false;
+	tcp_rto = TCP_RTO_MS;
+	tcp_retries = 0;
+	tcp_rto_pending = false;
+	tcp_last_rx = get_timer(0);
+
+	/* zero out server ether in case the server ip has changed */
+	memset(net_server_ethaddr, 0, 6);
+
+	tcp_state = TCP_SYN_SENT;
+	tcp_send_segment(TCP_SYN, tcp_iss, NULL, 0);
+	tcp_start_rto();
+	tcp_update_timer();
+
+	return 0;
+}
+
+int tcp_send(const void *data, unsigned int len)
+{
+	if (len > TCP_TX_MAX)
+		return -E2BIG;
+	if (tcp_tx_len || tcp_fin_queued)
+		return -EBUSY;
+
+	memcpy(tcp_tx_buf, data, len);
+	tcp_tx_len = len;
+	tcp_tx_sent = false;
+	tcp_output();
+	tcp_update_timer();
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	if (tcp_state == TCP_CLOSED || tcp_fin_queued)
+		return;
+
+	tcp_fin_queued = true;
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_abort();
+		return;
+	}
+	tcp_output();
+	tcp_update_timer();
+}
+
+void tcp_abort(void)
+{
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	if (tcp_state != TCP_SYN_SENT)
+		tcp_send_segment(TCP_RST, tcp_snd_nxt, NULL, 0);
+	tcp_closed();
+}
+
+/* Check whether [start, end) can be recorded as out-of-order data */
+static bool tcp_ooo_fits(u32 start, u32 end)
+{
+	int i;
+
+	if (tcp_ooo_count < TCP_OOO_MAX)
+		return true;
+
+	/* A full list can only take ranges touching an existing one */
+	for (i = 0; i < tcp_ooo_count; i++) {
+		if (tcp_seq_le(start, tcp_ooo[i].end) &&
+		    tcp_seq_le(tcp_ooo[i].start, end))
+			return true;
+	}
+
+	return false;
+}
+
+/* Record [start, end), merging it with the ranges it touches */
+static void tcp_ooo_add(u32 start, u32 end)
+{
+	int i, j;
+
+	for (i = 0; i < tcp_ooo_count; i++) {
+		if (tcp_seq_lt(tcp_ooo[i].end, start))
+			continue;
+		if (tcp_seq_lt(end, tcp_ooo[i].start))
+			break;
+		/* Overlapping or adjacent: absorb it and drop it */
+		if (tcp_seq_lt(tcp_ooo[i].start, start))
+			start = tcp_ooo[i].start;
+		if (tcp_seq_lt(end, tcp_ooo[i].end))
+			end = tcp_ooo[i].end;
+		for (j = i; j < tcp_ooo_count - 1; j++)
+			tcp_ooo[j] = tcp_ooo[j + 1];
+		tcp_ooo_count--;
+		i--;
+	}
+
+	if (tcp_ooo_count == TCP_OOO_MAX)
+		return;
+	for (j = tcp_ooo_count; j > i; j--)
+		tcp_ooo[j] = tcp_ooo[j - 1];
+	tcp_ooo[i].start = start;
+	tcp_ooo[i].end = end;
+	tcp_ooo_count++;
+}
+
+/*
+ * Advance tcp_rcv_nxt over out-of-order data which is now in sequence
+ *
+ * @return true if a gap was filled
+ */
+static bool tcp_ooo_advance(void)
+{
+	bool filled = false;
+	int i;
+
+	while (tcp_ooo_count && tcp_seq_le(tcp_ooo[0].start, tcp_rcv_nxt)) {
+		if (tcp_seq_lt(tcp_rcv_nxt, tcp_ooo[0].end))
+			tcp_rcv_nxt = tcp_ooo[0].end;
+		for (i = 0; i < tcp_ooo_count - 1; i++)
+			tcp_ooo[i] = tcp_ooo[i + 1];
+		tcp_ooo_count--;
+		filled = true;
+	}
+
+	return filled;
+}
+
+static void tcp_rx_data(u32 seq, const uchar *data, unsigned int len)
+{
+	u32 wnd_end = tcp_rcv_nxt + TCP_RCV_WND;
+	u32 offset;
+
+	/* Trim anything we already have or that is outside the window */
+	if (tcp_seq_lt(seq, tcp_rcv_nxt)) {
+		u32 skip = tcp_rcv_nxt - seq;
+
+		if (skip >= len) {
+			/* Retransmission of old data; our ACK was lost */
+			tcp_send_ack();
+			return;
+		}
+		seq += skip;
+		data += skip;
+		len -= skip;
+	}
+	if (tcp_seq_lt(wnd_end, seq + len)) {
+		if (tcp_seq_le(wnd_end, seq)) {
+			tcp_send_ack();
+			return;
+		}
+		len = wnd_end - seq;
+	}
+
+	offset = seq - tcp_irs - 1;
+	if (seq != tcp_rcv_nxt) {
+		/*
+		 * Out of order: pass it on if we can remember it, and send a
+		 * duplicate ACK either way so the sender notices the hole.
+		 */
+		if (tcp_ooo_fits(seq, seq + len) &&
+		    !tcp_ops->rx(offset, data, len))
+			tcp_ooo_add(seq, seq + len);
+		tcp_send_ack();
+		return;
+	}
+
+	if (tcp_ops->rx(offset, data, len))
+		return;
+	tcp_rcv_nxt += len;
+
+	/* Acknowledge at once if this filled in (part of) a gap */
+	if (tcp_ooo_advance() || tcp_ooo_count) {
+		tcp_send_ack();
+		return;
+	}
+
+	if (len >= tcp_peer_mss)
+		tcp_unacked_segs++;
+	if (tcp_unacked_segs >= 2) {
+		tcp_send_ack();
+	} else if (!tcp_delack_pending) {
+		tcp_delack_pending = true;
+		tcp_delack_start = get_timer(0);
+	}
+}
+
+static void tcp_rx_ack(u32 ack, unsigned int len)
+{
+	if (tcp_seq_lt(tcp_snd_una, ack) && tcp_seq_le(ack, tcp_snd_nxt)) {
+		tcp_snd_una = ack;
+		tcp_dupacks = 0;
+		tcp_retries = 0;
+		tcp_rto = TCP_RTO_MS;
+		if (tcp_tx_sent &&
+		    tcp_seq_le(tcp_tx_seq + tcp_tx_len, tcp_snd_una))
+			tcp_tx_len = 0;
+		tcp_rto_pending = false;
+		if (tcp_snd_una != tcp_snd_nxt)
+			tcp_start_rto();
+	} else if (ack == tcp_snd_una && !len && tcp_snd_una != tcp_snd_nxt) {
+		if (++tcp_dupacks == TCP_DUPACK_THRESH) {
+			debug("TCP: fast retransmit\n");
+			tcp_retransmit();
+		}
+	}
+
+	/* Everything including our FIN was acknowledged */
+	if (tcp_fin_sent && tcp_snd_una == tcp_snd_nxt) {
+		if (tcp_state == TCP_FIN_WAIT_1)
+			tcp_state = TCP_FIN_WAIT_2;
+		else if (tcp_state == TCP_LAST_ACK)
+			tcp_closed();
+	}
+}
+
+/* Parse the options of a SYN segment */
+static void tcp_rx_syn_options(const uchar *opt, int len)
+{
+	while (len > 0) {
+		if (opt[0] == TCP_OPT_EOL)
+			break;
+		if (opt[0] == TCP_OPT_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		if (opt[0] == TCP_OPT_MSS && opt[1] == 4)
+			tcp_peer_mss = min_t(unsigned int, TCP_MSS,
+					     get_unaligned_be16(opt + 2));
+		len -= opt[1];
+		opt += opt[1];
+	}
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, unsigned int len)
+{
+	unsigned int tcp_len, hlen;
+	const uchar *data;
+	u8 flags;
+	u32 seq, ack;
+	bool fin;
+
+	if (tcp_state == TCP_CLOSED || len < IP_TCP_HDR_SIZE)
+		return;
+	tcp_len = len - IP_HDR_SIZE;
+	hlen = (ip->tcp_hlen >> 4) * 4;
+	if (hlen < TCP_HDR_SIZE || hlen > tcp_len)
+		return;
+
+	if (net_read_ip(&ip->ip_src).s_addr != tcp_remote_ip.s_addr ||
+	    ntohs(ip->tcp_src) != tcp_remote_port ||
+	    ntohs(ip->tcp_dst) != tcp_local_port)
+		return;
+
+	if (tcp_checksum(ip, tcp_len) & 0xfffe) {
+		debug("TCP: bad checksum\n");
+		return;
+	}
+
+	flags = ip->tcp_flags;
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+	data = (uchar *)&ip->tcp_src + hlen;
+	len = tcp_len - hlen;
+	tcp_last_rx = get_timer(0);
+
+	if (tcp_state == TCP_SYN_SENT) {
+		if ((flags & TCP_ACK) && ack != tcp_iss + 1)
+			return;
+		if (flags & TCP_RST) {
+			if (flags & TCP_ACK)
+				tcp_fail(TCP_EV_RESET);
+			return;
+		}
+		if (!(flags & TCP_SYN) || !(flags & TCP_ACK))
+			return;
+
+		tcp_irs = seq;
+		tcp_rcv_nxt = seq + 1;
+		tcp_rx_syn_options((uchar *)ip + IP_TCP_HDR_SIZE,
+				   hlen - TCP_HDR_SIZE);
+		tcp_snd_una = ack;
+		tcp_rto_pending = false;
+		tcp_retries = 0;
+		tcp_rto = TCP_RTO_MS;
+		tcp_state = TCP_ESTABLISHED;
+		tcp_send_ack();
+		tcp_ops->event(TCP_EV_CONNECTED);
+		tcp_output();
+		tcp_update_timer();
+		return;
+	}
+
+	if (flags & TCP_RST) {
+		/* Only accept a reset that is within our window */
+		if (tcp_seq_le(tcp_rcv_nxt, seq) &&
+		    tcp_seq_lt(seq, tcp_rcv_nxt + TCP_RCV_WND))
+			tcp_fail(TCP_EV_RESET);
+		return;
+	}
+
+	if (flags & TCP_SYN) {
+		/* Our ACK of the SYN was lost */
+		tcp_send_ack();
+		return;
+	}
+
+	if (!(flags & TCP_ACK))
+		return;
+
+	tcp_rx_ack(ack, len);
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	fin = flags & TCP_FIN;
+	if (len && (tcp_state == TCP_ESTABLISHED ||
+		    tcp_state == TCP_FIN_WAIT_1 ||
+		    tcp_state == TCP_FIN_WAIT_2))
+		tcp_rx_data(seq, data, len);
+	/* The user may have aborted the connection */
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	/* A FIN only counts once all data before it has been received */
+	if (fin && seq + len == tcp_rcv_nxt) {
+		tcp_rcv_nxt++;
+		tcp_send_ack();
+		switch (tcp_state) {
+		case TCP_ESTABLISHED:
+			tcp_state = TCP_CLOSE_WAIT;
+			tcp_ops->event(TCP_EV_EOF);
+			break;
+		case TCP_FIN_WAIT_1:
+		case TCP_FIN_WAIT_2:
+			/* Both sides are done; skip TIME-WAIT */
+			tcp_closed();
+			tcp_ops->event(TCP_EV_EOF);
+			return;
+		default:
+			break;
+		}
+	} else if (fin) {
+		tcp_send_ack();
+	}
+
+	tcp_output();
+	tcp_update_timer();
+}
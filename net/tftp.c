@@ -141,6 +141,40 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 window size: the number of blocks the server may send before
+ * it waits for an ACK. A window size of 1 is the lock-step protocol of
+ * RFC 1350, so the option is only sent when asking for more than that.
+ */
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_WINDOWSIZE 1
+#endif
+
+static unsigned short tftp_window_size = 1;
+static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
+/* block number at which the next ACK is due */
+static unsigned short tftp_next_ack;
+/* we re-acknowledged tftp_prev_block after a gap, and nothing came since */
+static bool tftp_nack_sent;
+
+/*
+ * Ethernet drivers which support it receive data blocks straight at their
+ * load address (see eth_set_rx_split()), leaving store_block() nothing to
+ * copy. The slots are used in arrival order, so we predict where the next
+ * in-sequence block should land and set them up again whenever that fails.
+ */
+#define TFTP_RX_SPLIT_SLOTS	64
+/* TFTP header size: opcode and block number */
+#define TFTP_DATA_HDR_SIZE	4
+/* 1 if the driver cannot place blocks for us */
+static int	tftp_rx_split_off;
+/* where the next in-sequence block should land, NULL if not set up */
+static uchar	*tftp_rx_split_next;
+/* number of slots left after tftp_rx_split_next */
+static int	tftp_rx_split_left;
+
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
 	ulong offset = block * tftp_block_size + tftp_block_wrap_offset;
@@ -179,7 +213,9 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 		}
 #endif
 		ptr = map_sysmem(store_addr, len);
-		memcpy(ptr, src, len);
+		/* Nothing to do if the block was received in place */
+		if (ptr != src)
+			memcpy(ptr, src, len);
 		unmap_sysmem(ptr);
 	}
 
@@ -195,11 +231,82 @@ static void new_transfer(void)
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	tftp_next_ack = tftp_window_size;
+	tftp_nack_sent = false;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
 }
 
+/**
+ * Set up the Ethernet driver to receive the next data blocks in place
+ *
+ * @param offset	Offset from tftp_load_addr of the next expected block
+ */
+static void tftp_rx_split_arm(ulong offset)
+{
+	struct eth_rx_split split;
+	int count = TFTP_RX_SPLIT_SLOTS;
+
+	tftp_rx_split_next = NULL;
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
+	tftp_rx_split_off = 1;
+#endif
+#ifdef CONFIG_LMB
+	if (offset < tftp_load_size)
+		count = min_t(ulong, count,
+			      (tftp_load_size - offset) / tftp_block_size);
+	else
+		count = 0;
+#endif
+	if (tftp_rx_split_off || !count) {
+		eth_set_rx_split(NULL);
+		return;
+	}
+
+	split.hdr_len = ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + TFTP_DATA_HDR_SIZE;
+	split.base = map_sysmem(tftp_load_addr + offset,
+				count * tftp_block_size);
+	split.stride = tftp_block_size;
+	split.count = count;
+	split.udp_dport = tftp_our_port;
+	unmap_sysmem(split.base);
+
+	if (eth_set_rx_split(&split)) {
+		tftp_rx_split_off = 1;
+		return;
+	}
+	tftp_rx_split_next = split.base;
+	tftp_rx_split_left = count;
+}
+
+/**
+ * Check whether a data block was received in place, re-arming if not
+ *
+ * @param data		Where the payload of the block is
+ * @param in_seq	true if the block is being stored, false if dropped
+ */
+static void tftp_rx_split_update(uchar *data, bool in_seq)
+{
+	ulong next = tftp_prev_block * tftp_block_size +
+		     tftp_block_wrap_offset;
+
+	if (tftp_rx_split_off)
+		return;
+
+	if (in_seq && data == tftp_rx_split_next &&
+	    --tftp_rx_split_left > 0) {
+		tftp_rx_split_next += tftp_block_size;
+		return;
+	}
+
+	/* A dropped block only matters if it used up a slot */
+	if (!in_seq && !eth_get_rx_payload())
+		return;
+
+	tftp_rx_split_arm(next);
+}
+
 #ifdef CONFIG_CMD_TFTPPUT
 /**
  * Load the next block from memory to be sent over tftp.
@@ -347,6 +454,10 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+		/* windowed transfers are only supported for tftp get */
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, tftp_window_size_option, 0);
 		len = pkt - xp;
 		break;
 
@@ -417,6 +528,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 {
 	__be16 proto;
 	__be16 *s;
+	uchar *data;
 	int i;
 
 	if (dest != tftp_our_port) {
@@ -491,6 +603,18 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (strcmp((char *)pkt + i, "windowsize") == 0) {
+				tftp_window_size = (unsigned short)
+					simple_strtoul((char *)pkt + i + 11,
+						       NULL, 10);
+				/* never accept more than we asked for */
+				if (!tftp_window_size ||
+				    tftp_window_size > tftp_window_size_option)
+					tftp_window_size =
+						tftp_window_size_option;
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_window_size);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -505,8 +629,12 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			/* Get ready to send the first block */
 			tftp_state = STATE_DATA;
 			tftp_cur_block++;
-		}
+		} else
 #endif
+		{
+			/* The first block goes to the start of the image */
+			tftp_rx_split_arm(0);
+		}
 		tftp_send(); /* Send ACK or first data block */
 		break;
 	case TFTP_DATA:
@@ -514,8 +642,10 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			return;
 		len -= 2;
 		tftp_cur_block = ntohs(*(__be16 *)pkt);
-
-		update_block_number();
+		/* The driver may have put the block data at its load address */
+		data = eth_get_rx_payload();
+		if (!data)
+			data = pkt + 2;
 
 		if (tftp_state == STATE_SEND_RRQ)
 			debug("Server did not acknowledge timeout option!\n");
@@ -539,27 +669,63 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 		if (tftp_cur_block == tftp_prev_block) {
 			/* Same block again; ignore it. */
+			tftp_rx_split_update(data, false);
+			break;
+		}
+
+		if (tftp_cur_block !=
+		    (unsigned short)(tftp_prev_block + 1)) {
+			/*
+			 * A block of the current window was lost or reordered.
+			 * Drop everything up to the gap and acknowledge the
+			 * last block stored in sequence, so that the server
+			 * rewinds and resends from there (RFC 7440 sect. 4).
+			 * Only do this once per gap to avoid an ACK storm
+			 * while the rest of the window is still arriving.
+			 */
+			debug("TFTP: got block %lu, expected %lu\n",
+			      tftp_cur_block,
+			      (ulong)(unsigned short)(tftp_prev_block + 1));
+			tftp_cur_block = tftp_prev_block;
+			tftp_rx_split_update(data, false);
+			if (!tftp_nack_sent) {
+				tftp_nack_sent = true;
+				tftp_next_ack = tftp_prev_block +
+						tftp_window_size;
+				tftp_send();
+			}
 			break;
 		}
 
+		update_block_number();
+
 		tftp_prev_block = tftp_cur_block;
+		tftp_nack_sent = false;
 		timeout_count_max = tftp_timeout_count_max;
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-		if (store_block(tftp_cur_block - 1, pkt + 2, len)) {
+		if (store_block(tftp_cur_block - 1, data, len)) {
 			eth_halt();
 			net_set_state(NETLOOP_FAIL);
 			break;
 		}
+		tftp_rx_split_update(data, true);
+
+		if (len < tftp_block_size) {
+			/* Acknowledge the final block and finish */
+			tftp_send();
+			tftp_complete();
+			break;
+		}
 
 		/*
-		 *	Acknowledge the block just received, which will prompt
+		 *	Acknowledge the window just received, which will prompt
 		 *	the remote for the next one.
 		 */
-		tftp_send();
-
-		if (len < tftp_block_size)
-			tftp_complete();
+		if ((unsigned short)tftp_cur_block == tftp_next_ack) {
+			tftp_next_ack += tftp_window_size;
+			tftp_send();
+		}
 		break;
 
 	case TFTP_ERROR:
@@ -595,6 +761,11 @@ static void tftp_timeout_handler(void)
 	} else {
 		puts("T ");
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		/* the server restarts its window after our last ACK */
+		if (tftp_state == STATE_DATA && !tftp_put_active) {
+			tftp_next_ack = tftp_prev_block + tftp_window_size;
+			tftp_nack_sent = false;
+		}
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
 	}
@@ -633,6 +804,10 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_block_size_option = simple_strtol(ep, NULL, 10);
 
+	ep = env_get("tftpwindowsize");
+	if (ep != NULL)
+		tftp_window_size_option = simple_strtol(ep, NULL, 10);
+
 	ep = env_get("tftptimeout");
 	if (ep != NULL)
 		timeout_ms = simple_strtol(ep, NULL, 10);
@@ -654,8 +829,11 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	if (!tftp_window_size_option)
+		tftp_window_size_option = 1;
+
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
@@ -754,8 +932,11 @@ void tftp_start(enum proto_t protocol)
 
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_window_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_window_size = 1;
+	tftp_rx_split_off = 0;
+	tftp_rx_split_next = NULL;
 #ifdef CONFIG_TFTP_TSIZE
 	tftp_tsize = 0;
 	tftp_tsize_num_hash = 0;
@@ -786,8 +967,11 @@ void tftp_start_server(void)
 	timeout_ms = TIMEOUT;
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_window_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_window_size = 1;
+	tftp_rx_split_off = 0;
+	tftp_rx_split_next = NULL;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
 
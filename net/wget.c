@@ -0,0 +1,311 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP/1.1 download over TCP
+ *
+ * A single GET request is sent and the body of the response is stored at
+ * the load address. The TCP stack hands us every segment together with its
+ * offset in the stream, so the body is written straight to its final
+ * location, also when segments arrive out of order.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <lmb.h>
+#include <mapmem.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define WGET_PORT		80
+/* Longest response header we accept */
+#define WGET_HDR_MAX		1024
+/* Print a hash for every this many bytes */
+#define WGET_HASH_BYTES		SZ_64K
+#define HASHES_PER_LINE		65
+
+static struct in_addr wget_server_ip;
+static char wget_path[512];
+static ulong wget_load_addr;
+#ifdef CONFIG_LMB
+static ulong wget_load_size;
+#endif
+static ulong wget_time_start;
+static unsigned int wget_num_hash;
+
+/* The response header, collected until the empty line that ends it */
+static char wget_hdr[WGET_HDR_MAX + 1];
+static unsigned int wget_hdr_len;
+static bool wget_hdr_done;
+/* Stream offset of the first byte of the body */
+static u32 wget_body_start;
+/* Length of the body announced by the server, or -1 if not given */
+static long wget_content_len;
+
+static void wget_fail(const char *msg)
+{
+	printf("\nwget error: %s\n", msg);
+	tcp_abort();
+	net_set_state(NETLOOP_FAIL);
+}
+
+static void wget_complete(void)
+{
+	wget_time_start = get_timer(wget_time_start);
+	if (wget_time_start > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(net_boot_file_size /
+			wget_time_start * 1000, "/s");
+	}
+	puts("\ndone\n");
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+/* Store body data at @offset from the load address */
+static int wget_store(ulong offset, const uchar *src, unsigned int len)
+{
+	void *ptr;
+
+	if (wget_content_len >= 0) {
+		if (offset >= wget_content_len)
+			return 0;
+		len = min_t(ulong, len, wget_content_len - offset);
+	}
+
+#ifdef CONFIG_LMB
+	if (offset + len > wget_load_size) {
+		wget_fail("trying to overwrite reserved memory...");
+		return -ENOSPC;
+	}
+#endif
+
+	ptr = map_sysmem(wget_load_addr + offset, len);
+	memcpy(ptr, src, len);
+	unmap_sysmem(ptr);
+
+	if (net_boot_file_size < offset + len)
+		net_boot_file_size = offset + len;
+	while (net_boot_file_size / WGET_HASH_BYTES > wget_num_hash) {
+		putc('#');
+		if (!(++wget_num_hash % HASHES_PER_LINE))
+			puts("\n\t ");
+	}
+
+	return 0;
+}
+
+/*
+ * Parse the response header once it is complete
+ *
+ * @return 0 if the header was parsed, -EAGAIN if it is not complete yet,
+ * other -ve value if the response is not usable
+ */
+static int wget_parse_header(void)
+{
+	char *end, *line, *next;
+	ulong status;
+
+	end = strstr(wget_hdr, "\r\n\r\n");
+	if (!end) {
+		if (wget_hdr_len == WGET_HDR_MAX) {
+			wget_fail("response header too long");
+			return -E2BIG;
+		}
+		return -EAGAIN;
+	}
+	end[2] = '\0';
+	wget_body_start = end + 4 - wget_hdr;
+
+	/* Status line: HTTP/1.x <code> <reason> */
+	line = strchr(wget_hdr, ' ');
+	if (strncmp(wget_hdr, "HTTP/1.", 7) || !line) {
+		wget_fail("bad response from server");
+		return -EPROTO;
+	}
+	status = simple_strtoul(line + 1, NULL, 10);
+	if (status != 200) {
+		next = strstr(line, "\r\n");
+		*next = '\0';
+		printf("\nwget error: server replied '%s'\n", line + 1);
+		tcp_abort();
+		net_set_state(NETLOOP_FAIL);
+		return -ENOENT;
+	}
+
+	wget_content_len = -1;
+	for (line = strstr(wget_hdr, "\r\n") + 2; *line; line = next + 2) {
+		next = strstr(line, "\r\n");
+		*next = '\0';
+		if (!strncasecmp(line, "Content-Length:", 15)) {
+			wget_content_len = simple_strtoul(line + 15, NULL, 10);
+		} else if (!strncasecmp(line, "Transfer-Encoding:", 18) &&
+			   strstr(line + 18, "chunked")) {
+			wget_fail("chunked transfer encoding not supported");
+			return -EPROTO;
+		}
+	}
+
+	if (wget_content_len >= 0) {
+		printf("Size is 0x%lx Bytes = ", wget_content_len);
+		print_size(wget_content_len, "\n");
+	}
+	puts("Loading: ");
+	wget_hdr_done = true;
+
+	return 0;
+}
+
+static int wget_rx(u32 offset, const uchar *data, unsigned int len)
+{
+	int ret;
+
+	if (!wget_hdr_done) {
+		unsigned int n;
+
+		/* Collect the header in order; have the rest resent later */
+		if (offset > wget_hdr_len)
+			return -EAGAIN;
+		if (offset + len <= wget_hdr_len)
+			return 0;
+		n = min(offset + len, (u32)WGET_HDR_MAX) - wget_hdr_len;
+		memcpy(wget_hdr + wget_hdr_len, data + wget_hdr_len - offset,
+		       n);
+		wget_hdr_len += n;
+		wget_hdr[wget_hdr_len] = '\0';
+
+		ret = wget_parse_header();
+		if (ret == -EAGAIN)
+			return 0;
+		if (ret)
+			return ret;
+	}
+
+	if (offset + len <= wget_body_start)
+		return 0;
+	if (offset < wget_body_start) {
+		data += wget_body_start - offset;
+		len -= wget_body_start - offset;
+		offset = wget_body_start;
+	}
+
+	return wget_store(offset - wget_body_start, data, len);
+}
+
+static void wget_event(enum tcp_event event)
+{
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		break;
+	case TCP_EV_EOF:
+		if (!wget_hdr_done) {
+			wget_fail("connection closed without a response");
+			break;
+		}
+		if (wget_content_len >= 0 &&
+		    net_boot_file_size != wget_content_len) {
+			wget_fail("connection closed before end of file");
+			break;
+		}
+		tcp_close();
+		wget_complete();
+		break;
+	case TCP_EV_RESET:
+		wget_fail("connection reset by server");
+		break;
+	case TCP_EV_TIMEOUT:
+		wget_fail("timed out");
+		break;
+	}
+}
+
+static const struct tcp_ops wget_tcp_ops = {
+	.rx	= wget_rx,
+	.event	= wget_event,
+};
+
+/* Initialize wget_load_addr and wget_load_size from load_addr and lmb */
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, load_addr);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#endif
+	wget_load_addr = load_addr;
+	return 0;
+}
+
+void wget_start(void)
+{
+	char req[TCP_TX_MAX];
+	char *path;
+	int len;
+
+	wget_server_ip = net_server_ip;
+	wget_path[0] = '/';
+	if (!net_parse_bootfile(&wget_server_ip, wget_path + 1,
+				sizeof(wget_path) - 1)) {
+		net_set_state(NETLOOP_FAIL);
+		puts("*** ERROR: no file name\n");
+		return;
+	}
+	/* The request needs an absolute path */
+	path = wget_path[1] == '/' ? wget_path + 1 : wget_path;
+
+	len = snprintf(req, sizeof(req),
+		       "GET %s HTTP/1.1\r\n"
+		       "Host: %pI4\r\n"
+		       "Connection: close\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "\r\n", path, &wget_server_ip);
+	if (len >= sizeof(req)) {
+		net_set_state(NETLOOP_FAIL);
+		puts("*** ERROR: file name too long\n");
+		return;
+	}
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4; our IP address is %pI4",
+	       &wget_server_ip, &net_ip);
+
+	/* Check if we need to send across this subnet */
+	if (net_gateway.s_addr && net_netmask.s_addr) {
+		struct in_addr our_net;
+		struct in_addr server_net;
+
+		our_net.s_addr = net_ip.s_addr & net_netmask.s_addr;
+		server_net.s_addr = wget_server_ip.s_addr & net_netmask.s_addr;
+		if (our_net.s_addr != server_net.s_addr)
+			printf("; sending through gateway %pI4",
+			       &net_gateway);
+	}
+	printf("\nFilename '%s'.\n", path);
+
+	if (wget_init_load_addr()) {
+		net_set_state(NETLOOP_FAIL);
+		puts("\nwget error: ");
+		puts("trying to overwrite reserved memory...\n");
+		return;
+	}
+	printf("Load address: 0x%lx\n", wget_load_addr);
+
+	net_boot_file_size = 0;
+	wget_num_hash = 0;
+	wget_hdr_len = 0;
+	wget_hdr_done = false;
+	wget_body_start = 0;
+	wget_content_len = -1;
+	wget_time_start = get_timer(0);
+
+	tcp_connect(wget_server_ip, WGET_PORT, &wget_tcp_ops);
+	tcp_send(req, len);
+}
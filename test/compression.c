@@ -10,6 +10,7 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -19,6 +20,7 @@
 #include <lzma/LzmaTools.h>
 
 #include <linux/lzo.h>
+#include <linux/zstd.h>
 #include <test/compression.h>
 #include <test/suites.h>
 #include <test/ut.h>
@@ -118,6 +120,25 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+#if CONFIG_IS_ENABLED(ZSTD)
+/* zstd -19 /tmp/plain.txt -o /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+#endif
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -293,6 +314,42 @@ static int uncompress_using_lz4(struct unit_test_state *uts,
 	return (ret != 0);
 }
 
+#if CONFIG_IS_ENABLED(ZSTD)
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	ut_asserteq(in_size,  strlen(plain));
+	ut_asserteq(0, memcmp(plain, in, in_size));
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(struct unit_test_state *uts,
+				 void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	int ret;
+	size_t output_size = out_max;
+
+	ret = zstd_decompress_buf(in, in_size, out, &output_size);
+	if (out_size)
+		*out_size = output_size;
+
+	return (ret != 0);
+}
+#endif
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -437,6 +494,15 @@ static int compression_test_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lz4, 0);
 
+#if CONFIG_IS_ENABLED(ZSTD)
+static int compression_test_zstd(struct unit_test_state *uts)
+{
+	return run_test(uts, "zstd", compress_using_zstd,
+			uncompress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_zstd, 0);
+#endif
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -527,12 +593,153 @@ static int compression_test_bootm_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_lz4, 0);
 
+#if CONFIG_IS_ENABLED(ZSTD)
+static int compression_test_bootm_zstd(struct unit_test_state *uts)
+{
+	return run_bootm_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_bootm_zstd, 0);
+#endif
+
 static int compression_test_bootm_none(struct unit_test_state *uts)
 {
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+/**
+ * run_stream_test() - Run tests on streaming decompression
+ *
+ * The compressed data is fed in pieces of various sizes, which must give
+ * the same result as decompressing it in one go.
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_stream_test(struct unit_test_state *uts, int comp_type,
+			   mutate_func compress)
+{
+	static const size_t chunks[] = { 1, 7, 64, TEST_BUFFER_SIZE };
+	struct image_decomp_stream ds;
+	ulong compress_size = 1024;
+	char compress_buff[1024];
+	char out[TEST_BUFFER_SIZE];
+	size_t unc_len = strlen(plain);
+	size_t len, pos, n;
+	int i;
+
+	printf("Testing: %s\n", genimg_get_comp_name(comp_type));
+	ut_assert(image_decomp_can_stream(comp_type));
+	compress(uts, (void *)plain, unc_len, compress_buff, compress_size,
+		 &compress_size);
+
+	for (i = 0; i < ARRAY_SIZE(chunks); i++) {
+		memset(out, 'A', sizeof(out));
+		ut_assertok(image_decomp_start(&ds, comp_type, out, unc_len));
+		for (pos = 0; pos < compress_size; pos += n) {
+			n = min(chunks[i], compress_size - pos);
+			ut_assertok(image_decomp_feed(&ds, compress_buff + pos,
+						      n));
+		}
+		ut_assertok(image_decomp_end(&ds, &len));
+		ut_asserteq(unc_len, len);
+		ut_assertok(memcmp(plain, out, unc_len));
+		ut_asserteq('A', out[unc_len]);
+	}
+
+	/* Output does not fit */
+	ut_assertok(image_decomp_start(&ds, comp_type, out, unc_len - 1));
+	ut_asserteq(-ENOSPC, image_decomp_feed(&ds, compress_buff,
+					       compress_size));
+	image_decomp_end(&ds, NULL);
+
+	/* We can't detect truncation when not decompressing */
+	if (comp_type == IH_COMP_NONE)
+		return 0;
+	ut_assertok(image_decomp_start(&ds, comp_type, out, unc_len));
+	ut_assertok(image_decomp_feed(&ds, compress_buff, compress_size / 2));
+	ut_asserteq(-EINVAL, image_decomp_end(&ds, NULL));
+
+	return 0;
+}
+
+static int compression_test_stream_gzip(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_GZIP, compress_using_gzip);
+}
+COMPRESSION_TEST(compression_test_stream_gzip, 0);
+
+#if CONFIG_IS_ENABLED(ZSTD)
+static int compression_test_stream_zstd(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_stream_zstd, 0);
+
+/* Add a skippable frame of @size bytes at @p, returning the end of it */
+static char *add_zstd_skippable(char *p, size_t size)
+{
+	put_unaligned_le32(ZSTD_MAGIC_SKIPPABLE_START, p);
+	put_unaligned_le32(size, p + 4);
+	memset(p + 8, 0xff, size);
+
+	return p + 8 + size;
+}
+
+/*
+ * Stream two frames with skippable frames in front of each: a small one,
+ * which is staged, and one too big to stage, which is dropped as it comes
+ */
+static int compression_test_stream_zstd_frames(struct unit_test_state *uts)
+{
+	static const size_t chunks[] = { 1, 7, 4096, SIZE_MAX };
+	const size_t small_skip = 16, big_skip = 2 * ZSTD_BLOCKSIZE_ABSOLUTEMAX;
+	struct image_decomp_stream ds;
+	size_t unc_len = strlen(plain);
+	size_t in_len, len, pos, n;
+	char *in, *out, *p;
+	int i;
+
+	in_len = 8 + small_skip + 8 + big_skip + 2 * zstd_compressed_size;
+	in = malloc(in_len);
+	ut_assertnonnull(in);
+	out = malloc(2 * unc_len + 1);
+	ut_assertnonnull(out);
+
+	p = add_zstd_skippable(in, small_skip);
+	memcpy(p, zstd_compressed, zstd_compressed_size);
+	p = add_zstd_skippable(p + zstd_compressed_size, big_skip);
+	memcpy(p, zstd_compressed, zstd_compressed_size);
+
+	for (i = 0; i < ARRAY_SIZE(chunks); i++) {
+		memset(out, 'A', 2 * unc_len + 1);
+		ut_assertok(image_decomp_start(&ds, IH_COMP_ZSTD, out,
+					       2 * unc_len));
+		for (pos = 0; pos < in_len; pos += n) {
+			n = min(chunks[i], in_len - pos);
+			ut_assertok(image_decomp_feed(&ds, in + pos, n));
+		}
+		ut_assertok(image_decomp_end(&ds, &len));
+		ut_asserteq(2 * unc_len, len);
+		ut_assertok(memcmp(plain, out, unc_len));
+		ut_assertok(memcmp(plain, out + unc_len, unc_len));
+		ut_asserteq('A', out[2 * unc_len]);
+	}
+	free(out);
+	free(in);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_stream_zstd_frames, 0);
+#endif
+
+static int compression_test_stream_none(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_NONE, compress_using_none);
+}
+COMPRESSION_TEST(compression_test_stream_none, 0);
+
 int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	struct unit_test *tests = ll_entry_start(struct unit_test,
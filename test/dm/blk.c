@@ -89,6 +89,34 @@ static int dm_test_blk_usb(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_blk_usb, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/* Test that reads can be submitted to a driver without read_start() */
+static int dm_test_blk_submit_sync(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	char cmp[512], buf[512];
+	struct blk_req req;
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+	ut_asserteq(1, blk_dread(dev_desc, 0, 1, cmp));
+
+	/* The read is done before blk_dread_submit() returns */
+	memset(buf, '\0', sizeof(buf));
+	req.start = 0;
+	req.blkcnt = 1;
+	req.buffer = buf;
+	ut_assertok(blk_dread_submit(dev_desc, &req));
+	ut_assertok(req.ret);
+	ut_asserteq(1, req.blks);
+	ut_asserteq_mem(cmp, buf, sizeof(buf));
+	ut_assertok(blk_req_wait(dev_desc, &req));
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_blk_submit_sync, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* Test that we can find block devices without probing them */
 static int dm_test_blk_find(struct unit_test_state *uts)
 {
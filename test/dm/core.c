@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -905,3 +906,248 @@ static int dm_test_inactive_child(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_inactive_child, DM_TESTF_SCAN_PDATA);
+
+/* Check that the driver index finds what searching the lists would */
+static int dm_test_lists_index(struct unit_test_state *uts)
+{
+	struct driver *drv = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct uclass_driver *uc_drv;
+	const struct udevice_id *of_id, *found_id, *want_id;
+	struct lists_index *idx = gd->dm_index;
+	struct driver *found, *want;
+	int i;
+
+	ut_assertnonnull(idx);
+	for (i = 0; i < n_ents; i++) {
+		gd->dm_index = NULL;
+		want = lists_driver_lookup_name(drv[i].name);
+		gd->dm_index = idx;
+		ut_asserteq_ptr(want, lists_driver_lookup_name(drv[i].name));
+
+		for (of_id = drv[i].of_match; of_id && of_id->compatible;
+		     of_id++) {
+			gd->dm_index = NULL;
+			want = lists_driver_lookup_compat(of_id->compatible,
+							  &want_id);
+			gd->dm_index = idx;
+			found = lists_driver_lookup_compat(of_id->compatible,
+							   &found_id);
+			ut_asserteq_ptr(want, found);
+			ut_asserteq_ptr(want_id, found_id);
+		}
+	}
+
+	for (i = 0; i < UCLASS_COUNT; i++) {
+		gd->dm_index = NULL;
+		uc_drv = lists_uclass_lookup(i);
+		gd->dm_index = idx;
+		ut_asserteq_ptr(uc_drv, lists_uclass_lookup(i));
+	}
+
+	ut_assertnull(lists_driver_lookup_name("no-such-driver"));
+	ut_assertnull(lists_driver_lookup_compat("sandbox,no-such-device",
+						 &found_id));
+	ut_assertnull(lists_uclass_lookup(UCLASS_COUNT));
+
+	return 0;
+}
+DM_TEST(dm_test_lists_index, 0);
+
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/* Number of devices bound by the uclass index test */
+#define INDEX_TEST_DEVS		2000
+
+enum {
+	INDEX_BY_SEQ,
+	INDEX_BY_NODE,
+	INDEX_BY_PHANDLE,
+
+	INDEX_TYPE_COUNT,
+};
+
+/**
+ * struct index_test - Devices bound by the uclass index test
+ *
+ * Devices 0 to @node_count - 1 are attached to device tree nodes and the
+ * rest are probed, to give them sequence numbers 0 upwards
+ *
+ * @uc: Test uclass
+ * @nodes: Node for each device, where it has one
+ * @phandles: Phandle of each node, or 0 if none
+ * @node_count: Number of devices with a node
+ */
+struct index_test {
+	struct uclass *uc;
+	ofnode nodes[INDEX_TEST_DEVS];
+	uint phandles[INDEX_TEST_DEVS];
+	int node_count;
+};
+
+/* Add the nodes below @parent to the test, up to half of the devices */
+static void index_test_add_nodes(struct index_test *test, ofnode parent)
+{
+	ofnode node;
+
+	ofnode_for_each_subnode(node, parent) {
+		if (test->node_count == INDEX_TEST_DEVS / 2)
+			break;
+		test->nodes[test->node_count++] = node;
+		index_test_add_nodes(test, node);
+	}
+}
+
+/* Look up device @i, using the uclass functions or searching the list */
+static struct udevice *index_test_find(struct index_test *test, int type,
+				       int i, bool search)
+{
+	struct udevice *dev = NULL;
+	int seq = i - test->node_count;
+
+	if (search) {
+		uclass_foreach_dev(dev, test->uc) {
+			if (type == INDEX_BY_SEQ ? dev->seq == seq :
+			    type == INDEX_BY_NODE ?
+			    ofnode_equal(dev_ofnode(dev), test->nodes[i]) :
+			    dev_has_of_node(dev) &&
+			    dev_read_phandle(dev) == test->phandles[i])
+				return dev;
+		}
+
+		return NULL;
+	}
+
+	switch (type) {
+	case INDEX_BY_SEQ:
+		uclass_find_device_by_seq(UCLASS_TEST, seq, false, &dev);
+		break;
+	case INDEX_BY_NODE:
+		uclass_find_device_by_ofnode(UCLASS_TEST, test->nodes[i], &dev);
+		break;
+	case INDEX_BY_PHANDLE:
+		uclass_find_device_by_phandle_id(UCLASS_TEST, test->phandles[i],
+						 &dev);
+		break;
+	}
+
+	return dev;
+}
+
+static bool index_test_has_key(struct index_test *test, int type, int i)
+{
+	switch (type) {
+	case INDEX_BY_SEQ:
+		return i >= test->node_count;
+	case INDEX_BY_NODE:
+		return i < test->node_count;
+	default:
+		return i < test->node_count && test->phandles[i];
+	}
+}
+
+/* Check that every lookup finds the same device as searching the list */
+static int index_test_check(struct unit_test_state *uts,
+			    struct index_test *test)
+{
+	int type, i;
+
+	for (type = 0; type < INDEX_TYPE_COUNT; type++) {
+		for (i = 0; i < INDEX_TEST_DEVS; i++) {
+			if (!index_test_has_key(test, type, i))
+				continue;
+			ut_asserteq_ptr(index_test_find(test, type, i, true),
+					index_test_find(test, type, i, false));
+		}
+	}
+
+	return 0;
+}
+
+/* Check uclass index lookups and compare their speed with list searches */
+static int dm_test_uclass_index(struct unit_test_state *uts)
+{
+	static const char *const type_name[INDEX_TYPE_COUNT] = {
+		"seq", "ofnode", "phandle",
+	};
+	struct dm_test_state *dms = uts->priv;
+	struct udevice *devs[INDEX_TEST_DEVS];
+	struct index_test *test;
+	ulong start, time_us[2];
+	int type, pass, lookups;
+	int i, count;
+
+	/* Skip the behaviour in test_post_probe() */
+	dms->skip_post_probe = 1;
+
+	test = calloc(1, sizeof(*test));
+	ut_assertnonnull(test);
+	ut_assertok(uclass_get(UCLASS_TEST, &test->uc));
+	index_test_add_nodes(test, ofnode_path("/"));
+	count = test->node_count;
+	ut_assert(count > 0);
+
+	for (i = 0; i < INDEX_TEST_DEVS; i++) {
+		ut_assertok(device_bind_ofnode(dms->root,
+					       DM_GET_DRIVER(test_drv),
+					       "index_test", NULL,
+					       i < count ? test->nodes[i] :
+					       ofnode_null(), &devs[i]));
+		if (i < count)
+			test->phandles[i] = dev_read_phandle(devs[i]);
+		else
+			ut_assertok(device_probe(devs[i]));
+	}
+
+	/* Each device has its own node and sequence number */
+	for (i = 0; i < INDEX_TEST_DEVS; i++) {
+		type = i < count ? INDEX_BY_NODE : INDEX_BY_SEQ;
+		ut_asserteq_ptr(devs[i], index_test_find(test, type, i, false));
+	}
+	ut_assertok(index_test_check(uts, test));
+
+	for (type = 0; type < INDEX_TYPE_COUNT; type++) {
+		for (pass = 0; pass < 2; pass++) {
+			lookups = 0;
+			start = timer_get_us();
+			for (i = 0; i < INDEX_TEST_DEVS; i++) {
+				if (index_test_has_key(test, type, i)) {
+					index_test_find(test, type, i, pass);
+					lookups++;
+				}
+			}
+			time_us[pass] = timer_get_us() - start;
+		}
+		printf("%d lookups by %s: %lu us indexed, %lu us searching\n",
+		       lookups, type_name[type], time_us[0], time_us[1]);
+	}
+
+	/*
+	 * Unbind some devices with a node and remove some without, move
+	 * devices to other nodes, then bind more devices to the same nodes
+	 */
+	for (i = 0; i < INDEX_TEST_DEVS; i += 3) {
+		if (i < count) {
+			ut_assertok(device_unbind(devs[i]));
+		} else {
+			ut_assertok(device_remove(devs[i], DM_REMOVE_NORMAL));
+			ut_asserteq(-1, devs[i]->seq);
+		}
+	}
+	if (count > 4) {
+		/* Moves to a free node, and to that of a later device */
+		dev_set_ofnode(devs[1], test->nodes[0]);
+		dev_set_ofnode(devs[2], test->nodes[4]);
+	}
+	for (i = 0; i < count; i += 2)
+		ut_assertok(device_bind_ofnode(dms->root,
+					       DM_GET_DRIVER(test_drv),
+					       "index_test", NULL,
+					       test->nodes[i], NULL));
+	ut_assertok(index_test_check(uts, test));
+
+	free(test);
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_index, 0);
+#endif
@@ -429,3 +429,92 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, DM_TESTF_SCAN_FDT);
+
+static uchar *rx_split_pkt;
+static uchar *rx_split_payload;
+
+static void sb_rx_split_udp_handler(uchar *pkt, unsigned dport,
+				    struct in_addr sip, unsigned sport,
+				    unsigned len)
+{
+	rx_split_pkt = pkt;
+	rx_split_payload = eth_get_rx_payload();
+}
+
+/* Inject a UDP datagram for our IP address */
+static int sb_rx_split_inject(struct udevice *dev, int dport,
+			      const uchar *data, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth_recv;
+	uchar *ip;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return -EOVERFLOW;
+
+	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_recv->et_dest, net_ethaddr, ARP_HLEN);
+	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_recv->et_protlen = htons(PROT_IP);
+	ip = (void *)eth_recv + ETHER_HDR_SIZE;
+	net_set_udp_header(ip, net_ip, dport, 1234, len);
+	memcpy(ip + IP_UDP_HDR_SIZE, data, len);
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len;
+	++priv->recv_packets;
+
+	return 0;
+}
+
+/* Test receiving payloads in place with eth_set_rx_split() */
+static int dm_test_eth_rx_split(struct unit_test_state *uts)
+{
+	const int hdr_len = ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + 4;
+	struct eth_rx_split split;
+	struct udevice *dev;
+	uchar slots[2][64];
+	uchar data[64];
+	int i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+
+	net_ip = string_to_ip("1.1.2.2");
+	env_set("ethact", "eth@10002000");
+	ut_assertok(eth_init());
+	dev = eth_get_dev();
+	net_set_udp_handler(sb_rx_split_udp_handler);
+
+	split.hdr_len = hdr_len;
+	split.base = slots[0];
+	split.stride = sizeof(slots[0]);
+	split.count = ARRAY_SIZE(slots);
+	split.udp_dport = 1000;
+	ut_assertok(eth_set_rx_split(&split));
+
+	/* The payload after the 4-byte header goes to the first slot */
+	ut_assertok(sb_rx_split_inject(dev, 1000, data, sizeof(data)));
+	ut_assertok(eth_rx());
+	ut_asserteq_ptr(slots[0], rx_split_payload);
+	ut_asserteq_mem(data + 4, slots[0], sizeof(data) - 4);
+
+	/* A datagram for another port is put back together */
+	ut_assertok(sb_rx_split_inject(dev, 1001, data, sizeof(data)));
+	ut_assertok(eth_rx());
+	ut_assertnull(rx_split_payload);
+	ut_asserteq_mem(data, rx_split_pkt, sizeof(data));
+
+	/* Once the slots are used up, frames are received as normal */
+	ut_assertok(sb_rx_split_inject(dev, 1000, data, sizeof(data)));
+	ut_assertok(eth_rx());
+	ut_assertnull(rx_split_payload);
+	ut_asserteq_mem(data, rx_split_pkt, sizeof(data));
+
+	eth_halt();
+	net_set_udp_handler(NULL);
+
+	return 0;
+}
+
+DM_TEST(dm_test_eth_rx_split, DM_TESTF_SCAN_FDT);
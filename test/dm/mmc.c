@@ -41,3 +41,41 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+static int dm_test_mmc_blk_async(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct blk_req req[2];
+	char buf[2][1024];
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+
+	/* Queue two reads; they complete in order */
+	memset(buf, '\0', sizeof(buf));
+	req[0].start = 0;
+	req[0].blkcnt = 2;
+	req[0].buffer = buf[0];
+	req[1].start = 4;
+	req[1].blkcnt = 2;
+	req[1].buffer = buf[1];
+	ut_assertok(blk_dread_submit(dev_desc, &req[0]));
+	ut_assertok(blk_dread_submit(dev_desc, &req[1]));
+	/* sandbox reports each transfer as busy on its first poll */
+	ut_asserteq(-EINPROGRESS, req[1].ret);
+	ut_assertok(blk_req_wait(dev_desc, &req[1]));
+	ut_assertok(req[0].ret);
+	ut_asserteq(2, req[0].blks);
+	ut_asserteq(2, req[1].blks);
+	ut_asserteq_str("this is a test", buf[0]);
+	ut_asserteq_str("this is a test", buf[1]);
+	ut_assertok(blk_dpoll(dev_desc));
+
+	/* A read past the end fails */
+	req[0].start = dev_desc->lba - 1;
+	ut_assertok(blk_dread_submit(dev_desc, &req[0]));
+	ut_asserteq(-EINVAL, blk_req_wait(dev_desc, &req[0]));
+	ut_asserteq(0, req[0].blks);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_blk_async, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
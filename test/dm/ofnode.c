@@ -2,6 +2,9 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
+#include <of_live.h>
+#include <dm/of_access.h>
 #include <dm/of_extra.h>
 #include <dm/test.h>
 #include <test/ut.h>
@@ -58,3 +61,52 @@ static int dm_test_ofnode_fmap(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_ofnode_fmap, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Build a live tree image and use it after moving the flat tree */
+static int dm_test_of_live_image(struct unit_test_state *uts)
+{
+	const char compat[] = "denx,u-boot-fdt-test";
+	int fdt_size = fdt_totalsize(gd->fdt_blob);
+	struct device_node *root, *np;
+	void *buf, *fdt1, *fdt2;
+	ulong size;
+	int len;
+
+	ut_assertok(of_live_size(gd->fdt_blob, &size));
+	buf = malloc(size);
+	fdt1 = malloc(fdt_size);
+	fdt2 = malloc(fdt_size);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(fdt1);
+	ut_assertnonnull(fdt2);
+	memcpy(fdt1, gd->fdt_blob, fdt_size);
+	ut_asserteq(-ENOSPC, of_live_build_image(fdt1, buf, size - 4));
+	ut_assertok(of_live_build_image(fdt1, buf, size));
+
+	/* Move the flat tree and clear the old copy */
+	memcpy(fdt2, fdt1, fdt_size);
+	memset(fdt1, '\0', fdt_size);
+	root = of_live_relocate(buf, fdt2);
+	ut_assertnonnull(root);
+
+	for (np = root->child; np; np = np->sibling) {
+		if (!strcmp(np->name, "a-test"))
+			break;
+	}
+	ut_assertnonnull(np);
+	ut_asserteq_str("/a-test", np->full_name);
+	ut_asserteq_str("<NULL>", np->type);
+	ut_asserteq_str(compat, of_get_property(np, "compatible", &len));
+	ut_asserteq(sizeof(compat), len);
+	ut_asserteq(1234, be32_to_cpup(of_get_property(np, "int-value",
+						       NULL)));
+	ut_assertnull(of_get_property(np, "no-such-property", &len));
+	ut_asserteq(-FDT_ERR_NOTFOUND, len);
+
+	free(fdt2);
+	free(fdt1);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_of_live_image, 0);
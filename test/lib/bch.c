@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for the software BCH encoder and decoder
+ *
+ * The encoder has specialised copies for the usual ecc sizes, so each common
+ * NAND configuration is checked, along with the time taken to encode and
+ * decode a sector. Run with 'ut lib' on sandbox to compare implementations.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <time.h>
+#include <linux/bch.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Number of sectors encoded and decoded for the timings */
+#define BCH_TEST_LOOPS	200
+
+struct bch_test_param {
+	int m;		/* Galois field order */
+	int t;		/* Number of bits corrected */
+	uint len;	/* Sector size in bytes */
+};
+
+static const struct bch_test_param bch_test_params[] = {
+	{ 13, 4, 512 },
+	{ 13, 8, 512 },
+	{ 14, 8, 1024 },
+	{ 14, 16, 1024 },
+	{ 14, 24, 1024 },
+};
+
+/* Flip @count distinct bits of @data, spread over the whole sector */
+static void bch_test_corrupt(u8 *data, uint len, int count)
+{
+	uint bit;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		bit = (i * 7919 + 13) % (len * 8);
+		data[bit / 8] ^= 1 << (bit % 8);
+	}
+}
+
+static int bch_test_one(struct unit_test_state *uts,
+			const struct bch_test_param *p)
+{
+	unsigned int errloc[32];
+	struct bch_control *bch;
+	ulong enc_us, dec_us, start;
+	u8 *data, *copy, *ecc, *calc;
+	uint i;
+	int n;
+
+	bch = init_bch(p->m, p->t, 0);
+	ut_assertnonnull(bch);
+	/* one spare byte to check the encoder at an unaligned address */
+	data = malloc(p->len + 1);
+	copy = malloc(p->len);
+	ecc = calloc(1, bch->ecc_bytes);
+	calc = calloc(1, bch->ecc_bytes);
+	ut_assertnonnull(data);
+	ut_assertnonnull(copy);
+	ut_assertnonnull(ecc);
+	ut_assertnonnull(calc);
+
+	for (i = 0; i < p->len + 1; i++)
+		data[i] = i * 151 + p->t;
+	encode_bch(bch, data, p->len, ecc);
+
+	/* the same sector must give the same ecc however it is aligned */
+	memmove(data + 1, data, p->len);
+	encode_bch(bch, data + 1, p->len, calc);
+	ut_asserteq_mem(ecc, calc, bch->ecc_bytes);
+	memmove(data, data + 1, p->len);
+
+	/* a clean sector decodes with no error, given either ecc form */
+	ut_asserteq(0, decode_bch(bch, data, p->len, ecc, NULL, NULL, errloc));
+	for (i = 0; i < bch->ecc_bytes; i++)
+		calc[i] ^= ecc[i];
+	ut_asserteq(0, decode_bch(bch, NULL, p->len, NULL, calc, NULL,
+				  errloc));
+
+	/* up to t flipped bits are located and can be corrected */
+	memcpy(copy, data, p->len);
+	bch_test_corrupt(data, p->len, p->t);
+	n = decode_bch(bch, data, p->len, ecc, NULL, NULL, errloc);
+	ut_asserteq(p->t, n);
+	for (i = 0; i < n; i++) {
+		ut_assert(errloc[i] < p->len * 8);
+		data[errloc[i] / 8] ^= 1 << (errloc[i] % 8);
+	}
+	ut_asserteq_mem(copy, data, p->len);
+
+	start = timer_get_us();
+	for (i = 0; i < BCH_TEST_LOOPS; i++) {
+		memset(calc, '\0', bch->ecc_bytes);
+		encode_bch(bch, data, p->len, calc);
+	}
+	enc_us = timer_get_us() - start;
+	ut_asserteq_mem(ecc, calc, bch->ecc_bytes);
+
+	bch_test_corrupt(data, p->len, p->t);
+	start = timer_get_us();
+	for (i = 0; i < BCH_TEST_LOOPS; i++)
+		ut_asserteq(p->t, decode_bch(bch, data, p->len, ecc, NULL,
+					     NULL, errloc));
+	dec_us = timer_get_us() - start;
+
+	printf("BCH m=%d t=%d, %u bytes: encode %lu ns, decode %lu ns\n",
+	       p->m, p->t, p->len, enc_us * 1000 / BCH_TEST_LOOPS,
+	       dec_us * 1000 / BCH_TEST_LOOPS);
+
+	free(calc);
+	free(ecc);
+	free(copy);
+	free(data);
+	free_bch(bch);
+
+	return 0;
+}
+
+static int lib_test_bch(struct unit_test_state *uts)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bch_test_params); i++)
+		ut_assertok(bch_test_one(uts, &bch_test_params[i]));
+
+	return 0;
+}
+LIB_TEST(lib_test_bch, 0);
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for CRC-32
+ *
+ * The fast implementations handle aligned words separately from the bytes
+ * around them, so the data is checked at every alignment and split point.
+ */
+
+#include <common.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+
+/* Check value of the CRC-32 over the ASCII digits "123456789" */
+#define CRC32_CHECK	0xcbf43926
+
+static int lib_test_crc32_check(struct unit_test_state *uts)
+{
+	const u8 *digits = (const u8 *)"123456789";
+
+	ut_asserteq(CRC32_CHECK, crc32(0, digits, 9));
+	ut_asserteq(0, crc32(0, digits, 0));
+	/* crc32_no_comp() leaves the inversions to the caller */
+	ut_asserteq(CRC32_CHECK, ~crc32_no_comp(~0U, digits, 9));
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32_check, 0);
+
+/* The same data must give the same CRC however it is aligned or split */
+static int lib_test_crc32_split(struct unit_test_state *uts)
+{
+	u8 buf[128 + 8];
+	uint32_t expect, crc;
+	uint i, off, split;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i * 37 + 11;
+	/* CRC of the 128 bytes from offset 8, computed one byte at a time */
+	expect = 0;
+	for (i = 0; i < 128; i++)
+		expect = crc32(expect, buf + 8 + i, 1);
+
+	for (off = 0; off < 8; off++) {
+		memmove(buf + off, buf + 8, 128);
+		for (split = 0; split <= 128; split += 13) {
+			crc = crc32(0, buf + off, split);
+			crc = crc32(crc, buf + off + split, 128 - split);
+			ut_asserteq(expect, crc);
+		}
+		memmove(buf + 8, buf + off, 128);
+	}
+	ut_asserteq(expect, crc32_wd(0, buf + 8, 128, 5));
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32_split, 0);
@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for writing Android sparse images
+ *
+ * A sparse image is either written from memory in one go or streamed in
+ * pieces of any size as it is downloaded, so both are checked against the
+ * same expected contents. Zero FILL chunks are checked with storage that
+ * erases as well.
+ */
+
+#include <common.h>
+#include <image-sparse.h>
+#include <malloc.h>
+#include <sparse_format.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define SPARSE_TEST_BLKSZ	512
+#define SPARSE_TEST_BLKS	128
+/* Sparse blocks are larger than the storage blocks */
+#define SPARSE_TEST_SBLKSZ	(4 * SPARSE_TEST_BLKSZ)
+#define SPARSE_TEST_UNTOUCHED	0xee
+#define SPARSE_TEST_ERASE_GRP	8
+
+struct sparse_test_chunk {
+	u16 type;
+	u32 blks;	/* In sparse blocks */
+	bool zero;	/* Zero FILL chunk */
+};
+
+static const struct sparse_test_chunk sparse_test_chunks[] = {
+	{ CHUNK_TYPE_RAW, 2 },
+	{ CHUNK_TYPE_RAW, 1 },
+	{ CHUNK_TYPE_FILL, 3 },
+	{ CHUNK_TYPE_DONT_CARE, 1 },
+	{ CHUNK_TYPE_CRC32, 0 },
+	/* Erased from storage block 32 up to 64, after four written ones */
+	{ CHUNK_TYPE_FILL, 5, true },
+	{ CHUNK_TYPE_FILL, 4, true },
+	{ CHUNK_TYPE_RAW, 5 },
+	{ CHUNK_TYPE_FILL, 1 },
+};
+
+/* First block of the FILL chunk after the RAW ones */
+#define SPARSE_TEST_FILL_BLK	(3 * SPARSE_TEST_SBLKSZ / SPARSE_TEST_BLKSZ)
+
+/*
+ * Number of blocks erased, and whether the erase does only half of them or
+ * fails
+ */
+static lbaint_t sparse_test_erased;
+static bool sparse_test_erase_half;
+static bool sparse_test_erase_fail;
+/* Block that cannot be written, or -1 */
+static lbaint_t sparse_test_bad_blk = -1;
+
+static lbaint_t sparse_test_write(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt, const void *buffer)
+{
+	if (sparse_test_bad_blk >= blk && sparse_test_bad_blk < blk + blkcnt)
+		return sparse_test_bad_blk - blk;
+	memcpy(info->priv + blk * info->blksz, buffer, blkcnt * info->blksz);
+
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_reserve(struct sparse_storage *info,
+				    lbaint_t blk, lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_erase(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt)
+{
+	/* Only whole erase groups may be erased */
+	if (blk % SPARSE_TEST_ERASE_GRP || blkcnt % SPARSE_TEST_ERASE_GRP)
+		return 0;
+	if (sparse_test_erase_fail)
+		return -1;
+	if (sparse_test_erase_half)
+		blkcnt /= 2;
+	memset(info->priv + blk * info->blksz, '\0', blkcnt * info->blksz);
+	sparse_test_erased += blkcnt;
+
+	return blkcnt;
+}
+
+/* Build the sparse image and the partition contents it should give */
+static size_t sparse_test_image(u8 *img, u8 *expect)
+{
+	sparse_header_t *hdr = (sparse_header_t *)img;
+	chunk_header_t *chunk;
+	u8 *p = img + sizeof(*hdr);
+	u32 val, i, j, total = 0;
+	size_t len;
+
+	memset(expect, SPARSE_TEST_UNTOUCHED,
+	       SPARSE_TEST_BLKS * SPARSE_TEST_BLKSZ);
+	for (i = 0; i < ARRAY_SIZE(sparse_test_chunks); i++) {
+		const struct sparse_test_chunk *c = &sparse_test_chunks[i];
+
+		len = c->blks * SPARSE_TEST_SBLKSZ;
+		chunk = (chunk_header_t *)p;
+		chunk->chunk_type = c->type;
+		chunk->reserved1 = 0;
+		chunk->chunk_sz = c->blks;
+		chunk->total_sz = sizeof(*chunk);
+		p += sizeof(*chunk);
+		switch (c->type) {
+		case CHUNK_TYPE_RAW:
+			for (j = 0; j < len; j++)
+				p[j] = j * 7 + i;
+			memcpy(expect, p, len);
+			chunk->total_sz += len;
+			p += len;
+			break;
+		case CHUNK_TYPE_FILL:
+		case CHUNK_TYPE_CRC32:
+			val = c->zero ? 0 : 0x5a000000 | i;
+			memcpy(p, &val, sizeof(val));
+			for (j = 0; j < len; j += sizeof(val))
+				memcpy(expect + j, &val, sizeof(val));
+			chunk->total_sz += sizeof(val);
+			p += sizeof(val);
+			break;
+		}
+		expect += len;
+		total += c->blks;
+	}
+
+	hdr->magic = SPARSE_HEADER_MAGIC;
+	hdr->major_version = 1;
+	hdr->minor_version = 0;
+	hdr->file_hdr_sz = sizeof(*hdr);
+	hdr->chunk_hdr_sz = sizeof(*chunk);
+	hdr->blk_sz = SPARSE_TEST_SBLKSZ;
+	hdr->total_blks = total;
+	hdr->total_chunks = ARRAY_SIZE(sparse_test_chunks);
+	hdr->image_checksum = 0;
+
+	return p - img;
+}
+
+static int sparse_test_write_image(struct unit_test_state *uts,
+				   struct sparse_storage *info, u8 *img,
+				   size_t len, u8 *expect, void *buf)
+{
+	const size_t size = SPARSE_TEST_BLKS * SPARSE_TEST_BLKSZ;
+	struct sparse_stream ss;
+	size_t off, n;
+	uint piece;
+
+	memset(info->priv, SPARSE_TEST_UNTOUCHED, size);
+	ut_assertok(write_sparse_image(info, "test", img, NULL));
+	ut_asserteq_mem(expect, info->priv, size);
+
+	/* Pieces smaller and larger than a block, and the staging buffer */
+	for (piece = 1; piece < 4 * SPARSE_TEST_SBLKSZ; piece = piece * 3 + 1) {
+		memset(info->priv, SPARSE_TEST_UNTOUCHED, size);
+		ut_assertok(sparse_stream_start(&ss, info, "test", buf,
+						3 * SPARSE_TEST_BLKSZ, NULL));
+		for (off = 0; off < len; off += n) {
+			n = min_t(size_t, piece, len - off);
+			ut_assertok(sparse_stream_write(&ss, img + off, n));
+		}
+		/* Anything after the image is ignored */
+		ut_assertok(sparse_stream_write(&ss, img, piece));
+		ut_assertok(sparse_stream_finish(&ss));
+		ut_asserteq_mem(expect, info->priv, size);
+	}
+
+	return 0;
+}
+
+static int lib_test_image_sparse(struct unit_test_state *uts)
+{
+	const size_t size = SPARSE_TEST_BLKS * SPARSE_TEST_BLKSZ;
+	struct sparse_storage info = {
+		.blksz = SPARSE_TEST_BLKSZ,
+		.start = 0,
+		.size = SPARSE_TEST_BLKS,
+		.write = sparse_test_write,
+		.reserve = sparse_test_reserve,
+	};
+	struct sparse_stream ss;
+	u8 *img, *expect, *buf;
+	size_t len, off;
+
+	img = malloc(2 * size);
+	expect = malloc(size);
+	info.priv = malloc(size);
+	buf = memalign(ARCH_DMA_MINALIGN, 3 * SPARSE_TEST_BLKSZ);
+	ut_assertnonnull(img);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(info.priv);
+	ut_assertnonnull(buf);
+	len = sparse_test_image(img, expect);
+
+	ut_assertok(sparse_test_write_image(uts, &info, img, len, expect, buf));
+
+	/* Whole erase groups of zero FILL chunks are erased, once per write */
+	info.erase_grp = SPARSE_TEST_ERASE_GRP;
+	info.erase = sparse_test_erase;
+	sparse_test_erased = 0;
+	sparse_test_erase_half = false;
+	ut_assertok(sparse_test_write_image(uts, &info, img, len, expect, buf));
+	ut_asserteq(9 * 32, sparse_test_erased);
+
+	/* The blocks that the storage does not erase are written */
+	sparse_test_erase_half = true;
+	ut_assertok(sparse_test_write_image(uts, &info, img, len, expect, buf));
+
+	/* So are the blocks of a failed erase */
+	sparse_test_erase_fail = true;
+	ut_assertok(sparse_test_write_image(uts, &info, img, len, expect, buf));
+	sparse_test_erase_fail = false;
+	info.erase = NULL;
+
+	/* A truncated image is reported when the stream ends */
+	ut_assertok(sparse_stream_start(&ss, &info, "test", buf,
+					3 * SPARSE_TEST_BLKSZ, NULL));
+	ut_assertok(sparse_stream_write(&ss, img, len - 1));
+	ut_asserteq(-1, sparse_stream_finish(&ss));
+
+	/*
+	 * A failed FILL write is kept, even if the caller goes on sending the
+	 * rest of the image
+	 */
+	sparse_test_bad_blk = SPARSE_TEST_FILL_BLK;
+	ut_asserteq(-1, write_sparse_image(&info, "test", img, NULL));
+	ut_assertok(sparse_stream_start(&ss, &info, "test", buf,
+					3 * SPARSE_TEST_BLKSZ, NULL));
+	/* Split right after the fill value, so the next piece starts a chunk */
+	off = sizeof(sparse_header_t) + 3 * sizeof(chunk_header_t) +
+		3 * SPARSE_TEST_SBLKSZ + sizeof(u32);
+	ut_asserteq(-1, sparse_stream_write(&ss, img, off));
+	ut_asserteq(-1, sparse_stream_write(&ss, img + off, len - off));
+	ut_asserteq(-1, sparse_stream_finish(&ss));
+	sparse_test_bad_blk = -1;
+
+	/* So is data that is not a sparse image */
+	ut_assertok(sparse_stream_start(&ss, &info, "test", buf,
+					3 * SPARSE_TEST_BLKSZ, NULL));
+	ut_asserteq(-1, sparse_stream_write(&ss, expect, len));
+	ut_asserteq(-1, sparse_stream_finish(&ss));
+
+	free(buf);
+	free(info.priv);
+	free(expect);
+	free(img);
+
+	return 0;
+}
+LIB_TEST(lib_test_image_sparse, 0);
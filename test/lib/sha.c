@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for SHA-1 and SHA-256
+ *
+ * Architecture specific implementations hash whole blocks at a time, so the
+ * messages are hashed at an unaligned address and fed in pieces of varying
+ * size, to go through both the buffered and the direct path.
+ */
+
+#include <common.h>
+#include <hexdump.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+/* Length of the longest message, a million times 'a' (FIPS 180-2) */
+#define SHA_TEST_LONG	1000000
+/* Offset of the message in the buffer, to make it unaligned */
+#define SHA_TEST_OFFSET	3
+
+struct sha_test_vector {
+	const char *msg;	/* NULL for the long message */
+	const char *sha1;
+	const char *sha256;
+};
+
+static const struct sha_test_vector sha_test_vectors[] = {
+	{
+		"abc",
+		"a9993e364706816aba3e25717850c26c9cd0d89d",
+		"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+	}, {
+		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+		"84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+		"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+	}, {
+		NULL,
+		"34aa973cd4c4daa4f61eeb2bdbad27316534016f",
+		"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+	},
+};
+
+/* Put the message of @v in @buf and return its length */
+static uint sha_test_msg(const struct sha_test_vector *v, u8 *buf)
+{
+	if (!v->msg) {
+		memset(buf, 'a', SHA_TEST_LONG);
+		return SHA_TEST_LONG;
+	}
+	strcpy((char *)buf, v->msg);
+
+	return strlen(v->msg);
+}
+
+/* Size of the next piece to feed, cycling through awkward values */
+static uint sha_test_step(uint step)
+{
+	return step * 7 % 193 + 1;
+}
+
+#ifdef CONFIG_SHA1
+static int lib_test_sha1(struct unit_test_state *uts)
+{
+	u8 expect[SHA1_SUM_LEN], out[SHA1_SUM_LEN];
+	const struct sha_test_vector *v;
+	sha1_context ctx;
+	uint len, pos, step;
+	u8 *buf, *msg;
+
+	buf = malloc(SHA_TEST_LONG + SHA_TEST_OFFSET + 1);
+	ut_assertnonnull(buf);
+	msg = buf + SHA_TEST_OFFSET;
+
+	for (v = sha_test_vectors; v < sha_test_vectors +
+	     ARRAY_SIZE(sha_test_vectors); v++) {
+		len = sha_test_msg(v, msg);
+		ut_assertok(hex2bin(expect, v->sha1, SHA1_SUM_LEN));
+
+		sha1_csum_wd(msg, len, out, CHUNKSZ_SHA1);
+		ut_asserteq_mem(expect, out, SHA1_SUM_LEN);
+
+		sha1_starts(&ctx);
+		for (pos = 0, step = 1; pos < len; pos += step) {
+			step = min(sha_test_step(step), len - pos);
+			sha1_update(&ctx, msg + pos, step);
+		}
+		sha1_finish(&ctx, out);
+		ut_asserteq_mem(expect, out, SHA1_SUM_LEN);
+	}
+	free(buf);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_sha1, 0);
+#endif
+
+#ifdef CONFIG_SHA256
+static int lib_test_sha256(struct unit_test_state *uts)
+{
+	u8 expect[SHA256_SUM_LEN], out[SHA256_SUM_LEN];
+	const struct sha_test_vector *v;
+	sha256_context ctx;
+	uint len, pos, step;
+	u8 *buf, *msg;
+
+	buf = malloc(SHA_TEST_LONG + SHA_TEST_OFFSET + 1);
+	ut_assertnonnull(buf);
+	msg = buf + SHA_TEST_OFFSET;
+
+	for (v = sha_test_vectors; v < sha_test_vectors +
+	     ARRAY_SIZE(sha_test_vectors); v++) {
+		len = sha_test_msg(v, msg);
+		ut_assertok(hex2bin(expect, v->sha256, SHA256_SUM_LEN));
+
+		sha256_csum_wd(msg, len, out, CHUNKSZ_SHA256);
+		ut_asserteq_mem(expect, out, SHA256_SUM_LEN);
+
+		sha256_starts(&ctx);
+		for (pos = 0, step = 1; pos < len; pos += step) {
+			step = min(sha_test_step(step), len - pos);
+			sha256_update(&ctx, msg + pos, step);
+		}
+		sha256_finish(&ctx, out);
+		ut_asserteq_mem(expect, out, SHA256_SUM_LEN);
+	}
+	free(buf);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_sha256, 0);
+#endif
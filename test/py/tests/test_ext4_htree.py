@@ -0,0 +1,74 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Test looking up names in ext4 directories with a hashed index
+
+import os
+import os.path
+import pytest
+import shutil
+import u_boot_utils
+
+ADDR = 0x01000000
+
+# Enough names for the index to need a level of dx_node blocks
+NFILES = 3000
+
+# Hash algorithms to build the index with, as named by debugfs
+HASHES = ['legacy', 'half_md4', 'tea']
+
+def make_tree(path):
+    """Create a large directory, with names sized after their index
+
+    Args:
+        path: Directory to fill.
+
+    Returns:
+        List of (name, size) for the files created in path/boot.
+    """
+    if os.path.exists(path):
+        shutil.rmtree(path)
+    os.makedirs(os.path.join(path, 'boot'))
+    files = []
+    for i in range(NFILES):
+        name = 'vmlinuz-5.%d.%d-generic' % (i % 17, i)
+        with open(os.path.join(path, 'boot', name), 'wb') as fd:
+            fd.write(b'x' * (i % 97))
+        files.append((name, i % 97))
+    return files
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('ext4_htree')
+@pytest.mark.requiredtool('mkfs.ext4')
+@pytest.mark.requiredtool('debugfs')
+@pytest.mark.requiredtool('e2fsck')
+@pytest.mark.parametrize('hash_alg', HASHES)
+def test_ext4_htree(u_boot_console, hash_alg):
+    """Test finding files in an indexed directory"""
+    cons = u_boot_console
+    src = os.path.join(cons.config.persistent_data_dir, 'htree_src')
+    img = os.path.join(cons.config.persistent_data_dir,
+                       'htree_%s.img' % hash_alg)
+    files = make_tree(src)
+    if os.path.exists(img):
+        os.remove(img)
+    u_boot_utils.run_and_log(cons, ['mkfs.ext4', '-q', '-b', '1024', '-d',
+                                    src, img, '32M'])
+    u_boot_utils.run_and_log(cons, ['debugfs', '-w', '-R',
+                                    'ssv def_hash_version %s' % hash_alg,
+                                    img])
+    # Rebuild the directory indexes with the new hash
+    u_boot_utils.run_and_log(cons, ['e2fsck', '-fyD', img],
+                             ignore_errors=True)
+
+    cons.run_command('host bind 0 %s' % img)
+    # The stride is coprime with the size period, so sizes differ
+    for name, size in files[::101] + files[-3:]:
+        output = cons.run_command('size host 0 /boot/%s; echo rc=$?' % name)
+        assert 'rc=0' in output
+        output = cons.run_command('printenv filesize')
+        assert 'filesize=%x' % size in output
+    output = cons.run_command('size host 0 /boot/missing; echo rc=$?')
+    assert 'rc=1' in output
+    output = cons.run_command('load host 0 %x /boot/%s; echo rc=$?' %
+                              (ADDR, files[-1][0]))
+    assert 'rc=0' in output
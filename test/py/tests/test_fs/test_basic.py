@@ -290,3 +290,28 @@ class TestFsBasic(object):
                 'setenv filesize'])
             assert(md5val[0] in ''.join(output))
             assert_fs_integrity(fs_type, fs_img)
+
+    def test_fs14(self, u_boot_console, fs_obj_basic):
+        """
+        Test Case 14 - load from a file system kept mounted, and umount
+        """
+        fs_type,fs_img,md5val = fs_obj_basic
+        with u_boot_console.log.section('Test Case 14 - load (mounted)'):
+            # Test Case 14a - The second load uses the mounted file system
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                '%sload host 0:0 %x /%s' % (fs_type, ADDR, SMALL_FILE),
+                'mw.b %x 00 100' % ADDR,
+                '%sload host 0:0 %x /%s' % (fs_type, ADDR, SMALL_FILE),
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert(md5val[0] in ''.join(output))
+
+            # Test Case 14b - After umount the partition is probed again
+            output = u_boot_console.run_command_list([
+                'umount',
+                'mw.b %x 00 100' % ADDR,
+                '%sload host 0:0 %x /%s' % (fs_type, ADDR, SMALL_FILE),
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert(md5val[0] in ''.join(output))
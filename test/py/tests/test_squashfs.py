@@ -0,0 +1,99 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Test reading SquashFS images made by mksquashfs
+
+import hashlib
+import os
+import os.path
+import pytest
+import shutil
+import u_boot_utils
+
+ADDR = 0x01000000
+
+# Compressors supported by the reader, as named by mksquashfs, each
+# skipped unless U-Boot is built with its decompressor
+COMPRESSORS = [
+    pytest.param('gzip', marks=pytest.mark.buildconfigspec('zlib')),
+    pytest.param('lzo', marks=pytest.mark.buildconfigspec('lzo')),
+    pytest.param('lz4', marks=pytest.mark.buildconfigspec('lz4')),
+    pytest.param('zstd', marks=pytest.mark.buildconfigspec('zstd')),
+]
+
+def make_tree(path):
+    """Create the files to put in the image
+
+    Args:
+        path: Directory to fill.
+
+    Returns:
+        Dict of file name (relative to the root) to md5sum of its contents.
+    """
+    if os.path.exists(path):
+        shutil.rmtree(path)
+    os.makedirs(os.path.join(path, 'dir', 'subdir'))
+    files = {
+        # Several small files sharing one fragment block
+        'small1.txt': b'small file\n',
+        'small2.txt': b'another small file\n' * 10,
+        'dir/subdir/deep.txt': b'deep down\n' * 100,
+        # Several data blocks followed by a tail in a fragment
+        'big.bin': os.urandom(300 * 1024) + b'tail' * 1000,
+        # Blocks of zeroes are stored as sparse blocks
+        'sparse.bin': b'x' * 100 + b'\0' * (512 * 1024) + b'y' * 100,
+    }
+    md5 = {}
+    for name, data in files.items():
+        with open(os.path.join(path, name), 'wb') as fd:
+            fd.write(data)
+        md5[name] = hashlib.md5(data).hexdigest()
+    os.symlink('dir/subdir/deep.txt', os.path.join(path, 'link.txt'))
+    md5['link.txt'] = md5['dir/subdir/deep.txt']
+    return md5
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('fs_squashfs')
+@pytest.mark.requiredtool('mksquashfs')
+@pytest.mark.parametrize('comp', COMPRESSORS)
+def test_squashfs(u_boot_console, comp):
+    """Test listing and loading files from a SquashFS image"""
+    cons = u_boot_console
+    src = os.path.join(cons.config.persistent_data_dir, 'sqfs_src')
+    img = os.path.join(cons.config.persistent_data_dir, 'sqfs_%s.img' % comp)
+    md5 = make_tree(src)
+    if os.path.exists(img):
+        os.remove(img)
+    try:
+        u_boot_utils.run_and_log(cons, ['mksquashfs', src, img, '-comp',
+                                        comp, '-noappend', '-no-xattrs'])
+    except Exception:
+        pytest.skip('mksquashfs does not support %s' % comp)
+
+    cons.run_command('host bind 0 %s' % img)
+    output = cons.run_command('ls host 0 /')
+    for name in ['small1.txt', 'small2.txt', 'big.bin', 'sparse.bin', 'dir/']:
+        assert name in output
+    output = cons.run_command('ls host 0 /dir/subdir')
+    assert 'deep.txt' in output
+
+    for name, digest in md5.items():
+        output = cons.run_command_list([
+            'setenv filesize',
+            'load host 0 %x /%s' % (ADDR, name),
+            'md5sum %x $filesize' % ADDR])
+        assert digest in ''.join(output)
+
+    # Partial reads, starting within a data block and within the tail
+    with open(os.path.join(src, 'big.bin'), 'rb') as fd:
+        data = fd.read()
+    for offset, size in [(1000, 200000), (len(data) - 3000, 2000)]:
+        digest = hashlib.md5(data[offset:offset + size]).hexdigest()
+        output = cons.run_command_list([
+            'load host 0 %x /big.bin %x %x' % (ADDR, size, offset),
+            'md5sum %x %x' % (ADDR, size)])
+        assert digest in ''.join(output)
+
+    output = cons.run_command('size host 0 /big.bin; echo rc=$?')
+    assert 'rc=0' in output
+    output = cons.run_command('load host 0 %x /missing; echo rc=$?' % ADDR)
+    assert 'rc=1' in output